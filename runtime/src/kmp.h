@@ -991,6 +991,15 @@ extern void __kmp_fini_memkind();
 #define KMP_DEFAULT_STKSIZE ((size_t)(1024 * 1024))
 #endif
 
+// Untied tasks may run on stacks of their own (KMP_TASK_FIBERS), switched with
+// the ucontext API of the C library
+#if KMP_OS_LINUX && defined(__GLIBC__)
+#define KMP_HAVE_TASK_FIBERS 1
+#else
+#define KMP_HAVE_TASK_FIBERS 0
+#endif
+#define KMP_DEFAULT_TASK_FIBER_STKSIZE ((size_t)(256 * 1024))
+
 #define KMP_DEFAULT_MALLOC_POOL_INCR ((size_t)(1024 * 1024))
 #define KMP_MIN_MALLOC_POOL_INCR ((size_t)(4 * 1024))
 #define KMP_MAX_MALLOC_POOL_INCR                                               \
@@ -1763,6 +1772,10 @@ typedef struct kmp_disp {
 #define KMP_BARRIER_SWITCHING                                                  \
   4 // Special state; worker resets appropriate flag on wake-up
 
+// Bytes a fused allreduce carries through the barrier in each thread's state:
+// one cache line
+#define KMP_ALLREDUCE_SIZE 64
+
 #define KMP_NOT_SAFE_TO_REAP                                                   \
   0 // Thread th_reap_state: not safe to reap (tasking)
 #define KMP_SAFE_TO_REAP 1 // Thread th_reap_state: safe to reap (not tasking)
@@ -1791,6 +1804,8 @@ typedef enum kmp_bar_pat { /* Barrier communication patterns */
                                2, /* Hypercube-embedded tree with min branching
                                      factor 2^n */
                            bp_hierarchical_bar = 3, /* Machine hierarchy tree */
+                           bp_dissemination_bar =
+                               4, /* Pairwise signals in log2(P) rounds */
                            bp_last_bar /* Placeholder to mark the end */
 } kmp_bar_pat_e;
 
@@ -1850,6 +1865,11 @@ typedef struct KMP_ALIGN_CACHE kmp_bstate {
   kmp_uint8 offset;
   kmp_uint8 wait_flag;
   kmp_uint8 use_oncore_barrier;
+  kmp_uint8 allreduce; // the barrier carries a fused allreduce in b_allreduce
+  // Partial value of the thread's subtree in the gather of a fused allreduce,
+  // then the result pushed down by the parent in the release
+  KMP_ALIGN_CACHE kmp_uint64 b_allreduce[KMP_ALLREDUCE_SIZE /
+                                         sizeof(kmp_uint64)];
 #if USE_DEBUGGER
   // The following field is intended for the debugger solely. Only the worker
   // thread itself accesses this field: the worker increases it by 1 when it
@@ -1885,6 +1905,55 @@ union KMP_ALIGN_CACHE kmp_barrier_team_union {
 
 typedef union kmp_barrier_team_union kmp_balign_team_t;
 
+/* Dissemination barrier state of a team member, kept in the team since the
+   partners of a thread depend on its tid. In round k, the thread signals
+   flags[parity][k] of the thread 2^k below it and waits on its own, which the
+   thread 2^k above it signals. A thread can reach the next barrier before its
+   partners consumed their flags, so consecutive barriers alternate parity. */
+#define KMP_DISSEM_BAR_ROUNDS 32
+typedef struct KMP_ALIGN_CACHE kmp_dissem_bar {
+  volatile kmp_uint64 flags[2][KMP_DISSEM_BAR_ROUNDS];
+  kmp_uint32 parity;
+} kmp_dissem_bar_t;
+
+/* Pattern and branch bits of the barriers of one type in a team, set by the
+   master at fork from the settings or, with KMP_BARRIER_AUTOTUNE, from the
+   values measured for the team size. All the threads of the team read them in
+   the barrier, so they change only while the workers are in the fork barrier
+   or in a calibration step. */
+typedef struct kmp_bar_config {
+  kmp_uint8 gather_pattern; // kmp_bar_pat
+  kmp_uint8 release_pattern;
+  kmp_uint8 gather_bits;
+  kmp_uint8 release_bits;
+  kmp_int32 tuned_nproc; // team size the tuned values were looked up for
+  kmp_int32 calibrate; // not tuned yet: measure when the team starts
+} kmp_bar_config_t;
+
+/* Sub-team barrier: synchronizes the threads of groups of a team, either one
+   group of given threads or the groups of threads sharing a subtree of a level
+   of the machine hierarchy, without the rest of the team. Each group gathers
+   and releases its members along a tree that follows the machine hierarchy
+   over their positions in the group. The flags only grow, so the barrier can
+   be passed again and again until it is destroyed. */
+#define KMP_SUBTEAM_BAR_LEVELS 8
+typedef struct KMP_ALIGN_CACHE kmp_subteam_bstate {
+  volatile kmp_uint64 b_arrived; // STATE => the subtree of the thread arrived
+  KMP_ALIGN_CACHE volatile kmp_uint64 b_go; // STATE => the thread may leave
+  kmp_int32 pos; // position of the thread in its group, -1 if in no group
+  kmp_int32 first; // index of the first member of the group in sb_members
+  kmp_int32 size; // number of members of the group
+} kmp_subteam_bstate_t;
+
+typedef struct kmp_subteam_barrier {
+  kmp_team_t *sb_team;
+  kmp_int32 sb_nproc; // team size at creation
+  kmp_int32 sb_levels;
+  kmp_uint32 sb_skips[KMP_SUBTEAM_BAR_LEVELS]; // members per level subtree
+  kmp_int32 *sb_members; // team tids of the members, group after group
+  kmp_subteam_bstate_t *sb_threads; // state of each thread of the team, by tid
+} kmp_subteam_barrier_t;
+
 /* Padding for Linux* OS pthreads condition variables and mutexes used to signal
    threads when a condition changes.  This is to workaround an NPTL bug where
    padding was added to pthread_cond_t which caused the initialization routine
@@ -2058,16 +2127,42 @@ typedef enum kmp_tasking_mode {
   tskm_max = 2
 } kmp_tasking_mode_t;
 
+typedef enum kmp_task_steal_policy {
+  task_steal_random = 0, // Random victim, retried while last steal succeeds
+  task_steal_hierarchical = 1 // SMT siblings, then same domain, then remote
+} kmp_task_steal_policy_t;
+
 extern kmp_tasking_mode_t
     __kmp_tasking_mode; /* determines how/when to execute tasks */
 extern int __kmp_task_stealing_constraint;
 extern int __kmp_enable_task_throttling;
+extern int __kmp_task_deque_lockfree;
+extern int __kmp_task_deque_adaptive; // Size deques by the observed steals
+extern kmp_task_steal_policy_t __kmp_task_steal_policy;
+// Steal attempts per level (SMT, domain, remote) for hierarchical stealing
+extern int __kmp_task_steal_retries[3];
+#define KMP_MAX_TASK_STEAL_BATCH 64
+extern int __kmp_task_steal_batch; // Max. tasks taken by one steal (1 = off)
+extern int __kmp_task_bypass; // Run the first released successor right away
+extern int __kmp_task_cutoff; // Queued tasks before short tasks are undeferred
+extern int __kmp_task_wakeup_cap; // Sleepers resumed per new task (0 = all)
+extern int __kmp_task_completion_queue; // Queue proxy tasks completed outside
+#define KMP_MAX_TASK_CRITICAL_PATH 32
+extern int __kmp_task_critical_path; // Levels of path length estimate, 0 = off
+extern int __kmp_task_red_lazy; // Allocate reduction copies on first use
+extern int __kmp_task_red_combine_size; // Min. item size for a parallel combine
+extern int __kmp_task_slab_alloc;
+extern int __kmp_task_numa_local; // Place task deques on their owner's node
+extern int __kmp_task_fibers; // Run untied tasks on stacks of their own
+extern size_t __kmp_task_fiber_stksize;
 extern kmp_int32 __kmp_default_device; // Set via OMP_DEFAULT_DEVICE if
 // specified, defaults to 0 otherwise
 // Set via OMP_MAX_TASK_PRIORITY if specified, defaults to 0 otherwise
 extern kmp_int32 __kmp_max_task_priority;
 // Set via KMP_TASKLOOP_MIN_TASKS if specified, defaults to 0 otherwise
 extern kmp_uint64 __kmp_taskloop_min_tasks;
+// Set via KMP_TASKLOOP_LAZY, split taskloops without schedule clause lazily
+extern int __kmp_taskloop_lazy;
 
 /* NOTE: kmp_taskdata_t and kmp_task_t structures allocated in single block with
    taskdata first */
@@ -2149,12 +2244,31 @@ struct kmp_depnode_list {
 // Max number of mutexinoutset dependencies per node
 #define MAX_MTX_DEPS 4
 
+// Closes the list of successors of a depnode once its task has completed
+#define KMP_DEPNODE_CLOSED ((kmp_depnode_list_t *)1)
+
+// Mutual exclusion of the sibling tasks with a mutexinoutset dependence on the
+// same address. A task about to start finding it owned is parked on it instead
+// of running, and is queued again when the owner completes.
+typedef struct kmp_mtx_dep {
+  kmp_bootstrap_lock_t md_lock; /* guards the fields below */
+  bool md_owned; /* a task holds the mutex */
+  kmp_taskdata_t *md_head; /* parked tasks, linked by td_mtx_next */
+  kmp_taskdata_t *md_tail;
+} kmp_mtx_dep_t;
+
 typedef struct kmp_base_depnode {
-  kmp_depnode_list_t *successors; /* used under lock */
-  kmp_task_t *task; /* non-NULL if depnode is active, used under lock */
-  kmp_lock_t *mtx_locks[MAX_MTX_DEPS]; /* lock mutexinoutset dependent tasks */
+  std::atomic<kmp_depnode_list_t *> successors; /* lock-free stack, closed by
+                                                   the completion of task */
+  kmp_task_t *task; /* non-NULL if depnode is active */
+  kmp_mtx_dep_t *mtx_locks[MAX_MTX_DEPS]; /* mutexinoutset deps, sorted */
   kmp_int32 mtx_num_locks; /* number of locks in mtx_locks array */
-  kmp_lock_t lock; /* guards shared fields: task, successors */
+  kmp_lock_t lock; /* guards predecessors */
+  kmp_int32 tg_index; /* index of the task in the task graph being recorded,
+                         -1 if none */
+  kmp_depnode_list_t *predecessors; /* unfinished predecessors for the critical
+                                       path estimate, used under lock */
+  std::atomic<kmp_int32> bottom_level; /* longest path to a sink, in tasks */
 #if KMP_SUPPORT_GRAPH_OUTPUT
   kmp_uint32 id;
 #endif
@@ -2174,18 +2288,68 @@ struct kmp_dephash_entry {
   kmp_depnode_list_t *last_ins;
   kmp_depnode_list_t *last_mtxs;
   kmp_int32 last_flag;
-  kmp_lock_t *mtx_lock; /* is referenced by depnodes w/mutexinoutset dep */
-  kmp_dephash_entry_t *next_in_bucket;
+  kmp_mtx_dep_t *mtx_lock; /* is referenced by depnodes w/mutexinoutset dep */
 };
 
+typedef struct kmp_dephash_slot {
+  kmp_intptr_t addr;
+  kmp_dephash_entry_t *entry; /* NULL if the slot is empty */
+} kmp_dephash_slot_t;
+
+// Open addressing hash table with linear probing. When it grows, the entries
+// of the previous table are moved a few slots at a time by later lookups.
 typedef struct kmp_dephash {
-  kmp_dephash_entry_t **buckets;
-  size_t size;
-  size_t generation;
-  kmp_uint32 nelements;
-  kmp_uint32 nconflicts;
+  kmp_dephash_slot_t *slots;
+  size_t size; /* power of two */
+  kmp_uint32 nelements; /* in slots and not yet moved from old_slots */
+  kmp_dephash_slot_t *old_slots; /* previous table, NULL if all moved */
+  size_t old_size;
+  size_t old_moved; /* old_slots[0 .. old_moved) were moved to slots */
 } kmp_dephash_t;
 
+// Task graphs: the dependence graph of the tasks created in a
+// __kmpc_taskgraph_begin/end region is recorded the first time and replayed
+// by the next executions of the region, without any dependence hash lookups.
+typedef struct kmp_taskgraph_node kmp_taskgraph_node_t;
+struct kmp_taskgraph_node {
+  kmp_int32 tgn_ndeps; /* depend items of the recorded task, checked on replay */
+  kmp_uint64 tgn_deps_hash; /* hash of their addresses and types, likewise */
+  kmp_int32 tgn_npredecessors;
+  kmp_int32 tgn_nsuccessors;
+  kmp_taskgraph_node_t **tgn_successors;
+  /* Replay state: predecessors not finished yet, plus one until the task has
+     been created, and the task created for the node */
+  std::atomic<kmp_int32> tgn_npending;
+  kmp_task_t *tgn_task;
+};
+
+typedef enum kmp_taskgraph_status {
+  tg_empty = 0, // nothing recorded yet
+  tg_ready, // recorded, can be replayed
+  tg_recording,
+  tg_replaying,
+  tg_fallback, // region running with regular dependence tracking
+  tg_unsupported // uses dependences that cannot be replayed, never recorded
+} kmp_taskgraph_status_t;
+
+typedef struct kmp_taskgraph kmp_taskgraph_t;
+struct kmp_taskgraph {
+  ident_t *tg_loc; // the graph is identified by the location and id passed
+  kmp_int32 tg_id; // to __kmpc_taskgraph_begin
+  kmp_taskgraph_status_t tg_status;
+  kmp_int32 tg_nesting; // nested regions, executed as part of this one
+  kmp_dephash_t *tg_saved_dephash; // dephash of the encountering task
+  kmp_int32 tg_ntasks;
+  kmp_int32 tg_max_tasks;
+  kmp_int32 tg_next_task; // next node to instantiate during a replay
+  kmp_taskgraph_node_t *tg_nodes;
+  kmp_int32 tg_nedges;
+  kmp_int32 tg_max_edges;
+  kmp_int32 *tg_edges; // (predecessor, successor) pairs, while recording
+  kmp_taskgraph_node_t **tg_successors; // storage of the successor lists
+  kmp_taskgraph_t *tg_next; // next graph in __kmp_taskgraphs
+};
+
 typedef struct kmp_task_affinity_info {
   kmp_intptr_t base_addr;
   size_t len;
@@ -2255,7 +2419,8 @@ typedef struct kmp_tasking_flags { /* Total struct must be exactly 32 bits */
   unsigned complete : 1; /* 1==complete, 0==not complete   */
   unsigned freed : 1; /* 1==freed, 0==allocateed        */
   unsigned native : 1; /* 1==gcc-compiled task, 0==intel */
-  unsigned reserved31 : 7; /* reserved for library use */
+  unsigned slab : 1; /* 1==allocated from the task slabs of td_alloc_thread */
+  unsigned reserved31 : 6; /* reserved for library use */
 
 } kmp_tasking_flags_t;
 
@@ -2286,13 +2451,20 @@ struct kmp_taskdata { /* aligned during dynamic allocation       */
       *td_dephash; // Dependencies for children tasks are tracked from here
   kmp_depnode_t
       *td_depnode; // Pointer to graph node if this task has dependencies
+  kmp_taskgraph_t *td_taskgraph; // Task graph recorded or replayed by children
+  kmp_taskgraph_node_t *td_taskgraph_node; // Node if created by a replay
   kmp_task_team_t *td_task_team;
+  kmp_taskdata_t *td_completed_next; // Next on the task team completion queue
+  kmp_taskdata_t *td_mtx_next; // Next task parked on a mutexinoutset dep
+  kmp_taskdata_t *td_spill_next; // Next task on a deque's spill stack
   kmp_int32 td_size_alloc; // The size of task structure, including shareds etc.
+  kmp_int32 td_numa_node; // NUMA node of the task's affinity data, -1 if none
 #if defined(KMP_GOMP_COMPAT)
   // 4 or 8 byte integers for the loop bounds in GOMP_taskloop
   kmp_int32 td_size_loop_bounds;
 #endif
   kmp_taskdata_t *td_last_tied; // keep tied task for task scheduling constraint
+  struct kmp_task_fiber *td_fiber; // Stack of an untied task, NULL if none
 #if defined(KMP_GOMP_COMPAT)
   // GOMP sends in a copy function for copy constructors
   void (*td_copy_func)(void *, void *);
@@ -2306,6 +2478,16 @@ struct kmp_taskdata { /* aligned during dynamic allocation       */
 // Make sure padding above worked
 KMP_BUILD_ASSERT(sizeof(kmp_taskdata_t) % sizeof(void *) == 0);
 
+// Growable circular array backing the lock-free (Chase-Lev) task deque.
+// Arrays are only ever replaced by the owner; the previous array is kept
+// reachable through tr_prev because thieves may still be reading from it, and
+// the whole chain is released together with the deque.
+typedef struct kmp_task_ring {
+  kmp_int64 tr_mask; // Size of tr_tasks minus one (size is a power of two)
+  struct kmp_task_ring *tr_prev; // Smaller array this one replaced
+  std::atomic<kmp_taskdata_t *> tr_tasks[1]; // Actually (tr_mask + 1) entries
+} kmp_task_ring_t;
+
 // Data for task team but per thread
 typedef struct kmp_base_thread_data {
   kmp_info_p *td_thr; // Pointer back to thread info
@@ -2320,15 +2502,40 @@ typedef struct kmp_base_thread_data {
   kmp_int32 td_deque_ntasks; // Number of tasks in deque
   // GEH: shouldn't this be volatile since used in while-spin?
   kmp_int32 td_deque_last_stolen; // Thread number of last successful steal
+  kmp_int32 td_numa_node; // NUMA node the owner ran on when deque was set up
+  kmp_int32 td_idle_next; // Next thread on the task team's idle stack
+  kmp_int32 td_node_probes; // Steals tried on the own node since a remote one
+  // Adaptive capacity (KMP_TASK_DEQUE_ADAPTIVE): the owner's pushes are
+  // throttled once td_deque_ntasks reaches td_deque_limit, which grows while
+  // thieves drain the deque and decays at barriers. Tasks that must be queued
+  // beyond td_deque_size go to the spill stack instead of growing the deque.
+  // All protected by td_deque_lock.
+  kmp_int32 td_deque_limit;
+  kmp_int32 td_deque_steals; // Tasks stolen since the limit was adjusted
+  kmp_int32 td_deque_high_water; // Most tasks queued since the last barrier
+  kmp_taskdata_t *td_spill; // Spill stack, most recent task first
+  kmp_int32 td_spill_ntasks; // Number of tasks on the spill stack
+  // Lock-free deque, used instead of td_deque for the owner's own tasks when
+  // __kmp_task_deque_lockfree is set (td_deque then only holds tasks given to
+  // this thread by others, e.g. proxy task bottom halves). The owner pushes and
+  // pops at td_ring_bottom, thieves take from td_ring_top with a CAS.
+  std::atomic<kmp_task_ring_t *> td_ring;
+  KMP_ALIGN_CACHE std::atomic<kmp_int64> td_ring_top;
+  KMP_ALIGN_CACHE std::atomic<kmp_int64> td_ring_bottom;
 #ifdef BUILD_TIED_TASK_STACK
   kmp_task_stack_t td_susp_tied_tasks; // Stack of suspended tied tasks for task
 // scheduling constraint
 #endif // BUILD_TIED_TASK_STACK
 } kmp_base_thread_data_t;
 
+#define KMP_TASK_NOT_IDLE (-2) // td_idle_next of a thread not on the stack
+#define KMP_TASK_MAX_NUMA_NODES 64 // Nodes indexed for NUMA-local stealing
+
 #define TASK_DEQUE_BITS 8 // Used solely to define INITIAL_TASK_DEQUE_SIZE
 #define INITIAL_TASK_DEQUE_SIZE (1 << TASK_DEQUE_BITS)
 
+#define TASK_DEQUE_MAX_LIMIT (INITIAL_TASK_DEQUE_SIZE << 6) // Adaptive limit
+
 #define TASK_DEQUE_SIZE(td) ((td).td_deque_size)
 #define TASK_DEQUE_MASK(td) ((td).td_deque_size - 1)
 
@@ -2339,6 +2546,13 @@ typedef union KMP_ALIGN_CACHE kmp_thread_data {
 } kmp_thread_data_t;
 
 // Data for task teams which are used when tasking is enabled for the team
+// Queue of tasks of one priority level, shared by all threads of a task team
+typedef struct kmp_task_pri {
+  kmp_thread_data_t td; // Deque of tasks (td_thr is unused)
+  kmp_int32 priority; // Priority of the tasks in this queue
+  struct kmp_task_pri *next; // Queue of the next lower priority
+} kmp_task_pri_t;
+
 typedef struct kmp_base_task_team {
   kmp_bootstrap_lock_t
       tt_threads_lock; /* Lock used to allocate per-thread part of task team */
@@ -2354,6 +2568,33 @@ typedef struct kmp_base_task_team {
   kmp_int32 tt_max_threads; // # entries allocated for threads_data array
   kmp_int32 tt_found_proxy_tasks; // found proxy tasks since last barrier
   kmp_int32 tt_untied_task_encountered;
+  kmp_bootstrap_lock_t tt_task_pri_lock; /* Lock to insert priority queues */
+  kmp_task_pri_t *tt_task_pri_list; /* Priority queues, highest first */
+  kmp_bootstrap_lock_t tt_idle_lock; /* Lock for the idle thread stack */
+  kmp_int32 tt_idle_top; /* Thread on top of the idle stack, -1 if empty */
+  kmp_int32 tt_num_woken; /* #idle threads resumed since tasking was enabled */
+  kmp_int32 tt_wake_all; /* Resume every sleeping thread from now on */
+  /* Per-node index of the threads, built once the node of every thread is
+     known: the tids on node n are tt_node_tids[tt_node_start[n] ..
+     tt_node_start[n + 1] - 1] */
+  kmp_int32 *tt_node_tids;
+  kmp_int32 tt_node_start[KMP_TASK_MAX_NUMA_NODES + 1];
+  kmp_int32 tt_numa_bound; /* tt_threads_data pages placed on their nodes */
+  /* Data survives task team deallocation */
+
+  KMP_ALIGN_CACHE
+  std::atomic<kmp_int32> tt_num_task_pri; /* #tasks in priority queues */
+
+  KMP_ALIGN_CACHE
+  std::atomic<kmp_int32> tt_num_idle; /* #threads on the idle stack */
+
+  KMP_ALIGN_CACHE
+  std::atomic<kmp_int32> tt_num_nodes; /* #nodes indexed, 0 if no index yet */
+  std::atomic<kmp_int32> tt_numa_known; /* #threads whose node is known */
+
+  KMP_ALIGN_CACHE
+  std::atomic<kmp_taskdata_t *> tt_completed_tasks; /* Proxy tasks completed
+                                   outside the team, latest first */
 
   KMP_ALIGN_CACHE
   std::atomic<kmp_int32> tt_unfinished_threads; /* #threads still active */
@@ -2380,6 +2621,32 @@ typedef struct kmp_free_list {
   // sync list)
 } kmp_free_list_t;
 #endif
+// Task slabs keep free task descriptors (taskdata, private and shared blocks)
+// of one size class. Only the owner thread carves and reuses descriptors; other
+// threads return the descriptors they free through the lock-free remote list,
+// which the owner drains all at once when its own free list is empty. Once all
+// the descriptors of a class are free, the owner gives its chunks back to the
+// system but the current one.
+#define KMP_TASK_SLAB_CLASSES 4
+#define KMP_TASK_SLAB_MIN_SIZE 256 // size of the smallest class, in bytes
+#define KMP_TASK_SLAB_CHUNK_SIZE (32 * 1024)
+typedef struct kmp_task_slab {
+  void *ts_free; // free descriptors, owner only
+  char *ts_bump; // next descriptor never used in the current chunk
+  char *ts_end; // end of the current chunk
+  void *ts_chunks; // chunks allocated for this class, newest first
+  KMP_ALIGN_CACHE std::atomic<void *> ts_remote_free; // freed by other threads
+  std::atomic<kmp_int32> ts_nlive; // descriptors allocated and not freed yet
+} kmp_task_slab_t;
+
+// The task cutoff table of a thread records the average duration of the tasks
+// of the constructs it executes, identified by their task routine
+#define KMP_TASK_CUTOFF_ENTRIES 32
+typedef struct kmp_task_cutoff_entry {
+  kmp_routine_entry_t tc_routine;
+  kmp_uint64 tc_time; // average duration of the sampled tasks
+} kmp_task_cutoff_entry_t;
+
 #if KMP_NESTED_HOT_TEAMS
 // Hot teams array keeps hot teams and their sizes for given thread. Hot teams
 // are not put in teams pool, and they don't put threads in threads pool.
@@ -2530,6 +2797,12 @@ typedef struct KMP_ALIGN_CACHE kmp_base_info {
   kmp_free_list_t th_free_lists[NUM_LISTS]; // Free lists for fast memory
 // allocation routines
 #endif
+  kmp_task_slab_t th_task_slabs[KMP_TASK_SLAB_CLASSES];
+  kmp_task_cutoff_entry_t th_task_cutoff[KMP_TASK_CUTOFF_ENTRIES];
+  kmp_uint32 th_task_cutoff_samples; // tasks executed, to sample durations
+  struct kmp_task_fiber *th_task_fibers; // Free task fibers of this thread
+  // Fibers of untied tasks suspended by this thread and ready to resume
+  std::atomic<struct kmp_task_fiber *> th_task_fibers_ready;
 
 #if KMP_OS_WINDOWS
   kmp_win32_cond_t th_suspend_cv;
@@ -2651,6 +2924,9 @@ typedef struct KMP_ALIGN_CACHE kmp_base_team {
   KMP_ALIGN_CACHE kmp_info_t **t_threads;
   kmp_taskdata_t
       *t_implicit_task_taskdata; // Taskdata for the thread's implicit task
+  // Dissemination barrier state per thread, for the barriers using it
+  kmp_dissem_bar_t *t_dissem_bar[bs_last_barrier];
+  kmp_bar_config_t t_bar_config[bs_last_barrier];
   int t_level; // nested parallel level
 
   KMP_ALIGN_CACHE int t_max_argc;
@@ -2842,6 +3118,8 @@ extern char const *__kmp_barrier_branch_bit_env_name[bs_last_barrier];
 extern char const *__kmp_barrier_pattern_env_name[bs_last_barrier];
 extern char const *__kmp_barrier_type_name[bs_last_barrier];
 extern char const *__kmp_barrier_pattern_name[bp_last_bar];
+extern int __kmp_barrier_autotune; /* measure the patterns per team size */
+extern char *__kmp_barrier_autotune_file; /* where tuned patterns persist */
 
 /* Global Locks */
 extern kmp_bootstrap_lock_t __kmp_initz_lock; /* control initialization */
@@ -3134,6 +3412,9 @@ extern void __kmp_parallel_dxo(int *gtid_ref, int *cid_ref, ident_t *loc_ref);
 #ifdef USE_LOAD_BALANCE
 extern int __kmp_get_load_balance(int);
 #endif
+extern int __kmp_get_numa_node(void);
+extern int __kmp_get_numa_node_of_range(void *addr, size_t len);
+extern void __kmp_bind_numa_node(void *addr, size_t len, int node);
 
 extern int __kmp_get_global_thread_id(void);
 extern int __kmp_get_global_thread_id_reg(void);
@@ -3354,6 +3635,10 @@ extern void __kmp_aux_display_affinity(int gtid, const char *format);
 
 extern void __kmp_cleanup_hierarchy();
 extern void __kmp_get_hierarchy(kmp_uint32 nproc, kmp_bstate_t *thr_bar);
+extern void __kmp_get_steal_domains(kmp_uint32 nproc, kmp_uint32 *smt_width,
+                                    kmp_uint32 *domain_width);
+extern int __kmp_get_hierarchy_skips(kmp_uint32 nproc, kmp_uint32 *skips,
+                                     int max);
 
 #if KMP_USE_FUTEX
 
@@ -3449,7 +3734,19 @@ extern int __kmp_barrier(enum barrier_type bt, int gtid, int is_split,
                          size_t reduce_size, void *reduce_data,
                          void (*reduce)(void *, void *));
 extern void __kmp_end_split_barrier(enum barrier_type bt, int gtid);
+extern kmp_int32 __kmp_barrier_arrive(int gtid);
+extern void __kmp_barrier_wait(int gtid, kmp_int32 token);
+extern kmp_subteam_barrier_t *
+__kmp_subteam_barrier_create(int gtid, kmp_int32 nthreads,
+                             const kmp_int32 *tids);
+extern kmp_subteam_barrier_t *__kmp_subteam_barrier_create_level(int gtid,
+                                                                 int level);
+extern void __kmp_subteam_barrier(int gtid, kmp_subteam_barrier_t *bar);
+extern void __kmp_subteam_barrier_destroy(kmp_subteam_barrier_t *bar);
 extern int __kmp_barrier_gomp_cancel(int gtid);
+extern void __kmp_setup_barrier_patterns(kmp_team_t *team);
+extern void __kmp_barrier_calibrate(int gtid);
+extern void __kmp_cleanup_barrier_tuning(void);
 
 /*!
  * Tell the fork call which compiler generated the fork call, and therefore how
@@ -3554,6 +3851,8 @@ int __kmp_execute_tasks_oncore(kmp_info_t *thread, kmp_int32 gtid,
 extern void __kmp_free_task_team(kmp_info_t *thread,
                                  kmp_task_team_t *task_team);
 extern void __kmp_reap_task_teams(void);
+extern void __kmp_free_task_slabs(kmp_info_t *thread);
+extern void __kmp_free_task_fibers(kmp_info_t *thread);
 extern void __kmp_wait_to_unref_task_teams(void);
 extern void __kmp_task_team_setup(kmp_info_t *this_thr, kmp_team_t *team,
                                   int always);
@@ -3618,6 +3917,19 @@ KMP_EXPORT void __kmpc_end_serialized_parallel(ident_t *, kmp_int32 global_tid);
 
 KMP_EXPORT void __kmpc_flush(ident_t *);
 KMP_EXPORT void __kmpc_barrier(ident_t *, kmp_int32 global_tid);
+KMP_EXPORT kmp_int32 __kmpc_barrier_arrive(ident_t *, kmp_int32 global_tid);
+KMP_EXPORT void __kmpc_barrier_wait(ident_t *, kmp_int32 global_tid,
+                                    kmp_int32 token);
+KMP_EXPORT kmp_subteam_barrier_t *
+__kmpc_subteam_barrier_create(ident_t *, kmp_int32 global_tid,
+                              kmp_int32 nthreads, const kmp_int32 *tids);
+KMP_EXPORT kmp_subteam_barrier_t *
+__kmpc_subteam_barrier_create_level(ident_t *, kmp_int32 global_tid,
+                                    kmp_int32 level);
+KMP_EXPORT void __kmpc_subteam_barrier(ident_t *, kmp_int32 global_tid,
+                                       kmp_subteam_barrier_t *bar);
+KMP_EXPORT void __kmpc_subteam_barrier_destroy(ident_t *, kmp_int32 global_tid,
+                                               kmp_subteam_barrier_t *bar);
 KMP_EXPORT kmp_int32 __kmpc_master(ident_t *, kmp_int32 global_tid);
 KMP_EXPORT void __kmpc_end_master(ident_t *, kmp_int32 global_tid);
 KMP_EXPORT void __kmpc_ordered(ident_t *, kmp_int32 global_tid);
@@ -3700,6 +4012,10 @@ KMP_EXPORT void __kmpc_omp_wait_deps(ident_t *loc_ref, kmp_int32 gtid,
                                      kmp_depend_info_t *dep_list,
                                      kmp_int32 ndeps_noalias,
                                      kmp_depend_info_t *noalias_dep_list);
+KMP_EXPORT kmp_int32 __kmpc_taskgraph_begin(ident_t *loc_ref, kmp_int32 gtid,
+                                            kmp_int32 graph_id);
+KMP_EXPORT void __kmpc_taskgraph_end(ident_t *loc_ref, kmp_int32 gtid);
+extern void __kmp_free_taskgraphs(void);
 extern kmp_int32 __kmp_omp_task(kmp_int32 gtid, kmp_task_t *new_task,
                                 bool serialize_immediate);
 
@@ -3772,6 +4088,29 @@ KMP_EXPORT kmp_int32 __kmpc_reduce(
 KMP_EXPORT void __kmpc_end_reduce(ident_t *loc, kmp_int32 global_tid,
                                   kmp_critical_name *lck);
 
+/* Fused allreduce of up to KMP_ALLREDUCE_SIZE bytes of scalars */
+
+typedef enum kmp_allreduce_type {
+  kmp_allreduce_int32 = 0,
+  kmp_allreduce_int64,
+  kmp_allreduce_float,
+  kmp_allreduce_double,
+  kmp_allreduce_last_type
+} kmp_allreduce_type_t;
+
+typedef enum kmp_allreduce_op {
+  kmp_allreduce_sum = 0,
+  kmp_allreduce_min,
+  kmp_allreduce_max,
+  kmp_allreduce_last_op
+} kmp_allreduce_op_t;
+
+KMP_EXPORT void __kmpc_allreduce(ident_t *loc, kmp_int32 global_tid,
+                                 void *data, kmp_int32 count, kmp_int32 type,
+                                 kmp_int32 op);
+extern void __kmp_allreduce(int gtid, void *data, kmp_int32 count,
+                            kmp_allreduce_type_t type, kmp_allreduce_op_t op);
+
 /* Internal fast reduction routines */
 
 extern PACKED_REDUCTION_METHOD_T __kmp_determine_reduction_method(
@@ -3868,6 +4207,8 @@ KMP_EXPORT void KMPC_CONVENTION kmpc_set_stacksize_s(size_t);
 KMP_EXPORT void KMPC_CONVENTION kmpc_set_library(int);
 KMP_EXPORT void KMPC_CONVENTION kmpc_set_defaults(char const *);
 KMP_EXPORT void KMPC_CONVENTION kmpc_set_disp_num_buffers(int);
+KMP_EXPORT int KMPC_CONVENTION kmpc_barrier_arrive(void);
+KMP_EXPORT void KMPC_CONVENTION kmpc_barrier_wait(int);
 
 enum kmp_target_offload_kind {
   tgt_disabled = 0,
@@ -44,6 +44,40 @@ void __kmp_get_hierarchy(kmp_uint32 nproc, kmp_bstate_t *thr_bar) {
   thr_bar->skip_per_level = machine_hierarchy.skipPerLevel;
 }
 
+// Width of the SMT and domain (package/NUMA node) groups of consecutive thread
+// ids, assuming threads are placed compactly like the hierarchical barrier does
+void __kmp_get_steal_domains(kmp_uint32 nproc, kmp_uint32 *smt_width,
+                             kmp_uint32 *domain_width) {
+  if (TCR_1(machine_hierarchy.uninitialized))
+    machine_hierarchy.init(NULL, nproc);
+
+  *smt_width = machine_hierarchy.smtWidth;
+  *domain_width = machine_hierarchy.domainWidth;
+  if (*smt_width == 0)
+    *smt_width = 1;
+  if (*domain_width < *smt_width)
+    *domain_width = *smt_width;
+}
+
+// Number of consecutive thread ids in a subtree of each level of the machine
+// hierarchy for nproc threads, from the leaves up to the first level that
+// holds them all, at most max levels. Returns the number of levels.
+int __kmp_get_hierarchy_skips(kmp_uint32 nproc, kmp_uint32 *skips, int max) {
+  int levels = 0;
+
+  if (TCR_1(machine_hierarchy.uninitialized))
+    machine_hierarchy.init(NULL, nproc);
+  if (nproc > machine_hierarchy.base_num_threads)
+    machine_hierarchy.resize(nproc);
+
+  while (levels < max && levels < (int)machine_hierarchy.maxLevels) {
+    skips[levels] = machine_hierarchy.skipPerLevel[levels];
+    if (skips[levels++] >= nproc)
+      break;
+  }
+  return levels;
+}
+
 #if KMP_AFFINITY_SUPPORTED
 
 bool KMPAffinity::picked_api = false;
@@ -4642,7 +4676,10 @@ static void __kmp_aux_affinity_initialize(void) {
   }
 
   KMP_CPU_FREE_ARRAY(osId2Mask, maxIndex + 1);
-  machine_hierarchy.init(address2os, __kmp_avail_proc);
+  // The topology maps only have a thread level with more than one thread per
+  // core
+  machine_hierarchy.init(address2os, __kmp_avail_proc,
+                         __kmp_nThreadsPerCore > 1);
 }
 #undef KMP_EXIT_AFF_NONE
 
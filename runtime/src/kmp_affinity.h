@@ -672,7 +672,14 @@ public:
   kmp_uint32 *numPerLevel;
   kmp_uint32 *skipPerLevel;
 
-  void deriveLevels(AddrUnsPair *adr2os, int num_addrs) {
+  /** Number of consecutive leaves sharing a core (SMT siblings) and sharing
+      the largest topology domain below the machine (package or NUMA node), as
+      detected before numPerLevel is rebalanced for the barrier trees. Used to
+      keep task stealing local. */
+  kmp_uint32 smtWidth;
+  kmp_uint32 domainWidth;
+
+  void deriveLevels(AddrUnsPair *adr2os, int num_addrs, bool smt_level) {
     int hier_depth = adr2os[0].first.depth;
     int level = 0;
     for (int i = hier_depth - 1; i >= 0; --i) {
@@ -685,6 +692,12 @@ public:
       numPerLevel[level] = max + 1;
       ++level;
     }
+    // The leaves are cores rather than SMT siblings when the topology has no
+    // thread level
+    smtWidth = smt_level && hier_depth > 1 ? numPerLevel[0] : 1;
+    domainWidth = 1;
+    for (int i = 0; i < hier_depth - 1; ++i)
+      domainWidth *= numPerLevel[i];
   }
 
   hierarchy_info()
@@ -698,7 +711,9 @@ public:
     }
   }
 
-  void init(AddrUnsPair *adr2os, int num_addrs) {
+  /** smt_level tells whether the innermost level of adr2os is the thread
+      level, i.e. the leaves sharing a parent are SMT siblings. */
+  void init(AddrUnsPair *adr2os, int num_addrs, bool smt_level = false) {
     kmp_int8 bool_result = KMP_COMPARE_AND_STORE_ACQ8(
         &uninitialized, not_initialized, initializing);
     if (bool_result == 0) { // Wait for initialization
@@ -728,12 +743,14 @@ public:
     if (adr2os) {
       qsort(adr2os, num_addrs, sizeof(*adr2os),
             __kmp_affinity_cmp_Address_labels);
-      deriveLevels(adr2os, num_addrs);
+      deriveLevels(adr2os, num_addrs, smt_level);
     } else {
       numPerLevel[0] = maxLeaves;
       numPerLevel[1] = num_addrs / maxLeaves;
       if (num_addrs % maxLeaves)
         numPerLevel[1]++;
+      smtWidth = 1;
+      domainWidth = num_addrs;
     }
 
     base_num_threads = num_addrs;
@@ -43,6 +43,15 @@ void __kmp_print_structure(void); // Forward declaration
 
 // ---------------------------- Barrier Algorithms ----------------------------
 
+// The release of a fused allreduce passes the result down with the go signal:
+// each thread finds it in its own barrier state once released
+static inline void __kmp_allreduce_push(kmp_bstate_t *thr_bar,
+                                        kmp_bstate_t *child_bar) {
+  if (thr_bar->allreduce)
+    KMP_MEMCPY(child_bar->b_allreduce, thr_bar->b_allreduce,
+               KMP_ALLREDUCE_SIZE);
+}
+
 // Linear Barrier
 template <bool cancellable = false>
 static bool __kmp_linear_barrier_gather_template(
@@ -201,6 +210,7 @@ static bool __kmp_linear_barrier_release_template(
              team->t.t_id, i, &other_threads[i]->th.th_bar[bt].bb.b_go,
              other_threads[i]->th.th_bar[bt].bb.b_go,
              other_threads[i]->th.th_bar[bt].bb.b_go + KMP_BARRIER_STATE_BUMP));
+        __kmp_allreduce_push(thr_bar, &other_threads[i]->th.th_bar[bt].bb);
         ANNOTATE_BARRIER_BEGIN(other_threads[i]);
         kmp_flag_64 flag(&other_threads[i]->th.th_bar[bt].bb.b_go,
                          other_threads[i]);
@@ -298,7 +308,7 @@ __kmp_tree_barrier_gather(enum barrier_type bt, kmp_info_t *this_thr, int gtid,
   kmp_bstate_t *thr_bar = &this_thr->th.th_bar[bt].bb;
   kmp_info_t **other_threads = team->t.t_threads;
   kmp_uint32 nproc = this_thr->th.th_team_nproc;
-  kmp_uint32 branch_bits = __kmp_barrier_gather_branch_bits[bt];
+  kmp_uint32 branch_bits = team->t.t_bar_config[bt].gather_bits;
   kmp_uint32 branch_factor = 1 << branch_bits;
   kmp_uint32 child;
   kmp_uint32 child_tid;
@@ -405,8 +415,8 @@ static void __kmp_tree_barrier_release(
   kmp_team_t *team;
   kmp_bstate_t *thr_bar = &this_thr->th.th_bar[bt].bb;
   kmp_uint32 nproc;
-  kmp_uint32 branch_bits = __kmp_barrier_release_branch_bits[bt];
-  kmp_uint32 branch_factor = 1 << branch_bits;
+  kmp_uint32 branch_bits;
+  kmp_uint32 branch_factor;
   kmp_uint32 child;
   kmp_uint32 child_tid;
 
@@ -458,6 +468,9 @@ static void __kmp_tree_barrier_release(
                   gtid, team->t.t_id, tid, bt));
   }
   nproc = this_thr->th.th_team_nproc;
+  // Workers of the fork barrier only know their team now
+  branch_bits = team->t.t_bar_config[bt].release_bits;
+  branch_factor = 1 << branch_bits;
   child_tid = (tid << branch_bits) + 1;
 
   if (child_tid < nproc) {
@@ -486,6 +499,7 @@ static void __kmp_tree_barrier_release(
         }
       }
 #endif // KMP_BARRIER_ICV_PUSH
+      __kmp_allreduce_push(thr_bar, child_bar);
       KA_TRACE(20,
                ("__kmp_tree_barrier_release: T#%d(%d:%d) releasing T#%d(%d:%u)"
                 "go(%p): %u => %u\n",
@@ -516,7 +530,7 @@ __kmp_hyper_barrier_gather(enum barrier_type bt, kmp_info_t *this_thr, int gtid,
   kmp_info_t **other_threads = team->t.t_threads;
   kmp_uint64 new_state = KMP_BARRIER_UNUSED_STATE;
   kmp_uint32 num_threads = this_thr->th.th_team_nproc;
-  kmp_uint32 branch_bits = __kmp_barrier_gather_branch_bits[bt];
+  kmp_uint32 branch_bits = team->t.t_bar_config[bt].gather_bits;
   kmp_uint32 branch_factor = 1 << branch_bits;
   kmp_uint32 offset;
   kmp_uint32 level;
@@ -634,8 +648,8 @@ static void __kmp_hyper_barrier_release(
   kmp_bstate_t *thr_bar = &this_thr->th.th_bar[bt].bb;
   kmp_info_t **other_threads;
   kmp_uint32 num_threads;
-  kmp_uint32 branch_bits = __kmp_barrier_release_branch_bits[bt];
-  kmp_uint32 branch_factor = 1 << branch_bits;
+  kmp_uint32 branch_bits;
+  kmp_uint32 branch_factor;
   kmp_uint32 child;
   kmp_uint32 child_tid;
   kmp_uint32 offset;
@@ -697,6 +711,9 @@ static void __kmp_hyper_barrier_release(
   }
   num_threads = this_thr->th.th_team_nproc;
   other_threads = team->t.t_threads;
+  // Workers of the fork barrier only know their team now
+  branch_bits = team->t.t_bar_config[bt].release_bits;
+  branch_factor = 1 << branch_bits;
 
 #ifdef KMP_REVERSE_HYPER_BAR
   // Count up to correct level for parent
@@ -753,6 +770,7 @@ static void __kmp_hyper_barrier_release(
         if (propagate_icvs) // push my fixed ICVs to my child
           copy_icvs(&child_bar->th_fixed_icvs, &thr_bar->th_fixed_icvs);
 #endif // KMP_BARRIER_ICV_PUSH
+        __kmp_allreduce_push(thr_bar, child_bar);
 
         KA_TRACE(
             20,
@@ -1154,6 +1172,13 @@ static void __kmp_hierarchical_barrier_release(
     if (__kmp_dflt_blocktime == KMP_MAX_BLOCKTIME &&
         thr_bar->use_oncore_barrier) {
       if (KMP_MASTER_TID(tid)) { // do a flat release
+        if (thr_bar->allreduce) { // before the NGO stores that release them
+          for (child_tid = thr_bar->skip_per_level[1]; child_tid < (int)nproc;
+               child_tid += thr_bar->skip_per_level[1])
+            __kmp_allreduce_push(
+                thr_bar, &team->t.t_threads[child_tid]->th.th_bar[bt].bb);
+          KMP_MB();
+        }
         // Set local b_go to bump children via NGO store of the cache line
         // containing IVCs and b_go.
         thr_bar->b_go = KMP_BARRIER_STATE_BUMP;
@@ -1183,6 +1208,14 @@ static void __kmp_hierarchical_barrier_release(
             KMP_INIT_BARRIER_STATE); // Reset my b_go flag for next time
       // Now, release leaf children
       if (thr_bar->leaf_kids) { // if there are any
+        if (thr_bar->allreduce) {
+          last = tid + thr_bar->skip_per_level[1];
+          if (last > nproc)
+            last = nproc;
+          for (child_tid = tid + 1; child_tid < (int)last; ++child_tid)
+            __kmp_allreduce_push(
+                thr_bar, &team->t.t_threads[child_tid]->th.th_bar[bt].bb);
+        }
         // We test team_change on the off-chance that the level 1 team changed.
         if (team_change ||
             old_leaf_kids < thr_bar->leaf_kids) { // some old, some new
@@ -1224,6 +1257,7 @@ static void __kmp_hierarchical_barrier_release(
         for (child_tid = tid + skip; child_tid < (int)last; child_tid += skip) {
           kmp_info_t *child_thr = team->t.t_threads[child_tid];
           kmp_bstate_t *child_bar = &child_thr->th.th_bar[bt].bb;
+          __kmp_allreduce_push(thr_bar, child_bar);
           KA_TRACE(20, ("__kmp_hierarchical_barrier_release: T#%d(%d:%d) "
                         "releasing T#%d(%d:%d) go(%p): %u => %u\n",
                         gtid, team->t.t_id, tid,
@@ -1249,6 +1283,213 @@ static void __kmp_hierarchical_barrier_release(
                 gtid, team->t.t_id, tid, bt));
 }
 
+// Dissemination Barrier
+static void __kmp_dissemination_barrier_gather(
+    enum barrier_type bt, kmp_info_t *this_thr, int gtid, int tid,
+    void (*reduce)(void *, void *) USE_ITT_BUILD_ARG(void *itt_sync_obj)) {
+  KMP_TIME_DEVELOPER_PARTITIONED_BLOCK(KMP_dissem_gather);
+  kmp_team_t *team = this_thr->th.th_team;
+  kmp_info_t **other_threads = team->t.t_threads;
+  kmp_dissem_bar_t *dissem_bar = team->t.t_dissem_bar[bt];
+  kmp_dissem_bar_t *thr_bar;
+  kmp_uint32 num_threads = this_thr->th.th_team_nproc;
+  kmp_uint32 parity;
+  kmp_uint32 round;
+  kmp_uint32 offset;
+
+  KA_TRACE(20, ("__kmp_dissemination_barrier_gather: T#%d(%d:%d) enter for "
+                "barrier type %d\n",
+                gtid, team->t.t_id, tid, bt));
+  KMP_DEBUG_ASSERT(this_thr == other_threads[this_thr->th.th_info.ds.ds_tid]);
+  if (dissem_bar == NULL) {
+    // The team was allocated before kmp_set_defaults() selected the pattern
+    KMP_ASSERT(team->t.t_bar_config[bt].gather_bits);
+    __kmp_hyper_barrier_gather(bt, this_thr, gtid, tid,
+                               reduce USE_ITT_BUILD_ARG(itt_sync_obj));
+    return;
+  }
+  thr_bar = &dissem_bar[tid];
+  parity = thr_bar->parity;
+
+#if USE_ITT_BUILD && USE_ITT_NOTIFY
+  // Barrier imbalance - save arrive time to the thread
+  if (__kmp_forkjoin_frames_mode == 3 || __kmp_forkjoin_frames_mode == 2) {
+    this_thr->th.th_bar_arrive_time = this_thr->th.th_bar_min_time =
+        __itt_get_timestamp();
+  }
+#endif
+  /* In round k, signal the thread 2^k below and wait for the thread 2^k above.
+     After ceil(log2(nproc)) rounds every thread has heard from all the others,
+     directly or transitively, and no thread has to release the others. The
+     rounds also embed a binomial tree rooted at the master for the reduction:
+     a thread with its k+1 low bits clear reduces the data of the thread 2^k
+     above it, which has reduced its own subtree before signaling round k. */
+  for (round = 0, offset = 1; offset < num_threads; round++, offset <<= 1) {
+    kmp_uint32 to_tid = (tid + num_threads - offset) % num_threads;
+    kmp_uint32 from_tid = (tid + offset) % num_threads;
+    kmp_info_t *to_thr = other_threads[to_tid];
+    kmp_info_t *from_thr = other_threads[from_tid];
+
+    KA_TRACE(20, ("__kmp_dissemination_barrier_gather: T#%d(%d:%d) round %u "
+                  "signaling T#%d(%d:%u) flag(%p)\n",
+                  gtid, team->t.t_id, tid, round,
+                  __kmp_gtid_from_tid(to_tid, team), team->t.t_id, to_tid,
+                  &dissem_bar[to_tid].flags[parity][round]));
+    ANNOTATE_BARRIER_BEGIN(this_thr);
+    kmp_flag_64 to_flag(&dissem_bar[to_tid].flags[parity][round], to_thr);
+    to_flag.release();
+
+    // Wait for the thread above to arrive at this round
+    kmp_flag_64 flag(&thr_bar->flags[parity][round], KMP_BARRIER_STATE_BUMP);
+    flag.wait(this_thr, FALSE USE_ITT_BUILD_ARG(itt_sync_obj));
+    ANNOTATE_BARRIER_END(from_thr);
+    // Not signaled again before this thread arrives at the next barrier
+    thr_bar->flags[parity][round] = KMP_INIT_BARRIER_STATE;
+#if USE_ITT_BUILD && USE_ITT_NOTIFY
+    // Barrier imbalance - write min of the thread time and the partner time to
+    // the thread.
+    if (__kmp_forkjoin_frames_mode == 2) {
+      this_thr->th.th_bar_min_time = KMP_MIN(this_thr->th.th_bar_min_time,
+                                             from_thr->th.th_bar_min_time);
+    }
+#endif
+    if (reduce && (tid & ((offset << 1) - 1)) == 0 &&
+        tid + offset < num_threads) {
+      KA_TRACE(100, ("__kmp_dissemination_barrier_gather: T#%d(%d:%d) += "
+                     "T#%d(%d:%u)\n",
+                     gtid, team->t.t_id, tid,
+                     __kmp_gtid_from_tid(from_tid, team), team->t.t_id,
+                     from_tid));
+      ANNOTATE_REDUCE_AFTER(reduce);
+      (*reduce)(this_thr->th.th_local.reduce_data,
+                from_thr->th.th_local.reduce_data);
+      ANNOTATE_REDUCE_BEFORE(reduce);
+      ANNOTATE_REDUCE_BEFORE(&team->t.t_bar);
+    }
+  }
+  thr_bar->parity = 1 - parity;
+  KA_TRACE(20, ("__kmp_dissemination_barrier_gather: T#%d(%d:%d) exit for "
+                "barrier type %d\n",
+                gtid, team->t.t_id, tid, bt));
+}
+
+/* After a dissemination gather, all the threads know that the others have
+   arrived: they may leave the barrier at once, unless the master has to
+   complete the tasks of the barrier or the reset of a cancellation request
+   first. Every thread makes the same choice, since any task of the barrier was
+   found before the last thread arrived. */
+static bool __kmp_dissemination_barrier_done(enum barrier_type bt,
+                                             kmp_info_t *this_thr, int is_split,
+                                             void (*reduce)(void *, void *)) {
+  kmp_team_t *team = this_thr->th.th_team;
+  kmp_task_team_t *task_team;
+
+  // The data of a thread may be reduced by another thread after it passed all
+  // its rounds, so it must stay in place until the release, split barrier or
+  // not (__kmpc_reduce_nowait returns to the workers right after the barrier);
+  // a fused allreduce also passes its result down.
+  if (reduce)
+    return false;
+  if (team->t.t_bar_config[bt].release_pattern != bp_dissemination_bar ||
+      is_split || __kmp_omp_cancellation || team->t.t_dissem_bar[bt] == NULL)
+    return false;
+  if (__kmp_tasking_mode == tskm_immediate_exec)
+    return true;
+  task_team = team->t.t_task_team[this_thr->th.th_task_state];
+  return task_team == NULL || !KMP_TASKING_ENABLED(task_team);
+}
+
+// Release of a dissemination barrier that could not be left after the gather,
+// and of the fork barrier: the workers wait for the master.
+static void __kmp_dissemination_barrier_release(
+    enum barrier_type bt, kmp_info_t *this_thr, int gtid, int tid,
+    int propagate_icvs USE_ITT_BUILD_ARG(void *itt_sync_obj)) {
+  __kmp_hyper_barrier_release(bt, this_thr, gtid, tid,
+                              propagate_icvs USE_ITT_BUILD_ARG(itt_sync_obj));
+}
+
+// Gather phase of a barrier, with the pattern the team uses for barriers of
+// this type. Returns true if the threads may leave without a release phase.
+static bool __kmp_barrier_gather(enum barrier_type bt, kmp_info_t *this_thr,
+                                 int gtid, int tid, int is_split,
+                                 void (*reduce)(void *, void *)
+                                     USE_ITT_BUILD_ARG(void *itt_sync_obj)) {
+  kmp_bar_config_t *config = &this_thr->th.th_team->t.t_bar_config[bt];
+
+  switch (config->gather_pattern) {
+  case bp_hyper_bar: {
+    // don't set branch bits to 0; use linear
+    KMP_ASSERT(config->gather_bits);
+    __kmp_hyper_barrier_gather(bt, this_thr, gtid, tid,
+                               reduce USE_ITT_BUILD_ARG(itt_sync_obj));
+    break;
+  }
+  case bp_hierarchical_bar: {
+    __kmp_hierarchical_barrier_gather(bt, this_thr, gtid, tid,
+                                      reduce USE_ITT_BUILD_ARG(itt_sync_obj));
+    break;
+  }
+  case bp_tree_bar: {
+    // don't set branch bits to 0; use linear
+    KMP_ASSERT(config->gather_bits);
+    __kmp_tree_barrier_gather(bt, this_thr, gtid, tid,
+                              reduce USE_ITT_BUILD_ARG(itt_sync_obj));
+    break;
+  }
+  case bp_dissemination_bar: {
+    __kmp_dissemination_barrier_gather(bt, this_thr, gtid, tid,
+                                       reduce USE_ITT_BUILD_ARG(itt_sync_obj));
+    return __kmp_dissemination_barrier_done(bt, this_thr, is_split, reduce);
+  }
+  default: {
+    __kmp_linear_barrier_gather(bt, this_thr, gtid, tid,
+                                reduce USE_ITT_BUILD_ARG(itt_sync_obj));
+  }
+  }
+  return false;
+}
+
+// Release phase of a barrier other than the fork barrier, whose workers do
+// not know their team, hence its configuration, before they are released.
+static void __kmp_barrier_release(enum barrier_type bt, kmp_info_t *this_thr,
+                                  int gtid, int tid,
+                                  int propagate_icvs
+                                      USE_ITT_BUILD_ARG(void *itt_sync_obj)) {
+  kmp_bar_config_t *config = &this_thr->th.th_team->t.t_bar_config[bt];
+
+  switch (config->release_pattern) {
+  case bp_hyper_bar: {
+    KMP_ASSERT(config->release_bits);
+    __kmp_hyper_barrier_release(bt, this_thr, gtid, tid,
+                                propagate_icvs USE_ITT_BUILD_ARG(itt_sync_obj));
+    break;
+  }
+  case bp_hierarchical_bar: {
+    __kmp_hierarchical_barrier_release(bt, this_thr, gtid, tid,
+                                       propagate_icvs
+                                           USE_ITT_BUILD_ARG(itt_sync_obj));
+    break;
+  }
+  case bp_tree_bar: {
+    KMP_ASSERT(config->release_bits);
+    __kmp_tree_barrier_release(bt, this_thr, gtid, tid,
+                               propagate_icvs USE_ITT_BUILD_ARG(itt_sync_obj));
+    break;
+  }
+  case bp_dissemination_bar: {
+    __kmp_dissemination_barrier_release(bt, this_thr, gtid, tid,
+                                        propagate_icvs
+                                            USE_ITT_BUILD_ARG(itt_sync_obj));
+    break;
+  }
+  default: {
+    __kmp_linear_barrier_release(bt, this_thr, gtid, tid,
+                                 propagate_icvs
+                                     USE_ITT_BUILD_ARG(itt_sync_obj));
+  }
+  }
+}
+
 // End of Barrier Algorithms
 
 // type traits for cancellable value
@@ -1289,6 +1530,7 @@ static int __kmp_barrier_template(enum barrier_type bt, int gtid, int is_split,
   kmp_team_t *team = this_thr->th.th_team;
   int status = 0;
   is_cancellable<cancellable> cancelled;
+  bool released = false; // left without a release phase
 #if OMPT_SUPPORT && OMPT_OPTIONAL
   ompt_data_t *my_task_data;
   ompt_data_t *my_parallel_data;
@@ -1381,31 +1623,8 @@ static int __kmp_barrier_template(enum barrier_type bt, int gtid, int is_split,
       cancelled = __kmp_linear_barrier_gather_cancellable(
           bt, this_thr, gtid, tid, reduce USE_ITT_BUILD_ARG(itt_sync_obj));
     } else {
-      switch (__kmp_barrier_gather_pattern[bt]) {
-      case bp_hyper_bar: {
-        // don't set branch bits to 0; use linear
-        KMP_ASSERT(__kmp_barrier_gather_branch_bits[bt]);
-        __kmp_hyper_barrier_gather(bt, this_thr, gtid, tid,
-                                   reduce USE_ITT_BUILD_ARG(itt_sync_obj));
-        break;
-      }
-      case bp_hierarchical_bar: {
-        __kmp_hierarchical_barrier_gather(
-            bt, this_thr, gtid, tid, reduce USE_ITT_BUILD_ARG(itt_sync_obj));
-        break;
-      }
-      case bp_tree_bar: {
-        // don't set branch bits to 0; use linear
-        KMP_ASSERT(__kmp_barrier_gather_branch_bits[bt]);
-        __kmp_tree_barrier_gather(bt, this_thr, gtid, tid,
-                                  reduce USE_ITT_BUILD_ARG(itt_sync_obj));
-        break;
-      }
-      default: {
-        __kmp_linear_barrier_gather(bt, this_thr, gtid, tid,
-                                    reduce USE_ITT_BUILD_ARG(itt_sync_obj));
-      }
-      }
+      released = __kmp_barrier_gather(bt, this_thr, gtid, tid, is_split,
+                                      reduce USE_ITT_BUILD_ARG(itt_sync_obj));
     }
 
     KMP_MB();
@@ -1493,29 +1712,9 @@ static int __kmp_barrier_template(enum barrier_type bt, int gtid, int is_split,
         cancelled = __kmp_linear_barrier_release_cancellable(
             bt, this_thr, gtid, tid, FALSE USE_ITT_BUILD_ARG(itt_sync_obj));
       } else {
-        switch (__kmp_barrier_release_pattern[bt]) {
-        case bp_hyper_bar: {
-          KMP_ASSERT(__kmp_barrier_release_branch_bits[bt]);
-          __kmp_hyper_barrier_release(bt, this_thr, gtid, tid,
-                                      FALSE USE_ITT_BUILD_ARG(itt_sync_obj));
-          break;
-        }
-        case bp_hierarchical_bar: {
-          __kmp_hierarchical_barrier_release(
-              bt, this_thr, gtid, tid, FALSE USE_ITT_BUILD_ARG(itt_sync_obj));
-          break;
-        }
-        case bp_tree_bar: {
-          KMP_ASSERT(__kmp_barrier_release_branch_bits[bt]);
-          __kmp_tree_barrier_release(bt, this_thr, gtid, tid,
-                                     FALSE USE_ITT_BUILD_ARG(itt_sync_obj));
-          break;
-        }
-        default: {
-          __kmp_linear_barrier_release(bt, this_thr, gtid, tid,
-                                       FALSE USE_ITT_BUILD_ARG(itt_sync_obj));
-        }
-        }
+        if (!released)
+          __kmp_barrier_release(bt, this_thr, gtid, tid,
+                                FALSE USE_ITT_BUILD_ARG(itt_sync_obj));
       }
       if (__kmp_tasking_mode != tskm_immediate_exec && !cancelled) {
         __kmp_task_team_sync(this_thr, team);
@@ -1623,29 +1822,8 @@ void __kmp_end_split_barrier(enum barrier_type bt, int gtid) {
   ANNOTATE_BARRIER_BEGIN(&team->t.t_bar);
   if (!team->t.t_serialized) {
     if (KMP_MASTER_GTID(gtid)) {
-      switch (__kmp_barrier_release_pattern[bt]) {
-      case bp_hyper_bar: {
-        KMP_ASSERT(__kmp_barrier_release_branch_bits[bt]);
-        __kmp_hyper_barrier_release(bt, this_thr, gtid, tid,
-                                    FALSE USE_ITT_BUILD_ARG(NULL));
-        break;
-      }
-      case bp_hierarchical_bar: {
-        __kmp_hierarchical_barrier_release(bt, this_thr, gtid, tid,
-                                           FALSE USE_ITT_BUILD_ARG(NULL));
-        break;
-      }
-      case bp_tree_bar: {
-        KMP_ASSERT(__kmp_barrier_release_branch_bits[bt]);
-        __kmp_tree_barrier_release(bt, this_thr, gtid, tid,
-                                   FALSE USE_ITT_BUILD_ARG(NULL));
-        break;
-      }
-      default: {
-        __kmp_linear_barrier_release(bt, this_thr, gtid, tid,
-                                     FALSE USE_ITT_BUILD_ARG(NULL));
-      }
-      }
+      __kmp_barrier_release(bt, this_thr, gtid, tid,
+                            FALSE USE_ITT_BUILD_ARG(NULL));
       if (__kmp_tasking_mode != tskm_immediate_exec) {
         __kmp_task_team_sync(this_thr, team);
       } // if
@@ -1654,6 +1832,340 @@ void __kmp_end_split_barrier(enum barrier_type bt, int gtid) {
   ANNOTATE_BARRIER_END(&team->t.t_bar);
 }
 
+/* Split-phase plain barrier. The arrival is the worker half of a linear gather,
+   which only bumps the b_arrived flag of the thread: the tree, hyper and
+   hierarchical gathers would have it wait for its children. The master only
+   sets up the task team of the next barrier, and collects the workers in
+   __kmp_barrier_wait(). Tasks created until a thread waits belong to the task
+   team of this barrier, and are all completed before the release: the workers
+   arrive a second time when they wait, and the master checks the task team for
+   completion only once they all did, since a task created in between may be
+   the one enabling tasking. Returns the token to pass to __kmp_barrier_wait(). */
+kmp_int32 __kmp_barrier_arrive(int gtid) {
+  KMP_SET_THREAD_STATE_BLOCK(PLAIN_BARRIER);
+  int tid = __kmp_tid_from_gtid(gtid);
+  kmp_info_t *this_thr = __kmp_threads[gtid];
+  kmp_team_t *team = this_thr->th.th_team;
+  kmp_bstate_t *thr_bar = &this_thr->th.th_bar[bs_plain_barrier].bb;
+
+  KA_TRACE(15, ("__kmp_barrier_arrive: T#%d(%d:%d) has arrived\n", gtid,
+                team->t.t_id, tid));
+  // __kmp_barrier_wait() does the whole barrier
+  if (team->t.t_serialized || __kmp_tasking_mode == tskm_extra_barrier)
+    return 0;
+  if (KMP_MASTER_TID(tid)) {
+    if (__kmp_tasking_mode != tskm_immediate_exec)
+      // use 0 to only setup the current team if nthreads > 1
+      __kmp_task_team_setup(this_thr, team, 0);
+    return (kmp_int32)(team->t.t_bar[bs_plain_barrier].b_arrived +
+                       KMP_BARRIER_STATE_BUMP);
+  }
+  __kmp_linear_barrier_gather(bs_plain_barrier, this_thr, gtid, tid,
+                              NULL USE_ITT_BUILD_ARG(NULL));
+  return (kmp_int32)thr_bar->b_arrived;
+}
+
+void __kmp_barrier_wait(int gtid, kmp_int32 token) {
+  KMP_TIME_PARTITIONED_BLOCK(OMP_plain_barrier);
+  KMP_SET_THREAD_STATE_BLOCK(PLAIN_BARRIER);
+  int tid = __kmp_tid_from_gtid(gtid);
+  kmp_info_t *this_thr = __kmp_threads[gtid];
+  kmp_team_t *team = this_thr->th.th_team;
+
+  KA_TRACE(15, ("__kmp_barrier_wait: T#%d(%d:%d) token %d\n", gtid,
+                team->t.t_id, tid, token));
+  if (team->t.t_serialized || __kmp_tasking_mode == tskm_extra_barrier) {
+    __kmp_barrier(bs_plain_barrier, gtid, FALSE, 0, NULL, NULL);
+    return;
+  }
+  // See the note in __kmp_barrier_template()
+  if (__kmp_dflt_blocktime != KMP_MAX_BLOCKTIME) {
+#if KMP_USE_MONITOR
+    this_thr->th.th_team_bt_intervals =
+        team->t.t_implicit_task_taskdata[tid].td_icvs.bt_intervals;
+    this_thr->th.th_team_bt_set =
+        team->t.t_implicit_task_taskdata[tid].td_icvs.bt_set;
+#else
+    this_thr->th.th_team_bt_intervals = KMP_BLOCKTIME_INTERVAL(team, tid);
+#endif
+  }
+
+  ANNOTATE_BARRIER_BEGIN(&team->t.t_bar);
+  if (KMP_MASTER_TID(tid)) {
+    KMP_DEBUG_ASSERT(token ==
+                     (kmp_int32)(team->t.t_bar[bs_plain_barrier].b_arrived +
+                                 KMP_BARRIER_STATE_BUMP));
+    // Only collect the second arrivals: a worker may already have bumped its
+    // flag twice, and the gather waits for an exact value
+    team->t.t_bar[bs_plain_barrier].b_arrived += KMP_BARRIER_STATE_BUMP;
+    __kmp_linear_barrier_gather(bs_plain_barrier, this_thr, gtid, tid,
+                                NULL USE_ITT_BUILD_ARG(NULL));
+    KMP_MB();
+    if (__kmp_tasking_mode != tskm_immediate_exec)
+      __kmp_task_team_wait(this_thr, team USE_ITT_BUILD_ARG(NULL));
+    if (__kmp_omp_cancellation) {
+      kmp_int32 cancel_request = KMP_ATOMIC_LD_RLX(&team->t.t_cancel_request);
+      // Reset cancellation flag for worksharing constructs
+      if (cancel_request == cancel_loop || cancel_request == cancel_sections)
+        KMP_ATOMIC_ST_RLX(&team->t.t_cancel_request, cancel_noreq);
+    }
+  } else {
+    KMP_DEBUG_ASSERT(token == (kmp_int32)this_thr->th.th_bar[bs_plain_barrier]
+                                  .bb.b_arrived);
+    __kmp_linear_barrier_gather(bs_plain_barrier, this_thr, gtid, tid,
+                                NULL USE_ITT_BUILD_ARG(NULL));
+  }
+  __kmp_barrier_release(bs_plain_barrier, this_thr, gtid, tid,
+                        FALSE USE_ITT_BUILD_ARG(NULL));
+  if (__kmp_tasking_mode != tskm_immediate_exec)
+    __kmp_task_team_sync(this_thr, team);
+  ANNOTATE_BARRIER_END(&team->t.t_bar);
+  KA_TRACE(15, ("__kmp_barrier_wait: T#%d(%d:%d) is leaving\n", gtid,
+                team->t.t_id, tid));
+}
+
+// Sub-team barriers
+static kmp_subteam_barrier_t *__kmp_subteam_barrier_alloc(kmp_info_t *this_thr,
+                                                          kmp_int32 nmembers) {
+  kmp_subteam_barrier_t *bar;
+  int nproc = this_thr->th.th_team_nproc;
+  int tid;
+
+  bar = (kmp_subteam_barrier_t *)__kmp_allocate(sizeof(kmp_subteam_barrier_t));
+  bar->sb_team = this_thr->th.th_team;
+  bar->sb_nproc = nproc;
+  bar->sb_levels = __kmp_get_hierarchy_skips(nproc, bar->sb_skips,
+                                             KMP_SUBTEAM_BAR_LEVELS);
+  bar->sb_members = (kmp_int32 *)__kmp_allocate(nmembers * sizeof(kmp_int32));
+  bar->sb_threads = (kmp_subteam_bstate_t *)__kmp_allocate(
+      nproc * sizeof(kmp_subteam_bstate_t));
+  for (tid = 0; tid < nproc; ++tid)
+    bar->sb_threads[tid].pos = -1;
+  return bar;
+}
+
+/* Barrier of the nthreads threads of the team of the caller whose tids are in
+   tids, in the order of their positions in the tree. The other threads of the
+   team must not pass it. */
+kmp_subteam_barrier_t *__kmp_subteam_barrier_create(int gtid,
+                                                    kmp_int32 nthreads,
+                                                    const kmp_int32 *tids) {
+  kmp_info_t *this_thr = __kmp_threads[gtid];
+  kmp_subteam_barrier_t *bar;
+  int i;
+
+  KMP_ASSERT2(nthreads > 0 && nthreads <= this_thr->th.th_team_nproc,
+              "sub-team barrier larger than the team");
+  bar = __kmp_subteam_barrier_alloc(this_thr, nthreads);
+  for (i = 0; i < nthreads; ++i) {
+    kmp_int32 tid = tids[i];
+    KMP_ASSERT2(tid >= 0 && tid < bar->sb_nproc &&
+                    bar->sb_threads[tid].pos < 0,
+                "sub-team barrier thread not in the team or duplicated");
+    bar->sb_members[i] = tid;
+    bar->sb_threads[tid].pos = i;
+    bar->sb_threads[tid].first = 0;
+    bar->sb_threads[tid].size = nthreads;
+  }
+  KA_TRACE(20, ("__kmp_subteam_barrier_create: T#%d barrier %p of %d threads "
+                "of team %d\n",
+                gtid, bar, nthreads, bar->sb_team->t.t_id));
+  return bar;
+}
+
+/* Barriers of the groups of threads of the team of the caller that share a
+   subtree of the given level of the machine hierarchy, as the hierarchical
+   barrier sees it: consecutive tids, assuming a compact placement. Every
+   thread of the team passes the barrier of its group. */
+kmp_subteam_barrier_t *__kmp_subteam_barrier_create_level(int gtid,
+                                                          int level) {
+  kmp_info_t *this_thr = __kmp_threads[gtid];
+  kmp_subteam_barrier_t *bar;
+  kmp_int32 width;
+  int tid;
+
+  KMP_ASSERT2(level >= 0, "negative sub-team barrier level");
+  bar = __kmp_subteam_barrier_alloc(this_thr, this_thr->th.th_team_nproc);
+  width = level < bar->sb_levels ? (kmp_int32)bar->sb_skips[level]
+                                 : bar->sb_nproc;
+  for (tid = 0; tid < bar->sb_nproc; ++tid) {
+    kmp_int32 first = tid - tid % width;
+    bar->sb_members[tid] = tid;
+    bar->sb_threads[tid].pos = tid - first;
+    bar->sb_threads[tid].first = first;
+    bar->sb_threads[tid].size = KMP_MIN(width, bar->sb_nproc - first);
+  }
+  KA_TRACE(20, ("__kmp_subteam_barrier_create_level: T#%d barrier %p of "
+                "level %d, groups of %d threads of team %d\n",
+                gtid, bar, level, width, bar->sb_team->t.t_id));
+  return bar;
+}
+
+/* In the group of the thread, the members at positions multiple of the span
+   of a level (the width of a subtree of the level above) gather the members
+   of their subtree at the positions multiple of the width of a subtree of the
+   level, from the leaves up, and release them in the reverse order. */
+void __kmp_subteam_barrier(int gtid, kmp_subteam_barrier_t *bar) {
+  KMP_TIME_PARTITIONED_BLOCK(OMP_plain_barrier);
+  KMP_SET_THREAD_STATE_BLOCK(PLAIN_BARRIER);
+  int tid = __kmp_tid_from_gtid(gtid);
+  kmp_info_t *this_thr = __kmp_threads[gtid];
+  kmp_team_t *team = this_thr->th.th_team;
+  kmp_info_t **other_threads = team->t.t_threads;
+  kmp_subteam_bstate_t *thr_bar = &bar->sb_threads[tid];
+  kmp_int32 *members = &bar->sb_members[thr_bar->first];
+  kmp_int32 pos = thr_bar->pos;
+  kmp_int32 n = thr_bar->size;
+  kmp_int32 parent = 0;
+  kmp_uint64 new_state, go_state;
+  int level, top;
+
+  KMP_ASSERT2(team == bar->sb_team &&
+                  this_thr->th.th_team_nproc == bar->sb_nproc && pos >= 0,
+              "sub-team barrier passed by a thread outside of its groups");
+  KA_TRACE(20, ("__kmp_subteam_barrier: T#%d(%d:%d) enter barrier %p at "
+                "position %d of %d\n",
+                gtid, team->t.t_id, tid, bar, pos, n));
+  if (n == 1)
+    return;
+  // See the note in __kmp_barrier_template()
+  if (__kmp_dflt_blocktime != KMP_MAX_BLOCKTIME) {
+#if KMP_USE_MONITOR
+    this_thr->th.th_team_bt_intervals =
+        team->t.t_implicit_task_taskdata[tid].td_icvs.bt_intervals;
+    this_thr->th.th_team_bt_set =
+        team->t.t_implicit_task_taskdata[tid].td_icvs.bt_set;
+#else
+    this_thr->th.th_team_bt_intervals = KMP_BLOCKTIME_INTERVAL(team, tid);
+#endif
+  }
+
+  // The parent may already be sleeping on the b_arrived flag of the thread
+  new_state = (thr_bar->b_arrived & ~(kmp_uint64)KMP_BARRIER_SLEEP_STATE) +
+              KMP_BARRIER_STATE_BUMP;
+  // Read before arriving: the parent may release the thread at once
+  go_state = thr_bar->b_go + KMP_BARRIER_STATE_BUMP;
+  for (level = 0; level < bar->sb_levels; ++level) {
+    kmp_int32 skip = bar->sb_skips[level];
+    kmp_int32 span =
+        level + 1 < bar->sb_levels ? (kmp_int32)bar->sb_skips[level + 1] : n;
+    kmp_int32 child;
+    if (skip >= n)
+      break;
+    if (pos % span) {
+      parent = pos - pos % span;
+      break;
+    }
+    for (child = pos + skip; child < pos + span && child < n; child += skip) {
+      KA_TRACE(20, ("__kmp_subteam_barrier: T#%d(%d:%d) wait T#%d(%d:%d) "
+                    "arrived(%p) == %llu\n",
+                    gtid, team->t.t_id, tid,
+                    __kmp_gtid_from_tid(members[child], team), team->t.t_id,
+                    members[child], &bar->sb_threads[members[child]].b_arrived,
+                    new_state));
+      kmp_flag_64 flag(&bar->sb_threads[members[child]].b_arrived, new_state);
+      flag.wait(this_thr, FALSE USE_ITT_BUILD_ARG(NULL));
+    }
+  }
+  top = level;
+
+  if (pos != 0) {
+    kmp_flag_64 arrived(&thr_bar->b_arrived, other_threads[members[parent]]);
+    arrived.release();
+    kmp_flag_64 go(&thr_bar->b_go, go_state);
+    go.wait(this_thr, FALSE USE_ITT_BUILD_ARG(NULL));
+  } else {
+    thr_bar->b_arrived = new_state;
+  }
+
+  for (level = top - 1; level >= 0; --level) {
+    kmp_int32 skip = bar->sb_skips[level];
+    kmp_int32 span =
+        level + 1 < bar->sb_levels ? (kmp_int32)bar->sb_skips[level + 1] : n;
+    kmp_int32 child;
+    for (child = pos + skip; child < pos + span && child < n; child += skip) {
+      kmp_flag_64 flag(&bar->sb_threads[members[child]].b_go,
+                       other_threads[members[child]]);
+      flag.release();
+    }
+  }
+  KA_TRACE(20, ("__kmp_subteam_barrier: T#%d(%d:%d) exit barrier %p\n", gtid,
+                team->t.t_id, tid, bar));
+}
+
+// No thread may be passing the barrier any more
+void __kmp_subteam_barrier_destroy(kmp_subteam_barrier_t *bar) {
+  __kmp_free(bar->sb_threads);
+  __kmp_free(bar->sb_members);
+  __kmp_free(bar);
+}
+
+// Fused allreduce: the lanes past the data are zero, so that the combiners
+// always work on the whole line with a loop of fixed length
+template <typename T, kmp_allreduce_op_t op>
+static void __kmp_allreduce_combine(void *lhs_data, void *rhs_data) {
+  T *lhs = (T *)lhs_data;
+  T *rhs = (T *)rhs_data;
+  size_t i;
+
+  for (i = 0; i < KMP_ALLREDUCE_SIZE / sizeof(T); ++i) {
+    if (op == kmp_allreduce_sum)
+      lhs[i] += rhs[i];
+    else if (op == kmp_allreduce_min)
+      lhs[i] = rhs[i] < lhs[i] ? rhs[i] : lhs[i];
+    else
+      lhs[i] = rhs[i] > lhs[i] ? rhs[i] : lhs[i];
+  }
+}
+
+#define KMP_ALLREDUCE_COMBINERS(T)                                             \
+  {                                                                            \
+    __kmp_allreduce_combine<T, kmp_allreduce_sum>,                             \
+        __kmp_allreduce_combine<T, kmp_allreduce_min>,                         \
+        __kmp_allreduce_combine<T, kmp_allreduce_max>                          \
+  }
+
+static void (*const __kmp_allreduce_combiners[kmp_allreduce_last_type]
+                                             [kmp_allreduce_last_op])(void *,
+                                                                      void *) =
+    {KMP_ALLREDUCE_COMBINERS(kmp_int32), KMP_ALLREDUCE_COMBINERS(kmp_int64),
+     KMP_ALLREDUCE_COMBINERS(kmp_real32), KMP_ALLREDUCE_COMBINERS(kmp_real64)};
+
+static const size_t __kmp_allreduce_type_size[kmp_allreduce_last_type] = {
+    sizeof(kmp_int32), sizeof(kmp_int64), sizeof(kmp_real32),
+    sizeof(kmp_real64)};
+
+#undef KMP_ALLREDUCE_COMBINERS
+
+/* Called by all the threads of the team, each with count values in data, that
+   it replaces with the reduction of the values of all the threads. The values
+   are combined in the barrier states of the threads during the gather of a
+   reduction barrier, and the result is pushed down to them in the release. */
+void __kmp_allreduce(int gtid, void *data, kmp_int32 count,
+                     kmp_allreduce_type_t type, kmp_allreduce_op_t op) {
+  kmp_info_t *this_thr = __kmp_threads[gtid];
+  kmp_bstate_t *thr_bar = &this_thr->th.th_bar[bs_reduction_barrier].bb;
+  size_t size;
+
+  KMP_ASSERT2(type >= 0 && type < kmp_allreduce_last_type && op >= 0 &&
+                  op < kmp_allreduce_last_op,
+              "unknown allreduce type or operation");
+  size = (size_t)count * __kmp_allreduce_type_size[type];
+  KMP_ASSERT2(count >= 0 && size <= KMP_ALLREDUCE_SIZE,
+              "allreduce data larger than KMP_ALLREDUCE_SIZE");
+  KA_TRACE(20, ("__kmp_allreduce: T#%d %d values of type %d, op %d\n", gtid,
+                count, type, op));
+
+  KMP_MEMCPY(thr_bar->b_allreduce, data, size);
+  memset((char *)thr_bar->b_allreduce + size, 0, KMP_ALLREDUCE_SIZE - size);
+  thr_bar->allreduce = TRUE;
+  // A serialized team leaves the thread's values in place
+  __kmp_barrier(bs_reduction_barrier, gtid, FALSE, KMP_ALLREDUCE_SIZE,
+                thr_bar->b_allreduce, __kmp_allreduce_combiners[type][op]);
+  thr_bar->allreduce = FALSE;
+  KMP_MEMCPY(data, thr_bar->b_allreduce, size);
+}
+
 void __kmp_join_barrier(int gtid) {
   KMP_TIME_PARTITIONED_BLOCK(OMP_join_barrier);
   KMP_SET_THREAD_STATE_BLOCK(FORK_JOIN_BARRIER);
@@ -1770,6 +2282,9 @@ void __kmp_join_barrier(int gtid) {
 #endif /* USE_ITT_BUILD */
 
   switch (__kmp_barrier_gather_pattern[bs_forkjoin_barrier]) {
+  case bp_dissemination_bar:
+  // The workers may not touch the team after the join gather, while the
+  // partners of a dissemination round may still be signaling them
   case bp_hyper_bar: {
     KMP_ASSERT(__kmp_barrier_gather_branch_bits[bs_forkjoin_barrier]);
     __kmp_hyper_barrier_gather(bs_forkjoin_barrier, this_thr, gtid, tid,
@@ -1977,6 +2492,12 @@ void __kmp_fork_barrier(int gtid, int tid) {
                                TRUE USE_ITT_BUILD_ARG(itt_sync_obj));
     break;
   }
+  case bp_dissemination_bar: {
+    __kmp_dissemination_barrier_release(bs_forkjoin_barrier, this_thr, gtid,
+                                        tid,
+                                        TRUE USE_ITT_BUILD_ARG(itt_sync_obj));
+    break;
+  }
   default: {
     __kmp_linear_barrier_release(bs_forkjoin_barrier, this_thr, gtid, tid,
                                  TRUE USE_ITT_BUILD_ARG(itt_sync_obj));
@@ -2159,3 +2680,299 @@ void __kmp_setup_icv_copy(kmp_team_t *team, int new_nproc,
   ngo_sync();
 #endif // KMP_BARRIER_ICV_PULL
 }
+
+// Barrier auto-tuning
+/* With KMP_BARRIER_AUTOTUNE, the patterns and branch bits of the plain and
+   reduction barriers are chosen per team size: the first team of a size
+   measures a few candidates when it starts, and the fastest one is kept in
+   __kmp_bar_tuning for the later teams of this size. The winners are appended
+   to KMP_BARRIER_AUTOTUNE_FILE, if set, and read back at the first lookup, so
+   that later runs start tuned. A line of the file holds the barrier type, the
+   team size, the gather and release patterns and their branch bits, e.g.
+   "plain 8 hyper hyper 2 2"; a later line for the same type and size
+   overrides an earlier one. */
+typedef struct kmp_bar_tuning {
+  kmp_uint8 tuned;
+  kmp_uint8 gather_pattern;
+  kmp_uint8 release_pattern;
+  kmp_uint8 gather_bits;
+  kmp_uint8 release_bits;
+} kmp_bar_tuning_t;
+
+// Tuned values per team size and barrier type, grown under the lock
+static kmp_bar_tuning_t (*__kmp_bar_tuning)[bs_last_barrier] = NULL;
+static int __kmp_bar_tuning_size = 0;
+static int __kmp_bar_tuning_loaded = FALSE;
+static kmp_bootstrap_lock_t __kmp_bar_tuning_lock =
+    KMP_BOOTSTRAP_LOCK_INITIALIZER(__kmp_bar_tuning_lock);
+
+/* Candidates of the calibration, with the same pattern and branch bits for
+   both phases. The hierarchical barrier keeps its own per-thread state, so a
+   team cannot switch to or from it between two barriers. */
+static const kmp_uint8 __kmp_bar_candidates[][2] = {
+    {bp_linear_bar, 0}, {bp_tree_bar, 1},  {bp_tree_bar, 2},
+    {bp_tree_bar, 3},   {bp_hyper_bar, 1}, {bp_hyper_bar, 2},
+    {bp_hyper_bar, 3},  {bp_dissemination_bar, 2}};
+#define KMP_BAR_CANDIDATES                                                     \
+  (int)(sizeof(__kmp_bar_candidates) / sizeof(__kmp_bar_candidates[0]))
+#define KMP_BAR_CALIBRATE_REPEATS 3
+#define KMP_BAR_CALIBRATE_BARRIERS 50
+
+// Returns the tuned values of a team size, growing the table if needed.
+// Must be called with __kmp_bar_tuning_lock held.
+static kmp_bar_tuning_t *__kmp_bar_tuning_entry(int nproc) {
+  if (nproc >= __kmp_bar_tuning_size) {
+    int size = KMP_MAX(nproc + 1, 2 * __kmp_bar_tuning_size);
+    kmp_bar_tuning_t(*table)[bs_last_barrier] =
+        (kmp_bar_tuning_t(*)[bs_last_barrier])__kmp_allocate(
+            size * sizeof(*table));
+    if (__kmp_bar_tuning != NULL) {
+      KMP_MEMCPY(table, __kmp_bar_tuning,
+                 __kmp_bar_tuning_size * sizeof(*table));
+      __kmp_free(__kmp_bar_tuning);
+    }
+    __kmp_bar_tuning = table;
+    __kmp_bar_tuning_size = size;
+  }
+  return __kmp_bar_tuning[nproc];
+}
+
+static int __kmp_bar_tuning_pattern(char const *name) {
+  int p;
+  for (p = bp_linear_bar; p < bp_last_bar; ++p) {
+    if (p != bp_hierarchical_bar &&
+        __kmp_str_eqf(name, __kmp_barrier_pattern_name[p]))
+      return p;
+  }
+  return -1;
+}
+
+// Reads the tuned values persisted by earlier runs; lines that do not parse
+// are skipped. Must be called with __kmp_bar_tuning_lock held.
+static void __kmp_bar_tuning_load(void) {
+  char line[256];
+  FILE *f;
+
+  __kmp_bar_tuning_loaded = TRUE;
+  if (__kmp_barrier_autotune_file == NULL)
+    return;
+  f = fopen(__kmp_barrier_autotune_file, "r");
+  if (f == NULL) // Nothing tuned yet
+    return;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    char *buf;
+    char *token[6];
+    int i, bt, nproc, gather, release, gather_bits, release_bits;
+
+    token[0] = __kmp_str_token(line, " \t\r\n", &buf);
+    for (i = 1; i < 6 && token[i - 1] != NULL; ++i)
+      token[i] = __kmp_str_token(NULL, " \t\r\n", &buf);
+    if (i < 6 || token[5] == NULL || token[0][0] == '#')
+      continue;
+    for (bt = 0; bt < bs_last_barrier; ++bt) {
+      if (__kmp_str_eqf(token[0], __kmp_barrier_type_name[bt]))
+        break;
+    }
+    nproc = atoi(token[1]);
+    gather = __kmp_bar_tuning_pattern(token[2]);
+    release = __kmp_bar_tuning_pattern(token[3]);
+    gather_bits = atoi(token[4]);
+    release_bits = atoi(token[5]);
+    if (bt == bs_last_barrier || bt == bs_forkjoin_barrier || nproc < 2 ||
+        nproc > __kmp_sys_max_nth || gather < 0 || release < 0 ||
+        gather_bits < 0 || gather_bits > KMP_MAX_BRANCH_BITS ||
+        release_bits < 0 || release_bits > KMP_MAX_BRANCH_BITS ||
+        (gather != bp_linear_bar && gather_bits == 0) ||
+        (release != bp_linear_bar && release_bits == 0))
+      continue;
+    kmp_bar_tuning_t *tuning = &__kmp_bar_tuning_entry(nproc)[bt];
+    tuning->tuned = TRUE;
+    tuning->gather_pattern = (kmp_uint8)gather;
+    tuning->release_pattern = (kmp_uint8)release;
+    tuning->gather_bits = (kmp_uint8)gather_bits;
+    tuning->release_bits = (kmp_uint8)release_bits;
+  }
+  fclose(f);
+}
+
+// Records the winner of a calibration, and persists it if a file is set
+static void __kmp_bar_tuning_save(enum barrier_type bt, int nproc,
+                                  kmp_bar_config_t *config) {
+  __kmp_acquire_bootstrap_lock(&__kmp_bar_tuning_lock);
+  kmp_bar_tuning_t *tuning = &__kmp_bar_tuning_entry(nproc)[bt];
+  tuning->tuned = TRUE;
+  tuning->gather_pattern = config->gather_pattern;
+  tuning->release_pattern = config->release_pattern;
+  tuning->gather_bits = config->gather_bits;
+  tuning->release_bits = config->release_bits;
+  if (__kmp_barrier_autotune_file != NULL) {
+    FILE *f = fopen(__kmp_barrier_autotune_file, "a");
+    if (f != NULL) {
+      fprintf(f, "%s %d %s %s %d %d\n", __kmp_barrier_type_name[bt], nproc,
+              __kmp_barrier_pattern_name[config->gather_pattern],
+              __kmp_barrier_pattern_name[config->release_pattern],
+              config->gather_bits, config->release_bits);
+      fclose(f);
+    } else {
+      int code = errno;
+      __kmp_msg(kmp_ms_warning,
+                KMP_MSG(CantOpenFileForWriting, __kmp_barrier_autotune_file),
+                KMP_ERR(code), __kmp_msg_null);
+      // Warn once; the tuned values are kept for this run only
+      __kmp_str_free(&__kmp_barrier_autotune_file);
+    }
+  }
+  __kmp_release_bootstrap_lock(&__kmp_bar_tuning_lock);
+}
+
+/* Called by the master before it releases the workers of a team: sets the
+   patterns and branch bits of the team's barriers from the settings or from
+   the values tuned for the team size. A team of a size not tuned yet uses the
+   settings, and is calibrated by __kmp_barrier_calibrate() when it starts. */
+void __kmp_setup_barrier_patterns(kmp_team_t *team) {
+  int nproc = team->t.t_nproc;
+  int autotune = __kmp_barrier_autotune && nproc > 1 &&
+                 team->t.t_invoke == __kmp_invoke_task_func;
+  int bt;
+
+  for (bt = 0; bt < bs_last_barrier; ++bt) {
+    kmp_bar_config_t *config = &team->t.t_bar_config[bt];
+    if (!autotune || bt == bs_forkjoin_barrier ||
+        __kmp_barrier_gather_pattern[bt] == bp_hierarchical_bar ||
+        __kmp_barrier_release_pattern[bt] == bp_hierarchical_bar) {
+      KMP_CHECK_UPDATE(config->gather_pattern,
+                       (kmp_uint8)__kmp_barrier_gather_pattern[bt]);
+      KMP_CHECK_UPDATE(config->release_pattern,
+                       (kmp_uint8)__kmp_barrier_release_pattern[bt]);
+      KMP_CHECK_UPDATE(config->gather_bits,
+                       (kmp_uint8)__kmp_barrier_gather_branch_bits[bt]);
+      KMP_CHECK_UPDATE(config->release_bits,
+                       (kmp_uint8)__kmp_barrier_release_branch_bits[bt]);
+      KMP_CHECK_UPDATE(config->tuned_nproc, 0);
+      KMP_CHECK_UPDATE(config->calibrate, 0);
+      continue;
+    }
+    if (config->tuned_nproc == nproc)
+      continue; // Same team size as the previous region of this team
+    __kmp_acquire_bootstrap_lock(&__kmp_bar_tuning_lock);
+    if (!__kmp_bar_tuning_loaded)
+      __kmp_bar_tuning_load();
+    kmp_bar_tuning_t *tuning = &__kmp_bar_tuning_entry(nproc)[bt];
+    if (tuning->tuned) {
+      config->gather_pattern = tuning->gather_pattern;
+      config->release_pattern = tuning->release_pattern;
+      config->gather_bits = tuning->gather_bits;
+      config->release_bits = tuning->release_bits;
+      config->calibrate = 0;
+    } else {
+      config->gather_pattern = (kmp_uint8)__kmp_barrier_gather_pattern[bt];
+      config->release_pattern = (kmp_uint8)__kmp_barrier_release_pattern[bt];
+      config->gather_bits = (kmp_uint8)__kmp_barrier_gather_branch_bits[bt];
+      config->release_bits = (kmp_uint8)__kmp_barrier_release_branch_bits[bt];
+      config->calibrate = 1;
+    }
+    __kmp_release_bootstrap_lock(&__kmp_bar_tuning_lock);
+    config->tuned_nproc = nproc;
+    KA_TRACE(10, ("__kmp_setup_barrier_patterns: team %d %s barrier of %d "
+                  "threads: %s,%s branch bits %u,%u%s\n",
+                  team->t.t_id, __kmp_barrier_type_name[bt], nproc,
+                  __kmp_barrier_pattern_name[config->gather_pattern],
+                  __kmp_barrier_pattern_name[config->release_pattern],
+                  config->gather_bits, config->release_bits,
+                  config->calibrate ? ", to calibrate" : ""));
+  }
+}
+
+// All the threads of the team meet with a linear barrier, while the master
+// sets the pattern and branch bits to use next.
+static void __kmp_bar_calibrate_step(enum barrier_type bt, kmp_info_t *this_thr,
+                                     int gtid, int tid, int pattern,
+                                     int bits) {
+  kmp_bar_config_t *config = &this_thr->th.th_team->t.t_bar_config[bt];
+
+  __kmp_linear_barrier_gather(bt, this_thr, gtid, tid,
+                              NULL USE_ITT_BUILD_ARG(NULL));
+  if (KMP_MASTER_TID(tid)) {
+    config->gather_pattern = config->release_pattern = (kmp_uint8)pattern;
+    config->gather_bits = config->release_bits = (kmp_uint8)bits;
+  }
+  __kmp_linear_barrier_release(bt, this_thr, gtid, tid,
+                               FALSE USE_ITT_BUILD_ARG(NULL));
+}
+
+/* Called by all the threads of a team before they invoke the microtask: for
+   each barrier type whose values are not tuned for the team size yet, runs a
+   short series of barriers with each candidate, and keeps the one for which
+   the master saw the shortest series. */
+void __kmp_barrier_calibrate(int gtid) {
+  KMP_TIME_DEVELOPER_PARTITIONED_BLOCK(KMP_barrier_calibrate);
+  kmp_info_t *this_thr = __kmp_threads[gtid];
+  kmp_team_t *team = this_thr->th.th_team;
+  kmp_task_team_t *task_team = this_thr->th.th_task_team;
+  int tid = __kmp_tid_from_gtid(gtid);
+  int bt;
+
+  // These barriers have no task team of their own: the threads must not run
+  // the tasks of the first threads to leave, nor check out of the task team
+  // of the next barrier in the final spin of the releases.
+  this_thr->th.th_task_team = NULL;
+  for (bt = 0; bt < bs_last_barrier; ++bt) {
+    kmp_bar_config_t *config = &team->t.t_bar_config[bt];
+    double best_time = 0.0;
+    int best = -1;
+    int c;
+
+    if (!config->calibrate)
+      continue;
+    for (c = 0; c < KMP_BAR_CANDIDATES; ++c) {
+      int pattern = __kmp_bar_candidates[c][0];
+      double time = 0.0;
+      int r, i;
+      if (pattern == bp_dissemination_bar &&
+          team->t.t_dissem_bar[bt] == NULL)
+        continue;
+      __kmp_bar_calibrate_step((enum barrier_type)bt, this_thr, gtid, tid,
+                               pattern, __kmp_bar_candidates[c][1]);
+      for (r = 0; r < KMP_BAR_CALIBRATE_REPEATS; ++r) {
+        double start, stop;
+        __kmp_elapsed(&start);
+        for (i = 0; i < KMP_BAR_CALIBRATE_BARRIERS; ++i) {
+          if (!__kmp_barrier_gather((enum barrier_type)bt, this_thr, gtid,
+                                    tid, FALSE, NULL USE_ITT_BUILD_ARG(NULL)))
+            __kmp_barrier_release((enum barrier_type)bt, this_thr, gtid, tid,
+                                  FALSE USE_ITT_BUILD_ARG(NULL));
+        }
+        __kmp_elapsed(&stop);
+        if (r == 0 || stop - start < time)
+          time = stop - start;
+      }
+      KA_TRACE(10, ("__kmp_barrier_calibrate: T#%d(%d:%d) %s barrier %s "
+                    "branch bits %u: %g s\n",
+                    gtid, team->t.t_id, tid, __kmp_barrier_type_name[bt],
+                    __kmp_barrier_pattern_name[pattern],
+                    __kmp_bar_candidates[c][1], time));
+      if (best < 0 || time < best_time) {
+        best = c;
+        best_time = time;
+      }
+    }
+    // Only the master's choice counts: the workers leave it at the step
+    __kmp_bar_calibrate_step((enum barrier_type)bt, this_thr, gtid, tid,
+                             __kmp_bar_candidates[best][0],
+                             __kmp_bar_candidates[best][1]);
+    if (KMP_MASTER_TID(tid)) {
+      config->calibrate = 0;
+      __kmp_bar_tuning_save((enum barrier_type)bt, team->t.t_nproc, config);
+    }
+  }
+  this_thr->th.th_task_team = task_team;
+}
+
+void __kmp_cleanup_barrier_tuning(void) {
+  if (__kmp_bar_tuning != NULL) {
+    __kmp_free(__kmp_bar_tuning);
+    __kmp_bar_tuning = NULL;
+  }
+  __kmp_bar_tuning_size = 0;
+  __kmp_bar_tuning_loaded = FALSE;
+}
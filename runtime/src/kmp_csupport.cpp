@@ -754,6 +754,133 @@ void __kmpc_barrier(ident_t *loc, kmp_int32 global_tid) {
 #endif
 }
 
+/*!
+@ingroup SYNCHRONIZATION
+@param loc source location information
+@param global_tid thread id.
+@return token to pass to @ref __kmpc_barrier_wait
+
+Arrive at a split-phase barrier without waiting for the other threads. The
+thread may go on with work that does not depend on them, until it completes
+the barrier with @ref __kmpc_barrier_wait. No other barrier, worksharing
+construct or taskwait may be encountered in between, but tasks created in
+between are completed before any thread leaves the barrier.
+*/
+kmp_int32 __kmpc_barrier_arrive(ident_t *loc, kmp_int32 global_tid) {
+  KMP_COUNT_BLOCK(OMP_BARRIER);
+  KC_TRACE(10, ("__kmpc_barrier_arrive: called T#%d\n", global_tid));
+
+  if (!TCR_4(__kmp_init_parallel))
+    __kmp_parallel_initialize();
+
+  __kmp_resume_if_soft_paused();
+
+  if (__kmp_env_consistency_check) {
+    if (loc == 0) {
+      KMP_WARNING(ConstructIdentInvalid);
+    }
+    __kmp_check_barrier(global_tid, ct_barrier, loc);
+  }
+
+  __kmp_threads[global_tid]->th.th_ident = loc;
+  return __kmp_barrier_arrive(global_tid);
+}
+
+/*!
+@ingroup SYNCHRONIZATION
+@param loc source location information
+@param global_tid thread id.
+@param token value returned by @ref __kmpc_barrier_arrive
+
+Wait for all the threads of the team to arrive at the split-phase barrier.
+*/
+void __kmpc_barrier_wait(ident_t *loc, kmp_int32 global_tid, kmp_int32 token) {
+  KC_TRACE(10, ("__kmpc_barrier_wait: called T#%d\n", global_tid));
+
+  __kmp_threads[global_tid]->th.th_ident = loc;
+  __kmp_barrier_wait(global_tid, token);
+}
+
+/*!
+@ingroup SYNCHRONIZATION
+@param loc source location information
+@param global_tid thread id.
+@param nthreads number of threads in the sub-team
+@param tids team thread numbers of the threads in the sub-team
+@return the sub-team barrier
+
+Create a barrier for a subset of the threads of the current team. A thread of
+the team creates it once, and shares it with the others before they use it.
+*/
+kmp_subteam_barrier_t *__kmpc_subteam_barrier_create(ident_t *loc,
+                                                     kmp_int32 global_tid,
+                                                     kmp_int32 nthreads,
+                                                     const kmp_int32 *tids) {
+  KC_TRACE(10, ("__kmpc_subteam_barrier_create: called T#%d\n", global_tid));
+
+  if (!TCR_4(__kmp_init_parallel))
+    __kmp_parallel_initialize();
+
+  return __kmp_subteam_barrier_create(global_tid, nthreads, tids);
+}
+
+/*!
+@ingroup SYNCHRONIZATION
+@param loc source location information
+@param global_tid thread id.
+@param level level of the machine hierarchy, 0 for the leaves
+@return the sub-team barrier
+
+Create a barrier that synchronizes each group of threads of the current team
+sharing a subtree of the given level of the machine hierarchy, independently
+of the other groups.
+*/
+kmp_subteam_barrier_t *
+__kmpc_subteam_barrier_create_level(ident_t *loc, kmp_int32 global_tid,
+                                    kmp_int32 level) {
+  KC_TRACE(10, ("__kmpc_subteam_barrier_create_level: called T#%d\n",
+                global_tid));
+
+  if (!TCR_4(__kmp_init_parallel))
+    __kmp_parallel_initialize();
+
+  return __kmp_subteam_barrier_create_level(global_tid, level);
+}
+
+/*!
+@ingroup SYNCHRONIZATION
+@param loc source location information
+@param global_tid thread id.
+@param bar the sub-team barrier
+
+Wait for the other threads of the sub-team of the calling thread. Only the
+threads of the sub-team take part, and the barrier can be passed any number of
+times.
+*/
+void __kmpc_subteam_barrier(ident_t *loc, kmp_int32 global_tid,
+                            kmp_subteam_barrier_t *bar) {
+  KMP_COUNT_BLOCK(OMP_BARRIER);
+  KC_TRACE(10, ("__kmpc_subteam_barrier: called T#%d\n", global_tid));
+
+  __kmp_threads[global_tid]->th.th_ident = loc;
+  __kmp_subteam_barrier(global_tid, bar);
+}
+
+/*!
+@ingroup SYNCHRONIZATION
+@param loc source location information
+@param global_tid thread id.
+@param bar the sub-team barrier
+
+Free a sub-team barrier that no thread uses any more.
+*/
+void __kmpc_subteam_barrier_destroy(ident_t *loc, kmp_int32 global_tid,
+                                    kmp_subteam_barrier_t *bar) {
+  KC_TRACE(10, ("__kmpc_subteam_barrier_destroy: called T#%d\n", global_tid));
+
+  __kmp_subteam_barrier_destroy(bar);
+}
+
 /* The BARRIER for a MASTER section is always explicit   */
 /*!
 @ingroup WORK_SHARING
@@ -1986,6 +2113,17 @@ void kmpc_set_disp_num_buffers(int arg) {
     __kmp_dispatch_num_buffers = arg;
 }
 
+int kmpc_barrier_arrive(void) {
+  static ident_t loc = {0, KMP_IDENT_KMPC, 0, 0, ";unknown;unknown;0;0;;"};
+  // __kmp_entry_gtid initializes the library if needed
+  return __kmpc_barrier_arrive(&loc, __kmp_entry_gtid());
+}
+
+void kmpc_barrier_wait(int token) {
+  static ident_t loc = {0, KMP_IDENT_KMPC, 0, 0, ";unknown;unknown;0;0;;"};
+  __kmpc_barrier_wait(&loc, __kmp_get_gtid(), token);
+}
+
 int kmpc_set_affinity_mask_proc(int proc, void **mask) {
 #if defined(KMP_STUB) || !KMP_AFFINITY_SUPPORTED
   return -1;
@@ -3818,6 +3956,71 @@ void __kmpc_end_reduce(ident_t *loc, kmp_int32 global_tid,
   return;
 }
 
+/* 2.a.iii. Fused allreduce of small fixed-size data */
+
+/*!
+@ingroup SYNCHRONIZATION
+@param loc source location information
+@param global_tid global thread number
+@param data pointer to the values of the thread, replaced by the result
+@param count number of values
+@param type type of the values, a kmp_allreduce_type_t
+@param op reduction operation, a kmp_allreduce_op_t
+
+A blocking reduce of up to KMP_ALLREDUCE_SIZE bytes of values, whose result
+all the team threads get in their data. The values are combined in the gather
+of the reduction barrier and the result is passed down in its release, so the
+reduction costs about one barrier.
+*/
+void __kmpc_allreduce(ident_t *loc, kmp_int32 global_tid, void *data,
+                      kmp_int32 count, kmp_int32 type, kmp_int32 op) {
+  KMP_COUNT_BLOCK(REDUCE_wait);
+  kmp_info_t *th;
+  kmp_team_t *team;
+  int teams_swapped = 0, task_state;
+
+  KA_TRACE(10, ("__kmpc_allreduce() enter: called T#%d\n", global_tid));
+
+  if (!TCR_4(__kmp_init_parallel))
+    __kmp_parallel_initialize();
+
+  __kmp_resume_if_soft_paused();
+
+  if (__kmp_env_consistency_check) {
+    if (loc == 0) {
+      KMP_WARNING(ConstructIdentInvalid);
+    }
+    __kmp_check_barrier(global_tid, ct_barrier, loc);
+  }
+
+  th = __kmp_thread_from_gtid(global_tid);
+  teams_swapped = __kmp_swap_teams_for_teams_reduction(th, &team, &task_state);
+
+#if OMPT_SUPPORT
+  ompt_frame_t *ompt_frame;
+  if (ompt_enabled.enabled) {
+    __ompt_get_task_info_internal(0, NULL, NULL, &ompt_frame, NULL, NULL);
+    if (ompt_frame->enter_frame.ptr == NULL)
+      ompt_frame->enter_frame.ptr = OMPT_GET_FRAME_ADDRESS(0);
+    OMPT_STORE_RETURN_ADDRESS(global_tid);
+  }
+#endif
+  th->th.th_ident = loc;
+  __kmp_allreduce(global_tid, data, count, (kmp_allreduce_type_t)type,
+                  (kmp_allreduce_op_t)op);
+#if OMPT_SUPPORT && OMPT_OPTIONAL
+  if (ompt_enabled.enabled) {
+    ompt_frame->enter_frame = ompt_data_none;
+  }
+#endif
+
+  if (teams_swapped) {
+    __kmp_restore_swapped_teams(th, team, task_state);
+  }
+
+  KA_TRACE(10, ("__kmpc_allreduce() exit: called T#%d\n", global_tid));
+}
+
 #undef __KMP_GET_REDUCTION_METHOD
 #undef __KMP_SET_REDUCTION_METHOD
 
@@ -107,8 +107,10 @@ char const *__kmp_barrier_type_name[bs_last_barrier] = {"plain", "forkjoin"
                                                         "reduction"
 #endif // KMP_FAST_REDUCTION_BARRIER
 };
-char const *__kmp_barrier_pattern_name[bp_last_bar] = {"linear", "tree",
-                                                       "hyper", "hierarchical"};
+char const *__kmp_barrier_pattern_name[bp_last_bar] = {
+    "linear", "tree", "hyper", "hierarchical", "dissemination"};
+int __kmp_barrier_autotune = FALSE;
+char *__kmp_barrier_autotune_file = NULL;
 
 int __kmp_allThreadsSpecified = 0;
 size_t __kmp_align_alloc = CACHE_LINE;
@@ -286,6 +288,7 @@ kmp_int32 __kmp_default_device = 0;
 kmp_tasking_mode_t __kmp_tasking_mode = tskm_task_teams;
 kmp_int32 __kmp_max_task_priority = 0;
 kmp_uint64 __kmp_taskloop_min_tasks = 0;
+int __kmp_taskloop_lazy = FALSE;
 
 int __kmp_memkind_available = 0;
 omp_allocator_handle_t const omp_null_allocator = NULL;
@@ -329,6 +332,22 @@ KMP_BUILD_ASSERT(sizeof(kmp_tasking_flags_t) == 4);
 
 int __kmp_task_stealing_constraint = 1; /* Constrain task stealing by default */
 int __kmp_enable_task_throttling = 1;
+int __kmp_task_deque_lockfree = FALSE; /* Use Chase-Lev deques for own tasks */
+int __kmp_task_deque_adaptive = FALSE; /* Limit follows the steals, off */
+kmp_task_steal_policy_t __kmp_task_steal_policy = task_steal_random;
+int __kmp_task_steal_retries[3] = {2, 4, 2};
+int __kmp_task_steal_batch = 1;
+int __kmp_task_bypass = FALSE; /* Run a released successor at once, off */
+int __kmp_task_cutoff = 0; /* Queued tasks before the cutoff, off */
+int __kmp_task_wakeup_cap = 0; /* Sleeping threads resumed at a time */
+int __kmp_task_completion_queue = FALSE; /* Proxy tasks queue, off */
+int __kmp_task_critical_path = 0; /* Prefer tasks on the longest path, off */
+int __kmp_task_red_lazy = FALSE; /* Privatize reduction items on use, off */
+int __kmp_task_red_combine_size = 0; /* Bytes, 0 combines serially, off */
+int __kmp_task_slab_alloc = FALSE; /* Tasks from per-thread slabs, off */
+int __kmp_task_numa_local = FALSE; /* Deques on their owner's NUMA node, off */
+int __kmp_task_fibers = FALSE; /* Untied tasks on stacks of their own */
+size_t __kmp_task_fiber_stksize = KMP_DEFAULT_TASK_FIBER_STKSIZE;
 
 #ifdef DEBUG_SUSPEND
 int __kmp_suspend_count = 0;
@@ -1123,7 +1123,7 @@ void KMP_EXPAND_NAME(KMP_API_NAME_GOMP_TASK)(void (*func)(void *), void *data,
                                              void (*copy_func)(void *, void *),
                                              long arg_size, long arg_align,
                                              bool if_cond, unsigned gomp_flags,
-                                             void **depend) {
+                                             void **depend, int priority) {
   MKLOC(loc, "GOMP_task");
   int gtid = __kmp_entry_gtid();
   kmp_int32 flags = 0;
@@ -1139,6 +1139,10 @@ void KMP_EXPAND_NAME(KMP_API_NAME_GOMP_TASK)(void (*func)(void *), void *data,
   if (gomp_flags & 2) {
     input_flags->final = 1;
   }
+  // The fifth low-order bit is the "priority" flag (GCC 6 and later)
+  if (gomp_flags & 16) {
+    input_flags->priority_specified = 1;
+  }
   input_flags->native = 1;
   // __kmp_task_alloc() sets up all other flags
 
@@ -1163,6 +1167,9 @@ void KMP_EXPAND_NAME(KMP_API_NAME_GOMP_TASK)(void (*func)(void *), void *data,
       KMP_MEMCPY(task->shareds, data, arg_size);
     }
   }
+  if (input_flags->priority_specified) {
+    task->data2.priority = priority;
+  }
 
 #if OMPT_SUPPORT
   kmp_taskdata_t *current_task;
@@ -1185,6 +1192,7 @@ void KMP_EXPAND_NAME(KMP_API_NAME_GOMP_TASK)(void (*func)(void *), void *data,
         dep_list[i].len = 0U;
         dep_list[i].flags.in = 1;
         dep_list[i].flags.out = (i < nout);
+        dep_list[i].flags.mtx = 0;
       }
       __kmpc_omp_task_with_deps(&loc, gtid, task, ndeps, dep_list, 0, NULL);
     } else {
@@ -3052,6 +3052,17 @@ static void __kmp_allocate_team_arrays(kmp_team_t *team, int max_nth) {
       (kmp_disp_t *)__kmp_allocate(sizeof(kmp_disp_t) * max_nth);
   team->t.t_implicit_task_taskdata =
       (kmp_taskdata_t *)__kmp_allocate(sizeof(kmp_taskdata_t) * max_nth);
+  for (i = 0; i < bs_last_barrier; ++i) {
+    // The join barrier uses the hyper gather instead; auto-tuning may pick
+    // the dissemination pattern for the other barriers
+    team->t.t_dissem_bar[i] =
+        (__kmp_barrier_gather_pattern[i] == bp_dissemination_bar ||
+         __kmp_barrier_autotune) &&
+                i != bs_forkjoin_barrier
+            ? (kmp_dissem_bar_t *)__kmp_allocate(sizeof(kmp_dissem_bar_t) *
+                                                 max_nth)
+            : NULL;
+  }
   team->t.t_max_nproc = max_nth;
 
   /* setup dispatch buffers */
@@ -3061,6 +3072,15 @@ static void __kmp_allocate_team_arrays(kmp_team_t *team, int max_nth) {
   }
 }
 
+static void __kmp_free_dissem_bar(kmp_team_t *team) {
+  for (int b = 0; b < bs_last_barrier; ++b) {
+    if (team->t.t_dissem_bar[b] != NULL) {
+      __kmp_free(team->t.t_dissem_bar[b]);
+      team->t.t_dissem_bar[b] = NULL;
+    }
+  }
+}
+
 static void __kmp_free_team_arrays(kmp_team_t *team) {
   /* Note: this does not free the threads in t_threads (__kmp_free_threads) */
   int i;
@@ -3077,6 +3097,7 @@ static void __kmp_free_team_arrays(kmp_team_t *team) {
   __kmp_free(team->t.t_disp_buffer);
   __kmp_free(team->t.t_dispatch);
   __kmp_free(team->t.t_implicit_task_taskdata);
+  __kmp_free_dissem_bar(team);
   team->t.t_threads = NULL;
   team->t.t_disp_buffer = NULL;
   team->t.t_dispatch = NULL;
@@ -3089,6 +3110,7 @@ static void __kmp_reallocate_team_arrays(kmp_team_t *team, int max_nth) {
   __kmp_free(team->t.t_disp_buffer);
   __kmp_free(team->t.t_dispatch);
   __kmp_free(team->t.t_implicit_task_taskdata);
+  __kmp_free_dissem_bar(team);
   __kmp_allocate_team_arrays(team, max_nth);
 
   KMP_MEMCPY(team->t.t_threads, oldThreads,
@@ -4491,6 +4513,15 @@ static void __kmp_initialize_team(kmp_team_t *team, int new_nproc,
 
   team->t.t_control_stack_top = NULL;
 
+  // Threads joining the team must use the same dissemination barrier flags
+  // as the others
+  for (int b = 0; b < bs_last_barrier; ++b) {
+    if (team->t.t_dissem_bar[b] != NULL) {
+      for (int f = 0; f < team->t.t_max_nproc; ++f)
+        team->t.t_dissem_bar[b][f].parity = 0;
+    }
+  }
+
   __kmp_reinitialize_team(team, new_icvs, loc);
 
   KMP_MB();
@@ -5896,6 +5927,8 @@ static void __kmp_reap_thread(kmp_info_t *thread, int is_root) {
 #if USE_FAST_MEMORY
   __kmp_free_fast_memory(thread);
 #endif /* USE_FAST_MEMORY */
+  __kmp_free_task_slabs(thread);
+  __kmp_free_task_fibers(thread);
 
   __kmp_suspend_uninitialize_thread(thread);
 
@@ -6044,6 +6077,7 @@ static void __kmp_internal_end(void) {
     }
 
     __kmp_reap_task_teams();
+    __kmp_free_taskgraphs();
 
 #if KMP_OS_UNIX
     // Threads that are not reaped should not access any resources since they
@@ -6992,6 +7026,10 @@ void __kmp_run_before_invoked_task(int gtid, int tid, kmp_info_t *this_thr,
     __kmp_push_parallel(gtid, team->t.t_ident);
 
   KMP_MB(); /* Flush all pending memory write invalidates.  */
+
+  // The first team of a size measures its barriers before any user code runs
+  if (__kmp_barrier_autotune)
+    __kmp_barrier_calibrate(gtid);
 }
 
 void __kmp_run_after_invoked_task(int gtid, int tid, kmp_info_t *this_thr,
@@ -7277,6 +7315,9 @@ void __kmp_internal_fork(ident_t *id, int gtid, kmp_team_t *team) {
     team->t.t_disp_buffer[0].doacross_buf_idx = 0;
   }
 
+  // The workers are in the fork barrier: the barriers may change patterns
+  __kmp_setup_barrier_patterns(team);
+
   KMP_MB(); /* Flush all pending memory write invalidates.  */
   KMP_ASSERT(this_thr->th.th_team == team);
 
@@ -7490,6 +7531,7 @@ void __kmp_cleanup(void) {
   }
 
   __kmp_cleanup_threadprivate_caches();
+  __kmp_cleanup_barrier_tuning();
 
   for (f = 0; f < __kmp_threads_capacity; f++) {
     if (__kmp_root[f] != NULL) {
@@ -7514,6 +7556,8 @@ void __kmp_cleanup(void) {
   KMP_INTERNAL_FREE(CCAST(char *, __kmp_cpuinfo_file));
   __kmp_cpuinfo_file = NULL;
 #endif /* KMP_AFFINITY_SUPPORTED */
+  KMP_INTERNAL_FREE(__kmp_barrier_autotune_file);
+  __kmp_barrier_autotune_file = NULL;
 
 #if KMP_USE_ADAPTIVE_LOCKS
 #if KMP_DEBUG_ADAPTIVE_LOCKS
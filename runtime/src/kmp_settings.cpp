@@ -1318,6 +1318,188 @@ static void __kmp_stg_print_taskloop_min_tasks(kmp_str_buf_t *buffer,
   __kmp_stg_print_int(buffer, name, __kmp_taskloop_min_tasks);
 } // __kmp_stg_print_taskloop_min_tasks
 
+// KMP_TASKLOOP_LAZY
+// taskloops without grainsize or num_tasks clause are executed by range tasks
+// that split off half of their iterations only when idle threads can take it
+static void __kmp_stg_parse_taskloop_lazy(char const *name, char const *value,
+                                          void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_taskloop_lazy);
+} // __kmp_stg_parse_taskloop_lazy
+
+static void __kmp_stg_print_taskloop_lazy(kmp_str_buf_t *buffer,
+                                          char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_taskloop_lazy);
+} // __kmp_stg_print_taskloop_lazy
+
+// -----------------------------------------------------------------------------
+// KMP_TASK_STEAL_POLICY
+static void __kmp_stg_parse_task_steal_policy(char const *name,
+                                              char const *value, void *data) {
+  if (__kmp_str_match("random", 1, value)) {
+    __kmp_task_steal_policy = task_steal_random;
+  } else if (__kmp_str_match("hierarchical", 1, value)) {
+    __kmp_task_steal_policy = task_steal_hierarchical;
+  } else {
+    KMP_WARNING(StgInvalidValue, name, value);
+  }
+} // __kmp_stg_parse_task_steal_policy
+
+static void __kmp_stg_print_task_steal_policy(kmp_str_buf_t *buffer,
+                                              char const *name, void *data) {
+  __kmp_stg_print_str(buffer, name,
+                      __kmp_task_steal_policy == task_steal_hierarchical
+                          ? "hierarchical"
+                          : "random");
+} // __kmp_stg_print_task_steal_policy
+
+// KMP_TASK_STEAL_RETRIES
+// "smt,domain,remote" steal attempts per level for hierarchical stealing
+static void __kmp_stg_parse_task_steal_retries(char const *name,
+                                               char const *value, void *data) {
+  int retries[3];
+  char const *next = value;
+  for (int i = 0; i < 3; ++i) {
+    char const *comma = strchr(next, ',');
+    retries[i] = __kmp_str_to_int(next, ',');
+    if (retries[i] < 0 || (comma == NULL && i < 2) ||
+        (comma != NULL && i == 2)) {
+      KMP_WARNING(StgInvalidValue, name, value);
+      return;
+    }
+    next = comma + 1;
+  }
+  for (int i = 0; i < 3; ++i)
+    __kmp_task_steal_retries[i] = retries[i];
+} // __kmp_stg_parse_task_steal_retries
+
+static void __kmp_stg_print_task_steal_retries(kmp_str_buf_t *buffer,
+                                               char const *name, void *data) {
+  if (__kmp_env_format) {
+    KMP_STR_BUF_PRINT_NAME_EX(name);
+  } else {
+    __kmp_str_buf_print(buffer, "   %s='", name);
+  }
+  __kmp_str_buf_print(buffer, "%d,%d,%d'\n", __kmp_task_steal_retries[0],
+                      __kmp_task_steal_retries[1], __kmp_task_steal_retries[2]);
+} // __kmp_stg_print_task_steal_retries
+
+// KMP_TASK_STEAL_BATCH
+// maximum number of tasks a thief takes from a victim at once (up to half of
+// the victim's deque); 1 steals a single task
+static void __kmp_stg_parse_task_steal_batch(char const *name,
+                                             char const *value, void *data) {
+  __kmp_stg_parse_int(name, value, 1, KMP_MAX_TASK_STEAL_BATCH,
+                      &__kmp_task_steal_batch);
+} // __kmp_stg_parse_task_steal_batch
+
+static void __kmp_stg_print_task_steal_batch(kmp_str_buf_t *buffer,
+                                             char const *name, void *data) {
+  __kmp_stg_print_int(buffer, name, __kmp_task_steal_batch);
+} // __kmp_stg_print_task_steal_batch
+
+// KMP_TASK_BYPASS
+// the thread finishing a task executes the first successor it makes ready
+// instead of queuing it, up to a bounded chain of successors; off by default
+static void __kmp_stg_parse_task_bypass(char const *name, char const *value,
+                                        void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_task_bypass);
+} // __kmp_stg_parse_task_bypass
+
+static void __kmp_stg_print_task_bypass(kmp_str_buf_t *buffer,
+                                        char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_task_bypass);
+} // __kmp_stg_print_task_bypass
+
+// KMP_TASK_CUTOFF
+// number of tasks queued by a thread from which the short tasks it creates
+// are executed immediately, while no thread of the team is idle; 0, the
+// default, disables the cutoff
+static void __kmp_stg_parse_task_cutoff(char const *name, char const *value,
+                                        void *data) {
+  __kmp_stg_parse_int(name, value, 0, INITIAL_TASK_DEQUE_SIZE,
+                      &__kmp_task_cutoff);
+} // __kmp_stg_parse_task_cutoff
+
+static void __kmp_stg_print_task_cutoff(kmp_str_buf_t *buffer,
+                                        char const *name, void *data) {
+  __kmp_stg_print_int(buffer, name, __kmp_task_cutoff);
+} // __kmp_stg_print_task_cutoff
+
+// KMP_TASK_WAKEUP_CAP
+// threads sleeping at the barrier are resumed only while there are more queued
+// tasks than threads already resumed for them, at most this many at a time;
+// 0, the default, resumes all of them as soon as the first task is queued
+static void __kmp_stg_parse_task_wakeup_cap(char const *name,
+                                            char const *value, void *data) {
+  __kmp_stg_parse_int(name, value, 0, KMP_MAX_NTH, &__kmp_task_wakeup_cap);
+} // __kmp_stg_parse_task_wakeup_cap
+
+static void __kmp_stg_print_task_wakeup_cap(kmp_str_buf_t *buffer,
+                                            char const *name, void *data) {
+  __kmp_stg_print_int(buffer, name, __kmp_task_wakeup_cap);
+} // __kmp_stg_print_task_wakeup_cap
+
+// KMP_TASK_COMPLETION_QUEUE
+// proxy and detached tasks completed by threads outside of their team are
+// queued lock-free on the task team instead of into the deque of some thread;
+// off by default
+static void __kmp_stg_parse_task_completion_queue(char const *name,
+                                                  char const *value,
+                                                  void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_task_completion_queue);
+} // __kmp_stg_parse_task_completion_queue
+
+static void __kmp_stg_print_task_completion_queue(kmp_str_buf_t *buffer,
+                                                  char const *name,
+                                                  void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_task_completion_queue);
+} // __kmp_stg_print_task_completion_queue
+
+// KMP_TASK_CRITICAL_PATH
+// ready tasks of dependence graphs are executed in decreasing order of their
+// longest path to a sink, estimated over this many levels of predecessors when
+// a task is added to the graph; 0 disables
+static void __kmp_stg_parse_task_critical_path(char const *name,
+                                               char const *value, void *data) {
+  __kmp_stg_parse_int(name, value, 0, KMP_MAX_TASK_CRITICAL_PATH,
+                      &__kmp_task_critical_path);
+} // __kmp_stg_parse_task_critical_path
+
+static void __kmp_stg_print_task_critical_path(kmp_str_buf_t *buffer,
+                                               char const *name, void *data) {
+  __kmp_stg_print_int(buffer, name, __kmp_task_critical_path);
+} // __kmp_stg_print_task_critical_path
+
+// KMP_TASK_REDUCTION_LAZY
+// private copies of task reduction items are allocated and initialized by each
+// thread on its first access instead of for all threads of the team upfront;
+// off by default
+static void __kmp_stg_parse_task_red_lazy(char const *name, char const *value,
+                                          void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_task_red_lazy);
+} // __kmp_stg_parse_task_red_lazy
+
+static void __kmp_stg_print_task_red_lazy(kmp_str_buf_t *buffer,
+                                          char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_task_red_lazy);
+} // __kmp_stg_print_task_red_lazy
+
+// KMP_TASK_REDUCTION_COMBINE_SIZE
+// size in bytes from which the private copies of a task reduction item are
+// combined pairwise by tasks at the end of the taskgroup; 0, the default,
+// combines them serially
+static void __kmp_stg_parse_task_red_combine_size(char const *name,
+                                                  char const *value,
+                                                  void *data) {
+  __kmp_stg_parse_int(name, value, 0, INT_MAX, &__kmp_task_red_combine_size);
+} // __kmp_stg_parse_task_red_combine_size
+
+static void __kmp_stg_print_task_red_combine_size(kmp_str_buf_t *buffer,
+                                                  char const *name,
+                                                  void *data) {
+  __kmp_stg_print_int(buffer, name, __kmp_task_red_combine_size);
+} // __kmp_stg_print_task_red_combine_size
+
 // -----------------------------------------------------------------------------
 // KMP_DISP_NUM_BUFFERS
 static void __kmp_stg_parse_disp_buffers(char const *name, char const *value,
@@ -1655,6 +1837,43 @@ static void __kmp_stg_print_barrier_pattern(kmp_str_buf_t *buffer,
   }
 } // __kmp_stg_print_barrier_pattern
 
+// -----------------------------------------------------------------------------
+// KMP_BARRIER_AUTOTUNE
+
+static void __kmp_stg_parse_barrier_autotune(char const *name,
+                                             char const *value, void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_barrier_autotune);
+} // __kmp_stg_parse_barrier_autotune
+
+static void __kmp_stg_print_barrier_autotune(kmp_str_buf_t *buffer,
+                                             char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_barrier_autotune);
+} // __kmp_stg_print_barrier_autotune
+
+// -----------------------------------------------------------------------------
+// KMP_BARRIER_AUTOTUNE_FILE
+
+static void __kmp_stg_parse_barrier_autotune_file(char const *name,
+                                                  char const *value,
+                                                  void *data) {
+  __kmp_stg_parse_str(name, value, &__kmp_barrier_autotune_file);
+} // __kmp_stg_parse_barrier_autotune_file
+
+static void __kmp_stg_print_barrier_autotune_file(kmp_str_buf_t *buffer,
+                                                  char const *name,
+                                                  void *data) {
+  if (__kmp_env_format) {
+    KMP_STR_BUF_PRINT_NAME;
+  } else {
+    __kmp_str_buf_print(buffer, "   %s", name);
+  }
+  if (__kmp_barrier_autotune_file) {
+    __kmp_str_buf_print(buffer, "='%s'\n", __kmp_barrier_autotune_file);
+  } else {
+    __kmp_str_buf_print(buffer, ": %s\n", KMP_I18N_STR(NotDefined));
+  }
+} // __kmp_stg_print_barrier_autotune_file
+
 // -----------------------------------------------------------------------------
 // KMP_ABORT_DELAY
 
@@ -4621,6 +4840,97 @@ static void __kmp_stg_print_task_throttling(kmp_str_buf_t *buffer,
   __kmp_stg_print_bool(buffer, name, __kmp_enable_task_throttling);
 } // __kmp_stg_print_task_throttling
 
+// -----------------------------------------------------------------------------
+// KMP_TASK_DEQUE_LOCKFREE
+
+static void __kmp_stg_parse_task_deque_lockfree(char const *name,
+                                                char const *value, void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_task_deque_lockfree);
+} // __kmp_stg_parse_task_deque_lockfree
+
+static void __kmp_stg_print_task_deque_lockfree(kmp_str_buf_t *buffer,
+                                                char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_task_deque_lockfree);
+} // __kmp_stg_print_task_deque_lockfree
+
+// -----------------------------------------------------------------------------
+// KMP_TASK_DEQUE_ADAPTIVE
+
+static void __kmp_stg_parse_task_deque_adaptive(char const *name,
+                                                char const *value, void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_task_deque_adaptive);
+} // __kmp_stg_parse_task_deque_adaptive
+
+static void __kmp_stg_print_task_deque_adaptive(kmp_str_buf_t *buffer,
+                                                char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_task_deque_adaptive);
+} // __kmp_stg_print_task_deque_adaptive
+
+// -----------------------------------------------------------------------------
+// KMP_TASK_SLAB_ALLOC
+
+static void __kmp_stg_parse_task_slab_alloc(char const *name,
+                                            char const *value, void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_task_slab_alloc);
+} // __kmp_stg_parse_task_slab_alloc
+
+static void __kmp_stg_print_task_slab_alloc(kmp_str_buf_t *buffer,
+                                            char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_task_slab_alloc);
+} // __kmp_stg_print_task_slab_alloc
+
+// -----------------------------------------------------------------------------
+// KMP_TASK_NUMA_LOCAL
+
+static void __kmp_stg_parse_task_numa_local(char const *name,
+                                            char const *value, void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_task_numa_local);
+} // __kmp_stg_parse_task_numa_local
+
+static void __kmp_stg_print_task_numa_local(kmp_str_buf_t *buffer,
+                                            char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_task_numa_local);
+} // __kmp_stg_print_task_numa_local
+
+// -----------------------------------------------------------------------------
+// KMP_TASK_FIBERS
+// Untied tasks run on fibers and are suspended at taskwait and taskyield. A
+// suspended task is only resumed by the thread which suspended it, once that
+// thread is back in the scheduler: while it runs another task, the suspended
+// task waits even if it is ready and other threads are idle.
+
+static void __kmp_stg_parse_task_fibers(char const *name, char const *value,
+                                        void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_task_fibers);
+#if !KMP_HAVE_TASK_FIBERS
+  if (__kmp_task_fibers) {
+    KMP_WARNING(StgInvalidValue, name, value);
+    __kmp_task_fibers = FALSE;
+  }
+#endif
+} // __kmp_stg_parse_task_fibers
+
+static void __kmp_stg_print_task_fibers(kmp_str_buf_t *buffer,
+                                        char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_task_fibers);
+} // __kmp_stg_print_task_fibers
+
+// -----------------------------------------------------------------------------
+// KMP_TASK_FIBER_STACKSIZE
+
+static void __kmp_stg_parse_task_fiber_stacksize(char const *name,
+                                                 char const *value,
+                                                 void *data) {
+  __kmp_stg_parse_size(name, value, __kmp_sys_min_stksize, KMP_MAX_STKSIZE,
+                       NULL, &__kmp_task_fiber_stksize, 1);
+} // __kmp_stg_parse_task_fiber_stacksize
+
+static void __kmp_stg_print_task_fiber_stacksize(kmp_str_buf_t *buffer,
+                                                 char const *name,
+                                                 void *data) {
+  __kmp_stg_print_size(buffer, name, __kmp_task_fiber_stksize);
+} // __kmp_stg_print_task_fiber_stacksize
+
 // -----------------------------------------------------------------------------
 // OMP_DISPLAY_ENV
 
@@ -4749,6 +5059,28 @@ static kmp_setting_t __kmp_stg_table[] = {
      __kmp_stg_print_max_task_priority, NULL, 0, 0},
     {"KMP_TASKLOOP_MIN_TASKS", __kmp_stg_parse_taskloop_min_tasks,
      __kmp_stg_print_taskloop_min_tasks, NULL, 0, 0},
+    {"KMP_TASKLOOP_LAZY", __kmp_stg_parse_taskloop_lazy,
+     __kmp_stg_print_taskloop_lazy, NULL, 0, 0},
+    {"KMP_TASK_STEAL_POLICY", __kmp_stg_parse_task_steal_policy,
+     __kmp_stg_print_task_steal_policy, NULL, 0, 0},
+    {"KMP_TASK_STEAL_RETRIES", __kmp_stg_parse_task_steal_retries,
+     __kmp_stg_print_task_steal_retries, NULL, 0, 0},
+    {"KMP_TASK_STEAL_BATCH", __kmp_stg_parse_task_steal_batch,
+     __kmp_stg_print_task_steal_batch, NULL, 0, 0},
+    {"KMP_TASK_BYPASS", __kmp_stg_parse_task_bypass,
+     __kmp_stg_print_task_bypass, NULL, 0, 0},
+    {"KMP_TASK_CUTOFF", __kmp_stg_parse_task_cutoff,
+     __kmp_stg_print_task_cutoff, NULL, 0, 0},
+    {"KMP_TASK_WAKEUP_CAP", __kmp_stg_parse_task_wakeup_cap,
+     __kmp_stg_print_task_wakeup_cap, NULL, 0, 0},
+    {"KMP_TASK_COMPLETION_QUEUE", __kmp_stg_parse_task_completion_queue,
+     __kmp_stg_print_task_completion_queue, NULL, 0, 0},
+    {"KMP_TASK_CRITICAL_PATH", __kmp_stg_parse_task_critical_path,
+     __kmp_stg_print_task_critical_path, NULL, 0, 0},
+    {"KMP_TASK_REDUCTION_LAZY", __kmp_stg_parse_task_red_lazy,
+     __kmp_stg_print_task_red_lazy, NULL, 0, 0},
+    {"KMP_TASK_REDUCTION_COMBINE_SIZE", __kmp_stg_parse_task_red_combine_size,
+     __kmp_stg_print_task_red_combine_size, NULL, 0, 0},
     {"OMP_THREAD_LIMIT", __kmp_stg_parse_thread_limit,
      __kmp_stg_print_thread_limit, NULL, 0, 0},
     {"KMP_TEAMS_THREAD_LIMIT", __kmp_stg_parse_teams_thread_limit,
@@ -4823,6 +5155,10 @@ static kmp_setting_t __kmp_stg_table[] = {
     {"KMP_REDUCTION_BARRIER_PATTERN", __kmp_stg_parse_barrier_pattern,
      __kmp_stg_print_barrier_pattern, NULL, 0, 0},
 #endif
+    {"KMP_BARRIER_AUTOTUNE", __kmp_stg_parse_barrier_autotune,
+     __kmp_stg_print_barrier_autotune, NULL, 0, 0},
+    {"KMP_BARRIER_AUTOTUNE_FILE", __kmp_stg_parse_barrier_autotune_file,
+     __kmp_stg_print_barrier_autotune_file, NULL, 0, 0},
 
     {"KMP_ABORT_DELAY", __kmp_stg_parse_abort_delay,
      __kmp_stg_print_abort_delay, NULL, 0, 0},
@@ -4924,6 +5260,18 @@ static kmp_setting_t __kmp_stg_table[] = {
 #endif
     {"KMP_ENABLE_TASK_THROTTLING", __kmp_stg_parse_task_throttling,
      __kmp_stg_print_task_throttling, NULL, 0, 0},
+    {"KMP_TASK_DEQUE_LOCKFREE", __kmp_stg_parse_task_deque_lockfree,
+     __kmp_stg_print_task_deque_lockfree, NULL, 0, 0},
+    {"KMP_TASK_DEQUE_ADAPTIVE", __kmp_stg_parse_task_deque_adaptive,
+     __kmp_stg_print_task_deque_adaptive, NULL, 0, 0},
+    {"KMP_TASK_SLAB_ALLOC", __kmp_stg_parse_task_slab_alloc,
+     __kmp_stg_print_task_slab_alloc, NULL, 0, 0},
+    {"KMP_TASK_NUMA_LOCAL", __kmp_stg_parse_task_numa_local,
+     __kmp_stg_print_task_numa_local, NULL, 0, 0},
+    {"KMP_TASK_FIBERS", __kmp_stg_parse_task_fibers,
+     __kmp_stg_print_task_fibers, NULL, 0, 0},
+    {"KMP_TASK_FIBER_STACKSIZE", __kmp_stg_parse_task_fiber_stacksize,
+     __kmp_stg_print_task_fiber_stacksize, NULL, 0, 0},
 
     {"OMP_DISPLAY_ENV", __kmp_stg_parse_omp_display_env,
      __kmp_stg_print_omp_display_env, NULL, 0, 0},
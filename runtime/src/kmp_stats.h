@@ -112,7 +112,21 @@ enum stats_state_e {
   macro(OMP_TASKLOOP, 0, arg)                                                  \
   macro(TASK_executed, 0, arg)                                                 \
   macro(TASK_cancelled, 0, arg)                                                \
-  macro(TASK_stolen, 0, arg)
+  macro(TASK_stolen, 0, arg)                                                   \
+  macro(TASK_stolen_smt, 0, arg)                                               \
+  macro(TASK_stolen_domain, 0, arg)                                            \
+  macro(TASK_stolen_remote, 0, arg)                                            \
+  macro(TASK_steal_failed_smt, 0, arg)                                         \
+  macro(TASK_steal_failed_domain, 0, arg)                                      \
+  macro(TASK_steal_failed_remote, 0, arg)                                      \
+  macro(TASK_affinity_moved, 0, arg)                                           \
+  macro(TASK_bypassed, 0, arg)                                                 \
+  macro(TASK_mtx_parked, 0, arg)                                               \
+  macro(TASK_fiber_suspended, 0, arg)                                          \
+  macro(TASK_deque_spilled, 0, arg)                                            \
+  macro(TASK_cutoff, 0, arg)                                                   \
+  macro(TASK_wakeups, 0, arg)                                                  \
+  macro(TASK_steal_empty, 0, arg)
 // clang-format on
 
 /*!
@@ -176,6 +190,12 @@ enum stats_state_e {
          stats_flags_e::noUnits | stats_flags_e::noTotal, arg)                 \
   macro (OMP_distribute_iterations,                                            \
          stats_flags_e::noUnits | stats_flags_e::noTotal, arg)                 \
+  macro (TASK_tasks_per_steal,                                                 \
+         stats_flags_e::noUnits | stats_flags_e::noTotal, arg)                 \
+  macro (TASK_proxy_tasks_per_drain,                                           \
+         stats_flags_e::noUnits | stats_flags_e::noTotal, arg)                 \
+  macro (TASK_deque_high_water,                                                \
+         stats_flags_e::noUnits | stats_flags_e::noTotal, arg)                 \
   KMP_FOREACH_DEVELOPER_TIMER(macro, arg)
 // clang-format on
 
@@ -243,11 +263,15 @@ enum stats_state_e {
 // KMP_tree_release       -- time in __kmp_tree_barrier_release
 // KMP_hyper_gather       -- time in __kmp_hyper_barrier_gather
 // KMP_hyper_release      -- time in __kmp_hyper_barrier_release
+// KMP_dissem_gather      -- time in __kmp_dissemination_barrier_gather
+// KMP_barrier_calibrate  -- time in __kmp_barrier_calibrate
 // clang-format off
 #define KMP_FOREACH_DEVELOPER_TIMER(macro, arg)                                \
   macro(KMP_fork_call, 0, arg)                                                 \
   macro(KMP_join_call, 0, arg)                                                 \
   macro(KMP_end_split_barrier, 0, arg)                                         \
+  macro(KMP_dissem_gather, 0, arg)                                             \
+  macro(KMP_barrier_calibrate, 0, arg)                                         \
   macro(KMP_hier_gather, 0, arg)                                               \
   macro(KMP_hier_release, 0, arg)                                              \
   macro(KMP_hyper_gather, 0, arg)                                              \
@@ -34,13 +34,16 @@ static std::atomic<kmp_int32> kmp_node_id_seed = ATOMIC_VAR_INIT(0);
 #endif
 
 static void __kmp_init_node(kmp_depnode_t *node) {
-  node->dn.successors = NULL;
+  KMP_ATOMIC_ST_RLX(&node->dn.successors, NULL);
   node->dn.task = NULL; // will point to the rigth task
   // once dependences have been processed
   for (int i = 0; i < MAX_MTX_DEPS; ++i)
     node->dn.mtx_locks[i] = NULL;
   node->dn.mtx_num_locks = 0;
   __kmp_init_lock(&node->dn.lock);
+  node->dn.tg_index = -1;
+  node->dn.predecessors = NULL;
+  KMP_ATOMIC_ST_RLX(&node->dn.bottom_level, 0);
   KMP_ATOMIC_ST_RLX(&node->dn.nrefs, 1); // init creates the first reference
 #ifdef KMP_SUPPORT_GRAPH_OUTPUT
   node->dn.id = KMP_ATOMIC_INC(&kmp_node_id_seed);
@@ -52,64 +55,73 @@ static inline kmp_depnode_t *__kmp_node_ref(kmp_depnode_t *node) {
   return node;
 }
 
-enum { KMP_DEPHASH_OTHER_SIZE = 97, KMP_DEPHASH_MASTER_SIZE = 997 };
+enum { KMP_DEPHASH_OTHER_SIZE = 128, KMP_DEPHASH_MASTER_SIZE = 1024 };
 
-size_t sizes[] = { 997, 2003, 4001, 8191, 16001, 32003, 64007, 131071, 270029 };
-const size_t MAX_GEN = 8;
+// Number of slots of the previous table moved by each lookup while the
+// dependence hash is growing. With at most half of the slots in use, the old
+// table is drained long before the new one needs to grow again.
+#define KMP_DEPHASH_MOVE_SLOTS 16
 
-static inline kmp_int32 __kmp_dephash_hash(kmp_intptr_t addr, size_t hsize) {
-  // TODO alternate to try: set = (((Addr64)(addrUsefulBits * 9.618)) %
-  // m_num_sets );
-  return ((addr >> 6) ^ (addr >> 2)) % hsize;
+static inline size_t __kmp_dephash_hash(kmp_intptr_t addr, size_t hsize) {
+  // Nearby addresses get nearby slots, which keeps sweeps over an array cache
+  // friendly, while the higher bits are folded in so that large power-of-two
+  // strides (e.g. tiles) still spread over the whole table
+  kmp_uint64 x = (kmp_uint64)addr >> 2;
+  return (size_t)(x ^ (x >> 11) ^ (x >> 22) ^ (x >> 33)) & (hsize - 1);
 }
 
-static kmp_dephash_t *__kmp_dephash_extend(kmp_info_t *thread,
-                                           kmp_dephash_t *current_dephash) {
-  kmp_dephash_t *h;
-
-  size_t gen = current_dephash->generation + 1;
-  if (gen >= MAX_GEN)
-    return current_dephash;
-  size_t new_size = sizes[gen];
-
-  kmp_int32 size_to_allocate =
-      new_size * sizeof(kmp_dephash_entry_t *) + sizeof(kmp_dephash_t);
-
+static kmp_dephash_slot_t *__kmp_dephash_alloc_slots(kmp_info_t *thread,
+                                                     size_t size) {
+  kmp_dephash_slot_t *slots;
 #if USE_FAST_MEMORY
-  h = (kmp_dephash_t *)__kmp_fast_allocate(thread, size_to_allocate);
+  slots = (kmp_dephash_slot_t *)__kmp_fast_allocate(
+      thread, size * sizeof(kmp_dephash_slot_t));
 #else
-  h = (kmp_dephash_t *)__kmp_thread_malloc(thread, size_to_allocate);
+  slots = (kmp_dephash_slot_t *)__kmp_thread_malloc(
+      thread, size * sizeof(kmp_dephash_slot_t));
 #endif
+  for (size_t i = 0; i < size; i++)
+    slots[i].entry = NULL;
+  return slots;
+}
 
-  h->size = new_size;
-  h->nelements = current_dephash->nelements;
-  h->buckets = (kmp_dephash_entry **)(h + 1);
-  h->generation = gen;
-
-  // insert existing elements in the new table
-  for (size_t i = 0; i < current_dephash->size; i++) {
-    kmp_dephash_entry_t *next;
-    for (kmp_dephash_entry_t *entry = current_dephash->buckets[i]; entry; entry = next) {
-      next = entry->next_in_bucket;
-      // Compute the new hash using the new size, and insert the entry in
-      // the new bucket.
-      kmp_int32 new_bucket = __kmp_dephash_hash(entry->addr, h->size);
-      if (entry->next_in_bucket) {
-        h->nconflicts++;
-      }
-      entry->next_in_bucket = h->buckets[new_bucket];
-      h->buckets[new_bucket] = entry;
-    }
+// Store an entry known not to be in the table in the first free slot
+static inline void __kmp_dephash_insert(kmp_dephash_slot_t *slots, size_t size,
+                                        kmp_intptr_t addr,
+                                        kmp_dephash_entry_t *entry) {
+  size_t i = __kmp_dephash_hash(addr, size);
+  while (slots[i].entry)
+    i = (i + 1) & (size - 1);
+  slots[i].addr = addr;
+  slots[i].entry = entry;
+}
+
+// Move up to nslots slots of the previous table to the current one. The old
+// table is not modified, so lookups can still probe the part not moved yet.
+static void __kmp_dephash_move(kmp_info_t *thread, kmp_dephash_t *h,
+                               size_t nslots) {
+  size_t end = KMP_MIN(h->old_moved + nslots, h->old_size);
+  for (size_t i = h->old_moved; i < end; i++) {
+    if (h->old_slots[i].entry)
+      __kmp_dephash_insert(h->slots, h->size, h->old_slots[i].addr,
+                           h->old_slots[i].entry);
   }
+  h->old_moved = end;
+  if (end == h->old_size) {
+    __kmp_dephash_free_slots(thread, h, h->old_slots);
+    h->old_slots = NULL;
+  }
+}
 
-  // Free old hash table
-#if USE_FAST_MEMORY
-  __kmp_fast_free(thread, current_dephash);
-#else
-  __kmp_thread_free(thread, current_dephash);
-#endif
+static void __kmp_dephash_extend(kmp_info_t *thread, kmp_dephash_t *h) {
+  if (h->old_slots) // finish the previous resize first
+    __kmp_dephash_move(thread, h, h->old_size);
 
-  return h;
+  h->old_slots = h->slots;
+  h->old_size = h->size;
+  h->old_moved = 0;
+  h->size *= 2;
+  h->slots = __kmp_dephash_alloc_slots(thread, h->size);
 }
 
 static kmp_dephash_t *__kmp_dephash_create(kmp_info_t *thread,
@@ -124,7 +136,7 @@ static kmp_dephash_t *__kmp_dephash_create(kmp_info_t *thread,
     h_size = KMP_DEPHASH_OTHER_SIZE;
 
   kmp_int32 size =
-      h_size * sizeof(kmp_dephash_entry_t *) + sizeof(kmp_dephash_t);
+      h_size * sizeof(kmp_dephash_slot_t) + sizeof(kmp_dephash_t);
 
 #if USE_FAST_MEMORY
   h = (kmp_dephash_t *)__kmp_fast_allocate(thread, size);
@@ -132,14 +144,14 @@ static kmp_dephash_t *__kmp_dephash_create(kmp_info_t *thread,
   h = (kmp_dephash_t *)__kmp_thread_malloc(thread, size);
 #endif
   h->size = h_size;
-
-  h->generation = 0;
   h->nelements = 0;
-  h->nconflicts = 0;
-  h->buckets = (kmp_dephash_entry **)(h + 1);
+  h->slots = (kmp_dephash_slot_t *)(h + 1);
+  h->old_slots = NULL;
+  h->old_size = 0;
+  h->old_moved = 0;
 
   for (size_t i = 0; i < h_size; i++)
-    h->buckets[i] = 0;
+    h->slots[i].entry = NULL;
 
   return h;
 }
@@ -148,41 +160,42 @@ static kmp_dephash_t *__kmp_dephash_create(kmp_info_t *thread,
 #define ENTRY_LAST_MTXS 1
 
 static kmp_dephash_entry *
-__kmp_dephash_find(kmp_info_t *thread, kmp_dephash_t **hash, kmp_intptr_t addr) {
-  kmp_dephash_t *h = *hash;
-  if (h->nelements != 0
-      && h->nconflicts/h->size >= 1) {
-    *hash = __kmp_dephash_extend(thread, h);
-    h = *hash;
+__kmp_dephash_find(kmp_info_t *thread, kmp_dephash_t *h, kmp_intptr_t addr) {
+  if (h->old_slots)
+    __kmp_dephash_move(thread, h, KMP_DEPHASH_MOVE_SLOTS);
+
+  for (size_t i = __kmp_dephash_hash(addr, h->size); h->slots[i].entry;
+       i = (i + 1) & (h->size - 1)) {
+    if (h->slots[i].addr == addr)
+      return h->slots[i].entry;
+  }
+  if (h->old_slots) {
+    for (size_t i = __kmp_dephash_hash(addr, h->old_size);
+         h->old_slots[i].entry; i = (i + 1) & (h->old_size - 1)) {
+      if (h->old_slots[i].addr == addr)
+        return h->old_slots[i].entry;
+    }
   }
-  kmp_int32 bucket = __kmp_dephash_hash(addr, h->size);
 
+  // create entry. This is only done by one thread so no locking required
   kmp_dephash_entry_t *entry;
-  for (entry = h->buckets[bucket]; entry; entry = entry->next_in_bucket)
-    if (entry->addr == addr)
-      break;
-
-  if (entry == NULL) {
-// create entry. This is only done by one thread so no locking required
 #if USE_FAST_MEMORY
-    entry = (kmp_dephash_entry_t *)__kmp_fast_allocate(
-        thread, sizeof(kmp_dephash_entry_t));
+  entry = (kmp_dephash_entry_t *)__kmp_fast_allocate(
+      thread, sizeof(kmp_dephash_entry_t));
 #else
-    entry = (kmp_dephash_entry_t *)__kmp_thread_malloc(
-        thread, sizeof(kmp_dephash_entry_t));
+  entry = (kmp_dephash_entry_t *)__kmp_thread_malloc(
+      thread, sizeof(kmp_dephash_entry_t));
 #endif
-    entry->addr = addr;
-    entry->last_out = NULL;
-    entry->last_ins = NULL;
-    entry->last_mtxs = NULL;
-    entry->last_flag = ENTRY_LAST_INS;
-    entry->mtx_lock = NULL;
-    entry->next_in_bucket = h->buckets[bucket];
-    h->buckets[bucket] = entry;
-    h->nelements++;
-    if (entry->next_in_bucket)
-      h->nconflicts++;
-  }
+  entry->addr = addr;
+  entry->last_out = NULL;
+  entry->last_ins = NULL;
+  entry->last_mtxs = NULL;
+  entry->last_flag = ENTRY_LAST_INS;
+  entry->mtx_lock = NULL;
+  // keep at most half of the slots in use so that probe sequences stay short
+  if (++h->nelements > h->size / 2)
+    __kmp_dephash_extend(thread, h);
+  __kmp_dephash_insert(h->slots, h->size, addr, entry);
   return entry;
 }
 
@@ -205,11 +218,32 @@ static kmp_depnode_list_t *__kmp_add_node(kmp_info_t *thread,
   return new_head;
 }
 
-static inline void __kmp_track_dependence(kmp_depnode_t *source,
+// __kmp_depnode_add_successor: push node on the list of successors of pred,
+// unless the task of pred has completed and closed the list in the meantime.
+// Returns true if pred will release node when it completes.
+static bool __kmp_depnode_add_successor(kmp_info_t *thread,
+                                        kmp_depnode_t *pred,
+                                        kmp_depnode_t *node) {
+  kmp_depnode_list_t *head = KMP_ATOMIC_LD_ACQ(&pred->dn.successors);
+  if (head == KMP_DEPNODE_CLOSED)
+    return false;
+  kmp_depnode_list_t *new_head = __kmp_add_node(thread, head, node);
+  while (!pred->dn.successors.compare_exchange_weak(new_head->next, new_head)) {
+    if (new_head->next == KMP_DEPNODE_CLOSED) {
+      new_head->next = NULL;
+      __kmp_depnode_list_free(thread, new_head);
+      return false;
+    }
+  }
+  return true;
+}
+
+static inline void __kmp_track_dependence(kmp_task_t *source_task,
+                                          kmp_depnode_t *source,
                                           kmp_depnode_t *sink,
                                           kmp_task_t *sink_task) {
 #ifdef KMP_SUPPORT_GRAPH_OUTPUT
-  kmp_taskdata_t *task_source = KMP_TASK_TO_TASKDATA(source->dn.task);
+  kmp_taskdata_t *task_source = KMP_TASK_TO_TASKDATA(source_task);
   // do not use sink->dn.task as that is only filled after the dependencies
   // are already processed!
   kmp_taskdata_t *task_sink = KMP_TASK_TO_TASKDATA(sink_task);
@@ -223,7 +257,7 @@ static inline void __kmp_track_dependence(kmp_depnode_t *source,
      task a blocks the execution of b through the ompt_new_dependence_callback
      */
   if (ompt_enabled.ompt_callback_task_dependence) {
-    kmp_taskdata_t *task_source = KMP_TASK_TO_TASKDATA(source->dn.task);
+    kmp_taskdata_t *task_source = KMP_TASK_TO_TASKDATA(source_task);
     kmp_taskdata_t *task_sink = KMP_TASK_TO_TASKDATA(sink_task);
 
     ompt_callbacks.ompt_callback(ompt_callback_task_dependence)(
@@ -233,6 +267,38 @@ static inline void __kmp_track_dependence(kmp_depnode_t *source,
 #endif /* OMPT_SUPPORT && OMPT_OPTIONAL */
 }
 
+// Task graph recording: the list of (predecessor, successor) edges grows
+// with the graph and is turned into the successor lists of the nodes once the
+// recording is complete.
+static void __kmp_taskgraph_add_edge(kmp_info_t *thread, kmp_int32 pred,
+                                     kmp_int32 succ) {
+  kmp_taskgraph_t *graph = thread->th.th_current_task->td_taskgraph;
+  KMP_DEBUG_ASSERT(graph != NULL && pred < succ);
+  if (graph->tg_status != tg_recording)
+    return;
+  if (pred < 0) { // not created in the region, cannot be replayed
+    graph->tg_status = tg_unsupported;
+    return;
+  }
+  if (graph->tg_nedges == graph->tg_max_edges) {
+    kmp_int32 max_edges = graph->tg_max_edges ? 2 * graph->tg_max_edges : 256;
+    kmp_int32 *edges =
+        (kmp_int32 *)__kmp_allocate(2 * max_edges * sizeof(kmp_int32));
+    if (graph->tg_edges) {
+      KMP_MEMCPY(edges, graph->tg_edges,
+                 2 * graph->tg_nedges * sizeof(kmp_int32));
+      __kmp_free(graph->tg_edges);
+    }
+    graph->tg_edges = edges;
+    graph->tg_max_edges = max_edges;
+  }
+  graph->tg_edges[2 * graph->tg_nedges] = pred;
+  graph->tg_edges[2 * graph->tg_nedges + 1] = succ;
+  graph->tg_nedges++;
+  graph->tg_nodes[pred].tgn_nsuccessors++;
+  graph->tg_nodes[succ].tgn_npredecessors++;
+}
+
 static inline kmp_int32
 __kmp_depnode_link_successor(kmp_int32 gtid, kmp_info_t *thread,
                              kmp_task_t *task, kmp_depnode_t *node,
@@ -243,19 +309,29 @@ __kmp_depnode_link_successor(kmp_int32 gtid, kmp_info_t *thread,
   // link node as successor of list elements
   for (kmp_depnode_list_t *p = plist; p; p = p->next) {
     kmp_depnode_t *dep = p->node;
-    if (dep->dn.task) {
+    // the recorded graph also needs the edges from tasks already finished
+    if (node->dn.tg_index >= 0)
+      __kmp_taskgraph_add_edge(thread, dep->dn.tg_index, node->dn.tg_index);
+    kmp_task_t *dep_task = dep->dn.task;
+    if (!dep_task)
+      continue;
+    bool tracked = __kmp_depnode_tracked();
+    if (tracked)
       KMP_ACQUIRE_DEPNODE(gtid, dep);
-      if (dep->dn.task) {
-        __kmp_track_dependence(dep, node, task);
-        dep->dn.successors = __kmp_add_node(thread, dep->dn.successors, node);
-        KA_TRACE(40, ("__kmp_process_deps: T#%d adding dependence from %p to "
-                      "%p\n",
-                      gtid, KMP_TASK_TO_TASKDATA(dep->dn.task),
-                      KMP_TASK_TO_TASKDATA(task)));
-        npredecessors++;
-      }
-      KMP_RELEASE_DEPNODE(gtid, dep);
+    if (__kmp_depnode_add_successor(thread, dep, node)) {
+      if (tracked)
+        __kmp_track_dependence(dep_task, dep, node, task);
+      KA_TRACE(40, ("__kmp_process_deps: T#%d adding dependence from %p to "
+                    "%p\n",
+                    gtid, KMP_TASK_TO_TASKDATA(dep_task),
+                    KMP_TASK_TO_TASKDATA(task)));
+      npredecessors++;
+      if (__kmp_task_critical_path && task != NULL)
+        node->dn.predecessors =
+            __kmp_add_node(thread, node->dn.predecessors, dep);
     }
+    if (tracked)
+      KMP_RELEASE_DEPNODE(gtid, dep);
   }
   return npredecessors;
 }
@@ -268,26 +344,35 @@ static inline kmp_int32 __kmp_depnode_link_successor(kmp_int32 gtid,
   if (!sink)
     return 0;
   kmp_int32 npredecessors = 0;
-  if (sink->dn.task) {
-    // synchronously add source to sink' list of successors
+  if (source->dn.tg_index >= 0)
+    __kmp_taskgraph_add_edge(thread, sink->dn.tg_index, source->dn.tg_index);
+  kmp_task_t *sink_task = sink->dn.task;
+  if (!sink_task)
+    return 0;
+  bool tracked = __kmp_depnode_tracked();
+  if (tracked)
     KMP_ACQUIRE_DEPNODE(gtid, sink);
-    if (sink->dn.task) {
-      __kmp_track_dependence(sink, source, task);
-      sink->dn.successors = __kmp_add_node(thread, sink->dn.successors, source);
-      KA_TRACE(40, ("__kmp_process_deps: T#%d adding dependence from %p to "
-                    "%p\n",
-                    gtid, KMP_TASK_TO_TASKDATA(sink->dn.task),
-                    KMP_TASK_TO_TASKDATA(task)));
-      npredecessors++;
-    }
-    KMP_RELEASE_DEPNODE(gtid, sink);
+  // add source to sink' list of successors, unless sink has completed
+  if (__kmp_depnode_add_successor(thread, sink, source)) {
+    if (tracked)
+      __kmp_track_dependence(sink_task, sink, source, task);
+    KA_TRACE(40, ("__kmp_process_deps: T#%d adding dependence from %p to "
+                  "%p\n",
+                  gtid, KMP_TASK_TO_TASKDATA(sink_task),
+                  KMP_TASK_TO_TASKDATA(task)));
+    npredecessors++;
+    if (__kmp_task_critical_path && task != NULL)
+      source->dn.predecessors =
+          __kmp_add_node(thread, source->dn.predecessors, sink);
   }
+  if (tracked)
+    KMP_RELEASE_DEPNODE(gtid, sink);
   return npredecessors;
 }
 
 template <bool filter>
 static inline kmp_int32
-__kmp_process_deps(kmp_int32 gtid, kmp_depnode_t *node, kmp_dephash_t **hash,
+__kmp_process_deps(kmp_int32 gtid, kmp_depnode_t *node, kmp_dephash_t *hash,
                    bool dep_barrier, kmp_int32 ndeps,
                    kmp_depend_info_t *dep_list, kmp_task_t *task) {
   KA_TRACE(30, ("__kmp_process_deps<%d>: T#%d processing %d dependencies : "
@@ -374,8 +459,10 @@ __kmp_process_deps(kmp_int32 gtid, kmp_depnode_t *node, kmp_dephash_t **hash,
       info->last_flag = ENTRY_LAST_MTXS;
       info->last_mtxs = __kmp_add_node(thread, info->last_mtxs, node);
       if (info->mtx_lock == NULL) {
-        info->mtx_lock = (kmp_lock_t *)__kmp_allocate(sizeof(kmp_lock_t));
-        __kmp_init_lock(info->mtx_lock);
+        // __kmp_allocate zeroes the memory: not owned, no parked task
+        info->mtx_lock =
+            (kmp_mtx_dep_t *)__kmp_allocate(sizeof(kmp_mtx_dep_t));
+        __kmp_init_bootstrap_lock(&info->mtx_lock->md_lock);
       }
       KMP_DEBUG_ASSERT(node->dn.mtx_num_locks < MAX_MTX_DEPS);
       kmp_int32 m;
@@ -405,9 +492,26 @@ __kmp_process_deps(kmp_int32 gtid, kmp_depnode_t *node, kmp_dephash_t **hash,
 #define NO_DEP_BARRIER (false)
 #define DEP_BARRIER (true)
 
+// __kmp_raise_bottom_level: a path of level tasks now leads from node to a
+// sink of the graph. Propagate the longer path to the unfinished predecessors
+// of node, up to depth levels up. Only the thread adding tasks to the graph
+// updates the estimate, the predecessors lists are freed by finishing tasks.
+static void __kmp_raise_bottom_level(kmp_int32 gtid, kmp_depnode_t *node,
+                                     kmp_int32 level, kmp_int32 depth) {
+  if (KMP_ATOMIC_LD_RLX(&node->dn.bottom_level) >= level || !node->dn.task)
+    return;
+  KMP_ATOMIC_ST_RLX(&node->dn.bottom_level, level);
+  if (--depth == 0)
+    return;
+  KMP_ACQUIRE_DEPNODE(gtid, node);
+  for (kmp_depnode_list_t *p = node->dn.predecessors; p; p = p->next)
+    __kmp_raise_bottom_level(gtid, p->node, level + 1, depth);
+  KMP_RELEASE_DEPNODE(gtid, node);
+}
+
 // returns true if the task has any outstanding dependence
 static bool __kmp_check_deps(kmp_int32 gtid, kmp_depnode_t *node,
-                             kmp_task_t *task, kmp_dephash_t **hash,
+                             kmp_task_t *task, kmp_dephash_t *hash,
                              bool dep_barrier, kmp_int32 ndeps,
                              kmp_depend_info_t *dep_list,
                              kmp_int32 ndeps_noalias,
@@ -466,6 +570,10 @@ static bool __kmp_check_deps(kmp_int32 gtid, kmp_depnode_t *node,
   npredecessors += __kmp_process_deps<false>(
       gtid, node, hash, dep_barrier, ndeps_noalias, noalias_dep_list, task);
 
+  // the new task is a sink, its predecessors are at least one task longer
+  for (kmp_depnode_list_t *p = node->dn.predecessors; p; p = p->next)
+    __kmp_raise_bottom_level(gtid, p->node, 1, __kmp_task_critical_path);
+
   node->dn.task = task;
   KMP_MB();
 
@@ -486,6 +594,159 @@ static bool __kmp_check_deps(kmp_int32 gtid, kmp_depnode_t *node,
   return npredecessors > 0 ? true : false;
 }
 
+// Task graphs recorded so far, looked up when a region begins
+static kmp_taskgraph_t *__kmp_taskgraphs = NULL;
+static kmp_bootstrap_lock_t __kmp_taskgraph_lock =
+    KMP_BOOTSTRAP_LOCK_INITIALIZER(__kmp_taskgraph_lock);
+
+// __kmp_taskgraph_deps_hash: hash the addresses and types of the depend items
+// of a task, in their order, to check that a replayed task has the same
+// dependences as the recorded one
+static kmp_uint64
+__kmp_taskgraph_deps_hash(kmp_int32 ndeps, kmp_depend_info_t *dep_list,
+                          kmp_int32 ndeps_noalias,
+                          kmp_depend_info_t *noalias_dep_list) {
+  kmp_uint64 hash = 14695981039346656037ULL; // FNV-1a
+  for (kmp_int32 i = 0; i < ndeps + ndeps_noalias; ++i) {
+    kmp_depend_info_t *dep =
+        i < ndeps ? &dep_list[i] : &noalias_dep_list[i - ndeps];
+    kmp_uint64 type = dep->flags.in | dep->flags.out << 1 | dep->flags.mtx << 2;
+    hash = (hash ^ (kmp_uint64)dep->base_addr) * 1099511628211ULL;
+    hash = (hash ^ type) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// __kmp_taskgraph_record_task: add the task to the graph being recorded. The
+// edges are added while its dependences are processed.
+static void __kmp_taskgraph_record_task(kmp_taskgraph_t *graph,
+                                        kmp_taskdata_t *taskdata,
+                                        kmp_depnode_t *node, kmp_int32 ndeps,
+                                        kmp_depend_info_t *dep_list,
+                                        kmp_int32 ndeps_noalias,
+                                        kmp_depend_info_t *noalias_dep_list) {
+  // mutexinoutset locks live in the dependence hash, and the completion of
+  // proxy and detached tasks is not tracked by the replay
+  bool supported = taskdata->td_flags.proxy == TASK_FULL &&
+                   taskdata->td_flags.detachable == TASK_UNDETACHABLE;
+  for (kmp_int32 i = 0; supported && i < ndeps; ++i)
+    supported = !dep_list[i].flags.mtx;
+  for (kmp_int32 i = 0; supported && i < ndeps_noalias; ++i)
+    supported = !noalias_dep_list[i].flags.mtx;
+  if (!supported) {
+    graph->tg_status = tg_unsupported;
+    return;
+  }
+
+  if (graph->tg_ntasks == graph->tg_max_tasks) {
+    kmp_int32 max_tasks = graph->tg_max_tasks ? 2 * graph->tg_max_tasks : 64;
+    kmp_taskgraph_node_t *nodes = (kmp_taskgraph_node_t *)__kmp_allocate(
+        max_tasks * sizeof(kmp_taskgraph_node_t));
+    if (graph->tg_nodes) {
+      KMP_MEMCPY(nodes, graph->tg_nodes,
+                 graph->tg_ntasks * sizeof(kmp_taskgraph_node_t));
+      __kmp_free(graph->tg_nodes);
+    }
+    graph->tg_nodes = nodes;
+    graph->tg_max_tasks = max_tasks;
+  }
+  kmp_taskgraph_node_t *tg_node = &graph->tg_nodes[graph->tg_ntasks];
+  tg_node->tgn_ndeps = ndeps + ndeps_noalias;
+  tg_node->tgn_deps_hash = __kmp_taskgraph_deps_hash(
+      ndeps, dep_list, ndeps_noalias, noalias_dep_list);
+  tg_node->tgn_npredecessors = 0;
+  tg_node->tgn_nsuccessors = 0;
+  tg_node->tgn_successors = NULL;
+  node->dn.tg_index = graph->tg_ntasks++;
+}
+
+// __kmp_taskgraph_finish_recording: build the successor lists of the nodes
+static void __kmp_taskgraph_finish_recording(kmp_taskgraph_t *graph) {
+  if (graph->tg_nedges > 0)
+    graph->tg_successors = (kmp_taskgraph_node_t **)__kmp_allocate(
+        graph->tg_nedges * sizeof(kmp_taskgraph_node_t *));
+  kmp_int32 pos = 0;
+  for (kmp_int32 i = 0; i < graph->tg_ntasks; ++i) {
+    kmp_taskgraph_node_t *tg_node = &graph->tg_nodes[i];
+    tg_node->tgn_successors = &graph->tg_successors[pos];
+    pos += tg_node->tgn_nsuccessors;
+    tg_node->tgn_nsuccessors = 0; // counted again while filling the list
+  }
+  for (kmp_int32 e = 0; e < graph->tg_nedges; ++e) {
+    kmp_taskgraph_node_t *pred = &graph->tg_nodes[graph->tg_edges[2 * e]];
+    pred->tgn_successors[pred->tgn_nsuccessors++] =
+        &graph->tg_nodes[graph->tg_edges[2 * e + 1]];
+  }
+  if (graph->tg_edges)
+    __kmp_free(graph->tg_edges);
+  graph->tg_edges = NULL;
+  graph->tg_max_edges = 0;
+}
+
+// __kmp_taskgraph_clear: drop the recording, e.g. to record the graph again
+static void __kmp_taskgraph_clear(kmp_taskgraph_t *graph) {
+  if (graph->tg_nodes)
+    __kmp_free(graph->tg_nodes);
+  if (graph->tg_edges)
+    __kmp_free(graph->tg_edges);
+  if (graph->tg_successors)
+    __kmp_free(graph->tg_successors);
+  graph->tg_nodes = NULL;
+  graph->tg_edges = NULL;
+  graph->tg_successors = NULL;
+  graph->tg_ntasks = graph->tg_max_tasks = 0;
+  graph->tg_nedges = graph->tg_max_edges = 0;
+}
+
+// __kmp_taskgraph_fallback: stop replaying the graph, e.g. because the region
+// does not create the recorded tasks. The tasks created so far are waited for,
+// as they are not in the dependence hash used by the following tasks. The task
+// being created is already a child of the current task, so it is not waited
+// for.
+static void __kmp_taskgraph_fallback(ident_t *loc_ref, kmp_int32 gtid,
+                                     kmp_taskgraph_t *graph) {
+  KA_TRACE(10, ("__kmp_taskgraph_fallback: T#%d stops replaying task graph %d "
+                "after %d of %d tasks: loc=%p\n",
+                gtid, graph->tg_id, graph->tg_next_task, graph->tg_ntasks,
+                loc_ref));
+  graph->tg_status = tg_fallback;
+  kmp_info_t *thread = __kmp_threads[gtid];
+  kmp_taskdata_t *current_task = thread->th.th_current_task;
+  int thread_finished = FALSE;
+  kmp_flag_32 flag(
+      (std::atomic<kmp_uint32> *)&current_task->td_incomplete_child_tasks, 1U);
+  while (KMP_ATOMIC_LD_ACQ(&current_task->td_incomplete_child_tasks) > 1) {
+    flag.execute_tasks(thread, gtid, FALSE,
+                       &thread_finished USE_ITT_BUILD_ARG(NULL),
+                       __kmp_task_stealing_constraint);
+  }
+}
+
+// __kmp_taskgraph_replay_task: instantiate the next node of the graph being
+// replayed with the new task. Returns false if the task does not match the
+// recording, i.e. its depend items differ from those of the recorded task, in
+// which case its dependences must be processed as usual.
+static bool __kmp_taskgraph_replay_task(
+    ident_t *loc_ref, kmp_int32 gtid, kmp_taskgraph_t *graph,
+    kmp_taskdata_t *taskdata, kmp_int32 ndeps, kmp_depend_info_t *dep_list,
+    kmp_int32 ndeps_noalias, kmp_depend_info_t *noalias_dep_list) {
+  if (graph->tg_next_task == graph->tg_ntasks ||
+      graph->tg_nodes[graph->tg_next_task].tgn_ndeps !=
+          ndeps + ndeps_noalias ||
+      graph->tg_nodes[graph->tg_next_task].tgn_deps_hash !=
+          __kmp_taskgraph_deps_hash(ndeps, dep_list, ndeps_noalias,
+                                    noalias_dep_list) ||
+      taskdata->td_flags.proxy == TASK_PROXY ||
+      taskdata->td_flags.detachable == TASK_DETACHABLE) {
+    __kmp_taskgraph_fallback(loc_ref, gtid, graph);
+    return false;
+  }
+  kmp_taskgraph_node_t *tg_node = &graph->tg_nodes[graph->tg_next_task++];
+  tg_node->tgn_task = KMP_TASKDATA_TO_TASK(taskdata);
+  taskdata->td_taskgraph_node = tg_node;
+  return true;
+}
+
 /*!
 @ingroup TASKING
 @param loc_ref location of the original task directive
@@ -591,7 +852,26 @@ kmp_int32 __kmpc_omp_task_with_deps(ident_t *loc_ref, kmp_int32 gtid,
   kmp_task_team_t *task_team = thread->th.th_task_team;
   serial = serial && !(task_team && task_team->tt.tt_found_proxy_tasks);
 
-  if (!serial && (ndeps > 0 || ndeps_noalias > 0)) {
+  kmp_taskgraph_t *graph = current_task->td_taskgraph;
+  if (graph && graph->tg_status == tg_replaying && !serial &&
+      (ndeps > 0 || ndeps_noalias > 0) &&
+      __kmp_taskgraph_replay_task(loc_ref, gtid, graph, new_taskdata, ndeps,
+                                  dep_list, ndeps_noalias, noalias_dep_list)) {
+    // The task is scheduled by its last predecessor to finish, unless they
+    // all finished already
+    if (KMP_ATOMIC_DEC(&new_taskdata->td_taskgraph_node->tgn_npending) != 1) {
+      KA_TRACE(10, ("__kmpc_omp_task_with_deps(exit): T#%d replayed task had "
+                    "blocking dependencies: "
+                    "loc=%p task=%p, return: TASK_CURRENT_NOT_QUEUED\n",
+                    gtid, loc_ref, new_taskdata));
+#if OMPT_SUPPORT
+      if (ompt_enabled.enabled) {
+        current_task->ompt_task_info.frame.enter_frame = ompt_data_none;
+      }
+#endif
+      return TASK_CURRENT_NOT_QUEUED;
+    }
+  } else if (!serial && (ndeps > 0 || ndeps_noalias > 0)) {
     /* if no dependencies have been tracked yet, create the dependence hash */
     if (current_task->td_dephash == NULL)
       current_task->td_dephash = __kmp_dephash_create(thread, current_task);
@@ -606,8 +886,11 @@ kmp_int32 __kmpc_omp_task_with_deps(ident_t *loc_ref, kmp_int32 gtid,
 
     __kmp_init_node(node);
     new_taskdata->td_depnode = node;
+    if (graph && graph->tg_status == tg_recording)
+      __kmp_taskgraph_record_task(graph, new_taskdata, node, ndeps, dep_list,
+                                  ndeps_noalias, noalias_dep_list);
 
-    if (__kmp_check_deps(gtid, node, new_task, &current_task->td_dephash,
+    if (__kmp_check_deps(gtid, node, new_task, current_task->td_dephash,
                          NO_DEP_BARRIER, ndeps, dep_list, ndeps_noalias,
                          noalias_dep_list)) {
       KA_TRACE(10, ("__kmpc_omp_task_with_deps(exit): T#%d task had blocking "
@@ -668,6 +951,13 @@ void __kmpc_omp_wait_deps(ident_t *loc_ref, kmp_int32 gtid, kmp_int32 ndeps,
   kmp_info_t *thread = __kmp_threads[gtid];
   kmp_taskdata_t *current_task = thread->th.th_current_task;
 
+  // The replay of a task graph cannot wait for part of its tasks
+  kmp_taskgraph_t *graph = current_task->td_taskgraph;
+  if (graph && graph->tg_status == tg_recording)
+    graph->tg_status = tg_unsupported;
+  else if (graph && graph->tg_status == tg_replaying)
+    __kmp_taskgraph_fallback(loc_ref, gtid, graph);
+
   // We can return immediately as:
   // - dependences are not computed in serial teams (except with proxy tasks)
   // - if the dephash is not yet created it means we have nothing to wait for
@@ -688,7 +978,7 @@ void __kmpc_omp_wait_deps(ident_t *loc_ref, kmp_int32 gtid, kmp_int32 ndeps,
   kmp_depnode_t node = {0};
   __kmp_init_node(&node);
 
-  if (!__kmp_check_deps(gtid, &node, NULL, &current_task->td_dephash,
+  if (!__kmp_check_deps(gtid, &node, NULL, current_task->td_dephash,
                         DEP_BARRIER, ndeps, dep_list, ndeps_noalias,
                         noalias_dep_list)) {
     KA_TRACE(10, ("__kmpc_omp_wait_deps(exit): T#%d has no blocking "
@@ -708,3 +998,153 @@ void __kmpc_omp_wait_deps(ident_t *loc_ref, kmp_int32 gtid, kmp_int32 ndeps,
   KA_TRACE(10, ("__kmpc_omp_wait_deps(exit): T#%d finished waiting : loc=%p\n",
                 gtid, loc_ref));
 }
+
+/*!
+@ingroup TASKING
+@param loc_ref location of the task graph region
+@param gtid Global Thread ID of encountering thread
+@param graph_id identifier of the task graph, along with loc_ref
+
+@return 1 if the region replays a recorded task graph, 0 otherwise
+
+Begin a task graph region. The first time the region identified by loc_ref and
+graph_id is executed, the dependence graph of the tasks it creates is recorded.
+When it is executed again, the tasks are expected to be created in the same
+order with the same depend items (addresses and dependence types), so they are
+linked as in the recording without processing their dependences. The items are
+compared through a hash, recorded for each task. If they do not match, the
+runtime waits for the tasks
+created so far and tracks the dependences of the remaining tasks as usual, and
+the graph is recorded again next time.
+
+The region begins by waiting for the child tasks of the current task, so the
+tasks of the graph only depend on each other, and __kmpc_taskgraph_end waits
+for all of them. Graphs with mutexinoutset dependences, detachable or proxy
+tasks, or waits on dependences are never replayed. Nested regions are executed
+as part of the enclosing one.
+*/
+kmp_int32 __kmpc_taskgraph_begin(ident_t *loc_ref, kmp_int32 gtid,
+                                 kmp_int32 graph_id) {
+  kmp_info_t *thread = __kmp_threads[gtid];
+  kmp_taskdata_t *current_task = thread->th.th_current_task;
+  KA_TRACE(10, ("__kmpc_taskgraph_begin(enter): T#%d loc=%p graph_id=%d\n",
+                gtid, loc_ref, graph_id));
+
+  __kmpc_omp_taskwait(loc_ref, gtid);
+  if (current_task->td_taskgraph) {
+    current_task->td_taskgraph->tg_nesting++;
+    return current_task->td_taskgraph->tg_status == tg_replaying;
+  }
+  // Dependences are not tracked in serial teams, nothing to record
+  if (current_task->td_flags.team_serial || current_task->td_flags.tasking_ser ||
+      current_task->td_flags.final)
+    return 0;
+
+  __kmp_acquire_bootstrap_lock(&__kmp_taskgraph_lock);
+  kmp_taskgraph_t *graph;
+  for (graph = __kmp_taskgraphs; graph; graph = graph->tg_next) {
+    if (graph->tg_loc == loc_ref && graph->tg_id == graph_id)
+      break;
+  }
+  if (graph == NULL) {
+    graph = (kmp_taskgraph_t *)__kmp_allocate(sizeof(kmp_taskgraph_t));
+    graph->tg_loc = loc_ref;
+    graph->tg_id = graph_id;
+    graph->tg_status = tg_empty;
+    graph->tg_next = __kmp_taskgraphs;
+    __kmp_taskgraphs = graph;
+  }
+  kmp_taskgraph_status_t status = graph->tg_status;
+  if (status == tg_empty)
+    graph->tg_status = tg_recording;
+  else if (status == tg_ready)
+    graph->tg_status = tg_replaying;
+  __kmp_release_bootstrap_lock(&__kmp_taskgraph_lock);
+
+  // Run the region as usual if the graph is in use by another task
+  if (status != tg_empty && status != tg_ready) {
+    KA_TRACE(10, ("__kmpc_taskgraph_begin(exit): T#%d task graph %d not "
+                  "recorded nor replayed (status %d)\n",
+                  gtid, graph_id, status));
+    return 0;
+  }
+
+  // All the children are complete, the dependences of the region start from
+  // a new dependence hash
+  graph->tg_nesting = 0;
+  graph->tg_saved_dephash = current_task->td_dephash;
+  current_task->td_dephash = NULL;
+  current_task->td_taskgraph = graph;
+
+  if (status == tg_ready) {
+    for (kmp_int32 i = 0; i < graph->tg_ntasks; ++i) {
+      kmp_taskgraph_node_t *tg_node = &graph->tg_nodes[i];
+      KMP_ATOMIC_ST_RLX(&tg_node->tgn_npending,
+                        tg_node->tgn_npredecessors + 1);
+      tg_node->tgn_task = NULL;
+    }
+    graph->tg_next_task = 0;
+  }
+  KA_TRACE(10, ("__kmpc_taskgraph_begin(exit): T#%d %s task graph %d\n", gtid,
+                status == tg_ready ? "replays" : "records", graph_id));
+  return status == tg_ready;
+}
+
+/*!
+@ingroup TASKING
+@param loc_ref location of the task graph region
+@param gtid Global Thread ID of encountering thread
+
+End a task graph region, waiting for all the tasks created in the region.
+*/
+void __kmpc_taskgraph_end(ident_t *loc_ref, kmp_int32 gtid) {
+  kmp_info_t *thread = __kmp_threads[gtid];
+  kmp_taskdata_t *current_task = thread->th.th_current_task;
+  kmp_taskgraph_t *graph = current_task->td_taskgraph;
+  KA_TRACE(10, ("__kmpc_taskgraph_end(enter): T#%d loc=%p\n", gtid, loc_ref));
+
+  __kmpc_omp_taskwait(loc_ref, gtid);
+  if (graph == NULL)
+    return;
+  if (graph->tg_nesting > 0) {
+    graph->tg_nesting--;
+    return;
+  }
+
+  if (current_task->td_dephash)
+    __kmp_dephash_free(thread, current_task->td_dephash);
+  current_task->td_dephash = graph->tg_saved_dephash;
+  current_task->td_taskgraph = NULL;
+
+  kmp_taskgraph_status_t status = graph->tg_status;
+  if (status == tg_recording) {
+    __kmp_taskgraph_finish_recording(graph);
+    status = tg_ready;
+  } else if (status == tg_replaying && graph->tg_next_task == graph->tg_ntasks) {
+    status = tg_ready;
+  } else {
+    // Fewer or different tasks than recorded: record the graph again, unless
+    // it cannot be replayed at all
+    __kmp_taskgraph_clear(graph);
+    if (status != tg_unsupported)
+      status = tg_empty;
+  }
+  KA_TRACE(10, ("__kmpc_taskgraph_end(exit): T#%d task graph %d: %d tasks, "
+                "status %d\n",
+                gtid, graph->tg_id, graph->tg_ntasks, status));
+  __kmp_acquire_bootstrap_lock(&__kmp_taskgraph_lock);
+  graph->tg_status = status;
+  __kmp_release_bootstrap_lock(&__kmp_taskgraph_lock);
+}
+
+// __kmp_free_taskgraphs: free the recorded task graphs at library shutdown
+void __kmp_free_taskgraphs(void) {
+  __kmp_acquire_bootstrap_lock(&__kmp_taskgraph_lock);
+  while (__kmp_taskgraphs) {
+    kmp_taskgraph_t *graph = __kmp_taskgraphs;
+    __kmp_taskgraphs = graph->tg_next;
+    __kmp_taskgraph_clear(graph);
+    __kmp_free(graph);
+  }
+  __kmp_release_bootstrap_lock(&__kmp_taskgraph_lock);
+}
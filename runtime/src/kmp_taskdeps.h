@@ -20,6 +20,20 @@
 #define KMP_ACQUIRE_DEPNODE(gtid, n) __kmp_acquire_lock(&(n)->dn.lock, (gtid))
 #define KMP_RELEASE_DEPNODE(gtid, n) __kmp_release_lock(&(n)->dn.lock, (gtid))
 
+// Successors are linked without the depnode lock, unless the edges are
+// reported to a tool or printed: the predecessor task must then stay alive
+// until the report is done, so the successors are linked, reported and
+// released under the lock of the predecessor depnode
+static inline bool __kmp_depnode_tracked() {
+#ifdef KMP_SUPPORT_GRAPH_OUTPUT
+  return true;
+#elif OMPT_SUPPORT && OMPT_OPTIONAL
+  return ompt_enabled.ompt_callback_task_dependence;
+#else
+  return false;
+#endif
+}
+
 static inline void __kmp_node_deref(kmp_info_t *thread, kmp_depnode_t *node) {
   if (!node)
     return;
@@ -51,33 +65,58 @@ static inline void __kmp_depnode_list_free(kmp_info_t *thread,
   }
 }
 
-static inline void __kmp_dephash_free_entries(kmp_info_t *thread,
-                                              kmp_dephash_t *h) {
-  for (size_t i = 0; i < h->size; i++) {
-    if (h->buckets[i]) {
-      kmp_dephash_entry_t *next;
-      for (kmp_dephash_entry_t *entry = h->buckets[i]; entry; entry = next) {
-        next = entry->next_in_bucket;
-        __kmp_depnode_list_free(thread, entry->last_ins);
-        __kmp_depnode_list_free(thread, entry->last_mtxs);
-        __kmp_node_deref(thread, entry->last_out);
-        if (entry->mtx_lock) {
-          __kmp_destroy_lock(entry->mtx_lock);
-          __kmp_free(entry->mtx_lock);
-        }
+// Slots of the initial table are allocated along with the kmp_dephash_t
+static inline void __kmp_dephash_free_slots(kmp_info_t *thread,
+                                            kmp_dephash_t *h,
+                                            kmp_dephash_slot_t *slots) {
+  if (slots == (kmp_dephash_slot_t *)(h + 1))
+    return;
 #if USE_FAST_MEMORY
-        __kmp_fast_free(thread, entry);
+  __kmp_fast_free(thread, slots);
 #else
-        __kmp_thread_free(thread, entry);
+  __kmp_thread_free(thread, slots);
 #endif
-      }
-      h->buckets[i] = 0;
+}
+
+static inline void __kmp_dephash_free_entry(kmp_info_t *thread,
+                                            kmp_dephash_entry_t *entry) {
+  __kmp_depnode_list_free(thread, entry->last_ins);
+  __kmp_depnode_list_free(thread, entry->last_mtxs);
+  __kmp_node_deref(thread, entry->last_out);
+  if (entry->mtx_lock) {
+    __kmp_destroy_bootstrap_lock(&entry->mtx_lock->md_lock);
+    __kmp_free(entry->mtx_lock);
+  }
+#if USE_FAST_MEMORY
+  __kmp_fast_free(thread, entry);
+#else
+  __kmp_thread_free(thread, entry);
+#endif
+}
+
+static inline void __kmp_dephash_free_entries(kmp_info_t *thread,
+                                              kmp_dephash_t *h) {
+  for (size_t i = 0; i < h->size; i++) {
+    if (h->slots[i].entry) {
+      __kmp_dephash_free_entry(thread, h->slots[i].entry);
+      h->slots[i].entry = NULL;
+    }
+  }
+  if (h->old_slots) {
+    // entries not moved to the new table yet
+    for (size_t i = h->old_moved; i < h->old_size; i++) {
+      if (h->old_slots[i].entry)
+        __kmp_dephash_free_entry(thread, h->old_slots[i].entry);
     }
+    __kmp_dephash_free_slots(thread, h, h->old_slots);
+    h->old_slots = NULL;
   }
+  h->nelements = 0;
 }
 
 static inline void __kmp_dephash_free(kmp_info_t *thread, kmp_dephash_t *h) {
   __kmp_dephash_free_entries(thread, h);
+  __kmp_dephash_free_slots(thread, h, h->slots);
 #if USE_FAST_MEMORY
   __kmp_fast_free(thread, h);
 #else
@@ -85,7 +124,11 @@ static inline void __kmp_dephash_free(kmp_info_t *thread, kmp_dephash_t *h) {
 #endif
 }
 
-static inline void __kmp_release_deps(kmp_int32 gtid, kmp_taskdata_t *task) {
+// __kmp_release_deps: notify the successors of a finished task, scheduling
+// those whose predecessors are all done. If bypass is not NULL, the first of
+// them is returned there for the caller to execute instead of being queued.
+static inline void __kmp_release_deps(kmp_int32 gtid, kmp_taskdata_t *task,
+                                      kmp_task_t **bypass = NULL) {
   kmp_info_t *thread = __kmp_threads[gtid];
   kmp_depnode_t *node = task->td_depnode;
 
@@ -103,13 +146,30 @@ static inline void __kmp_release_deps(kmp_int32 gtid, kmp_taskdata_t *task) {
   KA_TRACE(20, ("__kmp_release_deps: T#%d notifying successors of task %p.\n",
                 gtid, task));
 
-  KMP_ACQUIRE_DEPNODE(gtid, node);
+  bool tracked = __kmp_depnode_tracked();
+  if (tracked)
+    KMP_ACQUIRE_DEPNODE(gtid, node);
   node->dn.task =
       NULL; // mark this task as finished, so no new dependencies are generated
-  KMP_RELEASE_DEPNODE(gtid, node);
+  // Close the list of successors: a successor pushed before is released
+  // below, later ones see the task completed and do not wait for it
+  kmp_depnode_list_t *successors =
+      node->dn.successors.exchange(KMP_DEPNODE_CLOSED);
+  if (tracked)
+    KMP_RELEASE_DEPNODE(gtid, node);
+
+  // the critical path estimate is not propagated to finished tasks; the
+  // list is only written before the task is queued
+  if (node->dn.predecessors) {
+    KMP_ACQUIRE_DEPNODE(gtid, node);
+    kmp_depnode_list_t *predecessors = node->dn.predecessors;
+    node->dn.predecessors = NULL;
+    KMP_RELEASE_DEPNODE(gtid, node);
+    __kmp_depnode_list_free(thread, predecessors);
+  }
 
   kmp_depnode_list_t *next;
-  for (kmp_depnode_list_t *p = node->dn.successors; p; p = next) {
+  for (kmp_depnode_list_t *p = successors; p; p = next) {
     kmp_depnode_t *successor = p->node;
     kmp_int32 npredecessors = KMP_ATOMIC_DEC(&successor->dn.npredecessors) - 1;
 
@@ -117,11 +177,26 @@ static inline void __kmp_release_deps(kmp_int32 gtid, kmp_taskdata_t *task) {
     // being processed
     if (npredecessors == 0) {
       KMP_MB();
-      if (successor->dn.task) {
-        KA_TRACE(20, ("__kmp_release_deps: T#%d successor %p of %p scheduled "
+      if (successor->dn.task && bypass && *bypass == NULL) {
+        KA_TRACE(20, ("__kmp_release_deps: T#%d successor %p of %p handed off "
                       "for execution.\n",
                       gtid, successor->dn.task, task));
-        __kmp_omp_task(gtid, successor->dn.task, false);
+        *bypass = successor->dn.task;
+      } else if (successor->dn.task) {
+        kmp_task_t *ready = successor->dn.task;
+        // hand off the successor on the longest path to a sink instead
+        kmp_depnode_t *handed_off =
+            bypass ? KMP_TASK_TO_TASKDATA(*bypass)->td_depnode : NULL;
+        if (__kmp_task_critical_path && handed_off &&
+            KMP_ATOMIC_LD_RLX(&successor->dn.bottom_level) >
+                KMP_ATOMIC_LD_RLX(&handed_off->dn.bottom_level)) {
+          ready = *bypass;
+          *bypass = successor->dn.task;
+        }
+        KA_TRACE(20, ("__kmp_release_deps: T#%d successor %p of %p scheduled "
+                      "for execution.\n",
+                      gtid, ready, task));
+        __kmp_omp_task(gtid, ready, false);
       }
     }
 
@@ -142,4 +217,26 @@ static inline void __kmp_release_deps(kmp_int32 gtid, kmp_taskdata_t *task) {
        gtid, task));
 }
 
+// __kmp_taskgraph_release: notify the successors of a task created by the
+// replay of a task graph, scheduling those whose predecessors are all done.
+// bypass is used as in __kmp_release_deps.
+static inline void __kmp_taskgraph_release(kmp_int32 gtid,
+                                           kmp_taskdata_t *task,
+                                           kmp_task_t **bypass = NULL) {
+  kmp_taskgraph_node_t *node = task->td_taskgraph_node;
+  KA_TRACE(20, ("__kmp_taskgraph_release: T#%d notifying %d successors of "
+                "task %p.\n",
+                gtid, node->tgn_nsuccessors, task));
+  for (kmp_int32 i = 0; i < node->tgn_nsuccessors; ++i) {
+    kmp_taskgraph_node_t *successor = node->tgn_successors[i];
+    // the successor task is only set once it has been created
+    if (KMP_ATOMIC_DEC(&successor->tgn_npending) != 1)
+      continue;
+    if (bypass && *bypass == NULL)
+      *bypass = successor->tgn_task;
+    else
+      __kmp_omp_task(gtid, successor->tgn_task, false);
+  }
+}
+
 #endif // KMP_TASKDEPS_H
@@ -23,6 +23,12 @@
 
 #include "tsan_annotations.h"
 
+#if KMP_HAVE_TASK_FIBERS
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
 /* forward declaration */
 static void __kmp_enable_tasking(kmp_task_team_t *task_team,
                                  kmp_info_t *this_thr);
@@ -31,6 +37,15 @@ static void __kmp_alloc_task_deque(kmp_info_t *thread,
 static int __kmp_realloc_task_threads_data(kmp_info_t *thread,
                                            kmp_task_team_t *task_team);
 static void __kmp_bottom_half_finish_proxy(kmp_int32 gtid, kmp_task_t *ptask);
+static kmp_int32
+__kmp_drain_completed_tasks(kmp_int32 gtid, kmp_task_team_t *task_team,
+                            std::atomic<kmp_int32> *unfinished_threads,
+                            int *thread_finished);
+static bool __kmp_give_task(kmp_info_t *thread, kmp_int32 tid, kmp_task_t *task,
+                            kmp_int32 pass);
+#if KMP_HAVE_TASK_FIBERS
+static void __kmp_task_fiber_wake(struct kmp_task_fiber *fiber);
+#endif
 
 #ifdef BUILD_TIED_TASK_STACK
 
@@ -247,9 +262,73 @@ static void __kmp_pop_task_stack(kmp_int32 gtid, kmp_info_t *thread,
 }
 #endif /* BUILD_TIED_TASK_STACK */
 
+// mutexinoutset dependences.
+// A task acquires all of its mutexinoutset dependences, in sorted order, when
+// it is about to start, so that queued tasks do not hold them. If one of them
+// is owned, the task is parked on it and queued again once the owner
+// completes, instead of being put back in a deque where threads would find it
+// again and again. A task executed right away instead of being queued, when
+// the deque is full or when it is handed off, must get its dependences first
+// and is queued otherwise.
+
+// __kmp_mtx_deps_release: release the first n mutexinoutset dependences of
+// node, queuing again the first task parked on each of them
+static void __kmp_mtx_deps_release(kmp_int32 gtid, kmp_depnode_t *node,
+                                   kmp_int32 n) {
+  for (kmp_int32 i = n - 1; i >= 0; --i) {
+    kmp_mtx_dep_t *mtx = node->dn.mtx_locks[i];
+    KMP_DEBUG_ASSERT(mtx != NULL);
+    __kmp_acquire_bootstrap_lock(&mtx->md_lock);
+    kmp_taskdata_t *parked = mtx->md_head;
+    if (parked != NULL) {
+      mtx->md_head = parked->td_mtx_next;
+      if (mtx->md_head == NULL)
+        mtx->md_tail = NULL;
+    }
+    mtx->md_owned = false;
+    __kmp_release_bootstrap_lock(&mtx->md_lock);
+    if (parked != NULL) {
+      KA_TRACE(20, ("__kmp_mtx_deps_release: T#%d queuing parked task %p\n",
+                    gtid, parked));
+      __kmp_omp_task(gtid, KMP_TASKDATA_TO_TASK(parked), false);
+    }
+  }
+}
+
+// __kmp_mtx_deps_acquire: acquire all mutexinoutset dependences of node.
+// Returns false if one of them is owned by another task; if park is not NULL,
+// that task is then parked on it.
+static bool __kmp_mtx_deps_acquire(kmp_int32 gtid, kmp_depnode_t *node,
+                                   kmp_taskdata_t *park) {
+  for (kmp_int32 i = 0; i < node->dn.mtx_num_locks; ++i) {
+    kmp_mtx_dep_t *mtx = node->dn.mtx_locks[i];
+    KMP_DEBUG_ASSERT(mtx != NULL);
+    __kmp_acquire_bootstrap_lock(&mtx->md_lock);
+    if (!mtx->md_owned) {
+      mtx->md_owned = true;
+      __kmp_release_bootstrap_lock(&mtx->md_lock);
+      continue;
+    }
+    if (park != NULL) {
+      park->td_mtx_next = NULL;
+      if (mtx->md_tail != NULL)
+        mtx->md_tail->td_mtx_next = park;
+      else
+        mtx->md_head = park;
+      mtx->md_tail = park;
+    }
+    __kmp_release_bootstrap_lock(&mtx->md_lock);
+    // could not get the dependence, release previous ones
+    __kmp_mtx_deps_release(gtid, node, i);
+    return false;
+  }
+  // negative num_locks means all locks acquired successfully
+  node->dn.mtx_num_locks = -node->dn.mtx_num_locks;
+  return true;
+}
+
 // returns 1 if new task is allowed to execute, 0 otherwise
-// checks Task Scheduling constraint (if requested) and
-// mutexinoutset dependencies if any
+// checks Task Scheduling constraint (if requested)
 static bool __kmp_task_is_allowed(int gtid, const kmp_int32 is_constrained,
                                   const kmp_taskdata_t *tasknew,
                                   const kmp_taskdata_t *taskcurr) {
@@ -273,24 +352,42 @@ static bool __kmp_task_is_allowed(int gtid, const kmp_int32 is_constrained,
         return false;
     }
   }
-  // Check mutexinoutset dependencies, acquire locks
+  return true;
+}
+
+// __kmp_task_can_start: whether a task not queued may be executed right away:
+// it must obey the Task Scheduling constraint (if requested) and get its
+// mutexinoutset dependences, if any, without being parked
+static bool __kmp_task_can_start(int gtid, const kmp_int32 is_constrained,
+                                 const kmp_taskdata_t *tasknew,
+                                 const kmp_taskdata_t *taskcurr) {
+  if (!__kmp_task_is_allowed(gtid, is_constrained, tasknew, taskcurr))
+    return false;
   kmp_depnode_t *node = tasknew->td_depnode;
-  if (node && (node->dn.mtx_num_locks > 0)) {
-    for (int i = 0; i < node->dn.mtx_num_locks; ++i) {
-      KMP_DEBUG_ASSERT(node->dn.mtx_locks[i] != NULL);
-      if (__kmp_test_lock(node->dn.mtx_locks[i], gtid))
-        continue;
-      // could not get the lock, release previous locks
-      for (int j = i - 1; j >= 0; --j)
-        __kmp_release_lock(node->dn.mtx_locks[j], gtid);
-      return false;
-    }
-    // negative num_locks means all locks acquired successfully
-    node->dn.mtx_num_locks = -node->dn.mtx_num_locks;
-  }
+  if (node && (node->dn.mtx_num_locks > 0))
+    return __kmp_mtx_deps_acquire(gtid, node, NULL);
   return true;
 }
 
+// Task deques and the per-thread data of task teams are used mostly by their
+// owner, and by thieves on the same node when there is a per-node index. With
+// KMP_TASK_NUMA_LOCAL they are allocated on whole pages placed on the owner's
+// NUMA node, so they share neither pages nor cache lines with the data of
+// threads running on other nodes.
+#define KMP_TASK_NUMA_PAGE (8 * 1024) // Alignment of __kmp_page_allocate
+
+// __kmp_alloc_task_local: allocate zeroed memory for data used mostly by a
+// thread running on the given node (-1 if unknown)
+static void *__kmp_alloc_task_local(size_t size, kmp_int32 node) {
+  if (!__kmp_task_numa_local)
+    return __kmp_allocate(size);
+  size = (size + KMP_TASK_NUMA_PAGE - 1) & ~(size_t)(KMP_TASK_NUMA_PAGE - 1);
+  void *ptr = __kmp_page_allocate(size);
+  if (node >= 0)
+    __kmp_bind_numa_node(ptr, size, node);
+  return ptr;
+}
+
 // __kmp_realloc_task_deque:
 // Re-allocates a task deque for a particular thread, copies the content from
 // the old deque and adjusts the necessary data structures relating to the
@@ -304,8 +401,8 @@ static void __kmp_realloc_task_deque(kmp_info_t *thread,
                 "%d] for thread_data %p\n",
                 __kmp_gtid_from_thread(thread), size, new_size, thread_data));
 
-  kmp_taskdata_t **new_deque =
-      (kmp_taskdata_t **)__kmp_allocate(new_size * sizeof(kmp_taskdata_t *));
+  kmp_taskdata_t **new_deque = (kmp_taskdata_t **)__kmp_alloc_task_local(
+      new_size * sizeof(kmp_taskdata_t *), thread_data->td.td_numa_node);
 
   int i, j;
   for (i = thread_data->td.td_deque_head, j = 0; j < size;
@@ -320,6 +417,527 @@ static void __kmp_realloc_task_deque(kmp_info_t *thread,
   thread_data->td.td_deque_size = new_size;
 }
 
+// Adaptive deques (KMP_TASK_DEQUE_ADAPTIVE).
+// Throttling a producer whenever its deque holds INITIAL_TASK_DEQUE_SIZE tasks
+// makes it execute tasks itself while thieves may be starving, and growing the
+// deque instead copies it under the lock and keeps it at its largest size for
+// good. The throttling limit of each deque follows the steals instead: it
+// doubles, up to TASK_DEQUE_MAX_LIMIT, once thieves took half a limit's worth
+// of tasks since it was last adjusted, and halves at a barrier if the deque
+// stayed below half of it. Tasks which must be queued beyond the limit, when
+// throttling is off or the owner may not execute them, are pushed in O(1) on a
+// spill stack. The owner pops it first; thieves move the most recent half of
+// it to the deque once the deque is empty. The deque itself is shrunk back to
+// its limit at barriers.
+
+// __kmp_task_deque_full: whether the deque reached its throttling limit
+static inline bool __kmp_task_deque_full(kmp_thread_data_t *thread_data) {
+  return TCR_4(thread_data->td.td_deque_ntasks) >=
+         (__kmp_task_deque_adaptive ? thread_data->td.td_deque_limit
+                                    : TASK_DEQUE_SIZE(thread_data->td));
+}
+
+// __kmp_task_deque_drained: whether thieves took enough tasks from the deque
+// since its limit was adjusted for the limit to be raised
+static inline bool __kmp_task_deque_drained(kmp_thread_data_t *thread_data) {
+  kmp_int32 limit = thread_data->td.td_deque_limit;
+  return __kmp_task_deque_adaptive && limit < TASK_DEQUE_MAX_LIMIT &&
+         2 * thread_data->td.td_deque_steals >= limit;
+}
+
+// __kmp_raise_task_deque_limit: double the limit of a drained deque. Returns
+// true if the limit was raised. Must be called with the deque lock held.
+static bool __kmp_raise_task_deque_limit(kmp_thread_data_t *thread_data) {
+  if (!__kmp_task_deque_drained(thread_data))
+    return false;
+  thread_data->td.td_deque_limit *= 2;
+  thread_data->td.td_deque_steals = 0;
+  return true;
+}
+
+// __kmp_queue_task: add a task at the tail of a deque, growing the deque up to
+// its limit and spilling the task beyond. Must be called with the deque lock
+// held.
+static void __kmp_queue_task(kmp_info_t *thread, kmp_thread_data_t *thread_data,
+                             kmp_taskdata_t *taskdata) {
+  kmp_int32 ntasks = TCR_4(thread_data->td.td_deque_ntasks);
+  // Once a task is spilled, the following ones are spilled as well, so that
+  // the most recent tasks are always on top of the stack
+  if (__kmp_task_deque_adaptive &&
+      (thread_data->td.td_spill != NULL ||
+       (ntasks >= TASK_DEQUE_SIZE(thread_data->td) &&
+        TASK_DEQUE_SIZE(thread_data->td) >= thread_data->td.td_deque_limit))) {
+    KMP_COUNT_BLOCK(TASK_deque_spilled);
+    taskdata->td_spill_next = thread_data->td.td_spill;
+    thread_data->td.td_spill = taskdata;
+    TCW_4(thread_data->td.td_spill_ntasks,
+          TCR_4(thread_data->td.td_spill_ntasks) + 1);
+  } else {
+    if (ntasks >= TASK_DEQUE_SIZE(thread_data->td))
+      __kmp_realloc_task_deque(thread, thread_data);
+    thread_data->td.td_deque[thread_data->td.td_deque_tail] = taskdata;
+    thread_data->td.td_deque_tail =
+        (thread_data->td.td_deque_tail + 1) & TASK_DEQUE_MASK(thread_data->td);
+    TCW_4(thread_data->td.td_deque_ntasks, ntasks + 1);
+  }
+  ntasks = TCR_4(thread_data->td.td_deque_ntasks) +
+           TCR_4(thread_data->td.td_spill_ntasks);
+  if (ntasks > thread_data->td.td_deque_high_water)
+    thread_data->td.td_deque_high_water = ntasks;
+}
+
+// __kmp_pop_spilled_task: remove the most recent task of the spill stack.
+// Must be called with the deque lock held.
+static kmp_taskdata_t *__kmp_pop_spilled_task(kmp_thread_data_t *thread_data) {
+  kmp_taskdata_t *taskdata = thread_data->td.td_spill;
+  thread_data->td.td_spill = taskdata->td_spill_next;
+  TCW_4(thread_data->td.td_spill_ntasks,
+        TCR_4(thread_data->td.td_spill_ntasks) - 1);
+  return taskdata;
+}
+
+// __kmp_refill_task_deque: move the most recent half of the spill stack,
+// bounded by the deque size, to the empty deque of a victim, keeping the
+// oldest of them at the head. Returns the number of tasks moved. Must be
+// called with the deque lock held.
+static kmp_int32 __kmp_refill_task_deque(kmp_thread_data_t *thread_data) {
+  KMP_DEBUG_ASSERT(TCR_4(thread_data->td.td_deque_ntasks) == 0);
+  kmp_int32 ntasks = KMP_MIN((TCR_4(thread_data->td.td_spill_ntasks) + 1) / 2,
+                             TASK_DEQUE_SIZE(thread_data->td));
+  for (kmp_int32 i = 0; i < ntasks; ++i) {
+    thread_data->td.td_deque_head =
+        (thread_data->td.td_deque_head - 1) & TASK_DEQUE_MASK(thread_data->td);
+    thread_data->td.td_deque[thread_data->td.td_deque_head] =
+        __kmp_pop_spilled_task(thread_data);
+  }
+  TCW_4(thread_data->td.td_deque_ntasks, ntasks);
+  return ntasks;
+}
+
+// __kmp_shrink_task_deques: decay the limit of the deques which stayed below
+// half of it since the last barrier, and shrink the deques grown beyond their
+// limit. Called by the master at the end of a barrier, once all the tasks of
+// the task team completed.
+static void __kmp_shrink_task_deques(kmp_task_team_t *task_team) {
+  kmp_thread_data_t *threads_data = task_team->tt.tt_threads_data;
+  for (kmp_int32 i = 0; i < task_team->tt.tt_nproc; ++i) {
+    kmp_thread_data_t *thread_data = &threads_data[i];
+    if (TCR_PTR(thread_data->td.td_deque) == NULL ||
+        thread_data->td.td_deque_high_water == 0)
+      continue;
+    __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+    KMP_COUNT_VALUE(TASK_deque_high_water,
+                    thread_data->td.td_deque_high_water);
+    kmp_int32 limit = thread_data->td.td_deque_limit;
+    if (limit > INITIAL_TASK_DEQUE_SIZE &&
+        2 * thread_data->td.td_deque_high_water < limit)
+      thread_data->td.td_deque_limit = limit = limit / 2;
+    thread_data->td.td_deque_high_water = 0;
+    thread_data->td.td_deque_steals = 0;
+    if (TASK_DEQUE_SIZE(thread_data->td) > limit &&
+        TCR_4(thread_data->td.td_deque_ntasks) == 0) {
+      KE_TRACE(10, ("__kmp_shrink_task_deques: shrinking deque[from %d to %d] "
+                    "for thread_data %p\n",
+                    TASK_DEQUE_SIZE(thread_data->td), limit, thread_data));
+      __kmp_free(thread_data->td.td_deque);
+      thread_data->td.td_deque = (kmp_taskdata_t **)__kmp_alloc_task_local(
+          limit * sizeof(kmp_taskdata_t *), thread_data->td.td_numa_node);
+      thread_data->td.td_deque_size = limit;
+      thread_data->td.td_deque_head = 0;
+      thread_data->td.td_deque_tail = 0;
+    }
+    __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+  }
+}
+
+// Lock-free task deque (KMP_TASK_DEQUE_LOCKFREE=1).
+// A thread's own tasks are kept in a Chase-Lev deque following the C11
+// formulation of Le et al., "Correct and Efficient Work-Stealing for Weak
+// Memory Models" (PPoPP 2013). The owner pushes and takes at the bottom without
+// locking, thieves take from the top with a single CAS. td_deque and its lock
+// stay in use for tasks put on the deque by other threads: proxy tasks given
+// by __kmp_give_task and stolen tasks the thief could not execute because of
+// the task scheduling constraint.
+
+// __kmp_alloc_task_ring: allocate a zeroed ring of size entries (power of two)
+// for a thread running on the given node
+static kmp_task_ring_t *__kmp_alloc_task_ring(kmp_int64 size, kmp_int32 node) {
+  kmp_task_ring_t *ring = (kmp_task_ring_t *)__kmp_alloc_task_local(
+      sizeof(kmp_task_ring_t) +
+          (size - 1) * sizeof(std::atomic<kmp_taskdata_t *>),
+      node);
+  ring->tr_mask = size - 1;
+  return ring;
+}
+
+// __kmp_ring_ntasks: number of tasks in the lock-free deque. Only the owner
+// gets an exact answer, other threads use it as a hint.
+static inline kmp_int32 __kmp_ring_ntasks(kmp_thread_data_t *thread_data) {
+  kmp_int64 bottom = KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring_bottom);
+  kmp_int64 top = KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring_top);
+  return bottom > top ? (kmp_int32)(bottom - top) : 0;
+}
+
+// __kmp_thread_data_ntasks: number of tasks queued for a thread, counting the
+// spilled ones and both deques in lock-free mode
+static inline kmp_int32
+__kmp_thread_data_ntasks(kmp_thread_data_t *thread_data) {
+  kmp_int32 ntasks = TCR_4(thread_data->td.td_deque_ntasks) +
+                     TCR_4(thread_data->td.td_spill_ntasks);
+  if (__kmp_task_deque_lockfree)
+    ntasks += __kmp_ring_ntasks(thread_data);
+  return ntasks;
+}
+
+// __kmp_grow_task_ring: replace the owner's ring with one twice as large,
+// copying the live range [top, bottom). The old ring stays allocated (chained
+// through tr_prev) since thieves may still read from it.
+static kmp_task_ring_t *__kmp_grow_task_ring(kmp_info_t *thread,
+                                             kmp_thread_data_t *thread_data,
+                                             kmp_task_ring_t *ring,
+                                             kmp_int64 top, kmp_int64 bottom) {
+  kmp_int64 size = ring->tr_mask + 1;
+  KE_TRACE(10, ("__kmp_grow_task_ring: T#%d reallocating ring[from %lld to "
+                "%lld] for thread_data %p\n",
+                __kmp_gtid_from_thread(thread), size, 2 * size, thread_data));
+
+  kmp_task_ring_t *new_ring =
+      __kmp_alloc_task_ring(2 * size, thread_data->td.td_numa_node);
+  for (kmp_int64 i = top; i < bottom; ++i)
+    KMP_ATOMIC_ST_RLX(&new_ring->tr_tasks[i & new_ring->tr_mask],
+                      KMP_ATOMIC_LD_RLX(&ring->tr_tasks[i & ring->tr_mask]));
+  new_ring->tr_prev = ring;
+  KMP_ATOMIC_ST_REL(&thread_data->td.td_ring, new_ring);
+  return new_ring;
+}
+
+// __kmp_ring_push: add a task at the bottom of the lock-free deque (owner only)
+static void __kmp_ring_push(kmp_info_t *thread, kmp_thread_data_t *thread_data,
+                            kmp_taskdata_t *taskdata) {
+  kmp_int64 bottom = KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring_bottom);
+  kmp_int64 top = KMP_ATOMIC_LD_ACQ(&thread_data->td.td_ring_top);
+  kmp_task_ring_t *ring = KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring);
+
+  if (bottom - top > ring->tr_mask)
+    ring = __kmp_grow_task_ring(thread, thread_data, ring, top, bottom);
+  KMP_ATOMIC_ST_RLX(&ring->tr_tasks[bottom & ring->tr_mask], taskdata);
+  std::atomic_thread_fence(std::memory_order_release);
+  KMP_ATOMIC_ST_RLX(&thread_data->td.td_ring_bottom, bottom + 1);
+}
+
+// __kmp_ring_take: remove the task at the bottom of the lock-free deque (owner
+// only). Returns NULL if the deque is empty or a thief got the last task.
+static kmp_taskdata_t *__kmp_ring_take(kmp_thread_data_t *thread_data) {
+  kmp_int64 bottom = KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring_bottom) - 1;
+  kmp_task_ring_t *ring = KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring);
+  KMP_ATOMIC_ST_RLX(&thread_data->td.td_ring_bottom, bottom);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  kmp_int64 top = KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring_top);
+
+  kmp_taskdata_t *taskdata = NULL;
+  if (top <= bottom) {
+    taskdata = KMP_ATOMIC_LD_RLX(&ring->tr_tasks[bottom & ring->tr_mask]);
+    if (top == bottom) {
+      // Single task left: race with the thieves for it
+      if (!thread_data->td.td_ring_top.compare_exchange_strong(
+              top, top + 1, std::memory_order_seq_cst,
+              std::memory_order_relaxed))
+        taskdata = NULL;
+      KMP_ATOMIC_ST_RLX(&thread_data->td.td_ring_bottom, bottom + 1);
+    }
+  } else {
+    KMP_ATOMIC_ST_RLX(&thread_data->td.td_ring_bottom, bottom + 1);
+  }
+  return taskdata;
+}
+
+// __kmp_ring_steal: remove the task at the top of a victim's lock-free deque.
+// Returns NULL if the deque is empty or another thread won the race.
+static kmp_taskdata_t *__kmp_ring_steal(kmp_thread_data_t *victim_td) {
+  kmp_int64 top = KMP_ATOMIC_LD_ACQ(&victim_td->td.td_ring_top);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  kmp_int64 bottom = KMP_ATOMIC_LD_ACQ(&victim_td->td.td_ring_bottom);
+  if (top >= bottom)
+    return NULL;
+
+  kmp_task_ring_t *ring = KMP_ATOMIC_LD_ACQ(&victim_td->td.td_ring);
+  kmp_taskdata_t *taskdata =
+      KMP_ATOMIC_LD_RLX(&ring->tr_tasks[top & ring->tr_mask]);
+  if (!victim_td->td.td_ring_top.compare_exchange_strong(
+          top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    return NULL;
+  return taskdata;
+}
+
+// __kmp_requeue_stolen_task: put a task taken from a victim's lock-free deque
+// back on the victim's locked deque, e.g. when the task scheduling constraint
+// does not allow the thief to execute it.
+static void __kmp_requeue_stolen_task(kmp_info_t *victim_thr,
+                                      kmp_thread_data_t *victim_td,
+                                      kmp_taskdata_t *taskdata) {
+  __kmp_acquire_bootstrap_lock(&victim_td->td.td_deque_lock);
+  __kmp_queue_task(victim_thr, victim_td, taskdata);
+  __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
+}
+
+// Idle threads.
+// With KMP_TASK_WAKEUP_CAP set, threads sleeping at the barrier when the first
+// task of the task team is queued are not all resumed at once: a burst of
+// tasks would wake up threads which mostly find nothing to steal. They are kept
+// on a stack in the task team instead and are resumed only while there are
+// more queued tasks than threads resumed for them, at most
+// __kmp_task_wakeup_cap at a time. A resumed thread
+// does not sleep again before the end of the barrier, and the master resumes
+// the remaining ones before it waits for the tasks to complete, so that every
+// thread still checks out of the task team.
+
+// __kmp_task_team_pending: number of tasks queued in the task team
+static kmp_int32 __kmp_task_team_pending(kmp_task_team_t *task_team) {
+  kmp_thread_data_t *threads_data = task_team->tt.tt_threads_data;
+  kmp_int32 pending = KMP_ATOMIC_LD_RLX(&task_team->tt.tt_num_task_pri);
+  for (kmp_int32 i = 0; i < task_team->tt.tt_nproc; ++i)
+    pending += __kmp_thread_data_ntasks(&threads_data[i]);
+  return pending;
+}
+
+// __kmp_push_idle_thread: put thread tid on the idle stack unless it is already
+// there. Called with tt_idle_lock held.
+static void __kmp_push_idle_thread(kmp_task_team_t *task_team, kmp_int32 tid) {
+  kmp_thread_data_t *thread_data = &task_team->tt.tt_threads_data[tid];
+  if (thread_data->td.td_idle_next != KMP_TASK_NOT_IDLE)
+    return;
+  thread_data->td.td_idle_next = task_team->tt.tt_idle_top;
+  task_team->tt.tt_idle_top = tid;
+  KMP_ATOMIC_INC(&task_team->tt.tt_num_idle);
+}
+
+// __kmp_pop_idle_thread: take the thread on top of the idle stack, NULL if the
+// stack is empty. Called with tt_idle_lock held.
+static kmp_info_t *__kmp_pop_idle_thread(kmp_task_team_t *task_team) {
+  kmp_int32 tid = task_team->tt.tt_idle_top;
+  if (tid < 0)
+    return NULL;
+  kmp_thread_data_t *thread_data = &task_team->tt.tt_threads_data[tid];
+  task_team->tt.tt_idle_top = thread_data->td.td_idle_next;
+  thread_data->td.td_idle_next = KMP_TASK_NOT_IDLE;
+  KMP_ATOMIC_DEC(&task_team->tt.tt_num_idle);
+  return thread_data->td.td_thr;
+}
+
+// __kmp_resume_idle_thread: resume a thread if it is still sleeping
+static void __kmp_resume_idle_thread(kmp_info_t *thread) {
+  volatile void *sleep_loc;
+  if ((sleep_loc = TCR_PTR(CCAST(void *, thread->th.th_sleep_loc))) != NULL) {
+    KMP_COUNT_BLOCK(TASK_wakeups);
+    __kmp_null_resume_wrapper(__kmp_gtid_from_thread(thread), sleep_loc);
+  }
+}
+
+// __kmp_wake_idle_threads: resume threads of the idle stack while there are
+// more queued tasks than threads resumed since tasking was enabled
+static void __kmp_wake_idle_threads(kmp_task_team_t *task_team) {
+  kmp_int32 pending = __kmp_task_team_pending(task_team);
+  for (int i = 0; i < __kmp_task_wakeup_cap; ++i) {
+    kmp_info_t *thread = NULL;
+    __kmp_acquire_bootstrap_lock(&task_team->tt.tt_idle_lock);
+    if (task_team->tt.tt_num_woken < pending &&
+        (thread = __kmp_pop_idle_thread(task_team)) != NULL)
+      task_team->tt.tt_num_woken++;
+    __kmp_release_bootstrap_lock(&task_team->tt.tt_idle_lock);
+    if (thread == NULL)
+      break;
+    KF_TRACE(50, ("__kmp_wake_idle_threads: waking up thread T#%d for %d "
+                  "queued tasks\n",
+                  __kmp_gtid_from_thread(thread), pending));
+    __kmp_resume_idle_thread(thread);
+  }
+}
+
+// __kmp_task_wakeup: called after queuing a task, resume idle threads if the
+// queued tasks call for it
+static inline void __kmp_task_wakeup(kmp_task_team_t *task_team) {
+  if (KMP_ATOMIC_LD_RLX(&task_team->tt.tt_num_idle) != 0)
+    __kmp_wake_idle_threads(task_team);
+}
+
+// __kmp_found_idle_thread: a thief found a sleeping thread, which was not
+// asleep yet when tasking was enabled. Keep it on the idle stack, or resume it
+// once the master waits for the tasks.
+static void __kmp_found_idle_thread(kmp_task_team_t *task_team,
+                                    kmp_info_t *thread) {
+  kmp_int32 tid = thread->th.th_info.ds.ds_tid;
+  int wake_all;
+  if (TCR_4(task_team->tt.tt_threads_data[tid].td.td_idle_next) !=
+      KMP_TASK_NOT_IDLE)
+    return; // already on the stack
+  __kmp_acquire_bootstrap_lock(&task_team->tt.tt_idle_lock);
+  wake_all = task_team->tt.tt_wake_all;
+  if (!wake_all)
+    __kmp_push_idle_thread(task_team, tid);
+  __kmp_release_bootstrap_lock(&task_team->tt.tt_idle_lock);
+  if (wake_all)
+    __kmp_resume_idle_thread(thread);
+  else
+    __kmp_task_wakeup(task_team);
+}
+
+// __kmp_wake_all_idle_threads: resume every thread of the idle stack, as well
+// as the sleeping threads found by thieves from now on
+static void __kmp_wake_all_idle_threads(kmp_task_team_t *task_team) {
+  __kmp_acquire_bootstrap_lock(&task_team->tt.tt_idle_lock);
+  task_team->tt.tt_wake_all = TRUE;
+  __kmp_release_bootstrap_lock(&task_team->tt.tt_idle_lock);
+  while (KMP_ATOMIC_LD_RLX(&task_team->tt.tt_num_idle) != 0) {
+    __kmp_acquire_bootstrap_lock(&task_team->tt.tt_idle_lock);
+    kmp_info_t *thread = __kmp_pop_idle_thread(task_team);
+    __kmp_release_bootstrap_lock(&task_team->tt.tt_idle_lock);
+    if (thread != NULL)
+      __kmp_resume_idle_thread(thread);
+  }
+}
+
+// Task priorities.
+// Tasks with a positive priority are not queued on the encountering thread's
+// deque but on a per-priority queue of the task team. The queues are linked in
+// decreasing priority order and are checked by every thread before its own
+// deque, so the highest priority task ready anywhere in the team runs first.
+// Queues are only inserted (under tt_task_pri_lock), never unlinked before the
+// task team is reaped, so they can be walked without a lock.
+
+// __kmp_alloc_task_pri_list: allocate a priority queue and its deque
+static kmp_task_pri_t *__kmp_alloc_task_pri_list(kmp_int32 pri) {
+  kmp_task_pri_t *list =
+      (kmp_task_pri_t *)__kmp_allocate(sizeof(kmp_task_pri_t));
+  kmp_thread_data_t *thread_data = &list->td;
+  __kmp_init_bootstrap_lock(&thread_data->td.td_deque_lock);
+  thread_data->td.td_deque_last_stolen = -1;
+  thread_data->td.td_numa_node = -1; // shared by all the threads
+  thread_data->td.td_deque = (kmp_taskdata_t **)__kmp_allocate(
+      INITIAL_TASK_DEQUE_SIZE * sizeof(kmp_taskdata_t *));
+  thread_data->td.td_deque_size = INITIAL_TASK_DEQUE_SIZE;
+  list->priority = pri;
+  return list;
+}
+
+// __kmp_get_task_pri_queue: find the queue for priority pri, inserting it into
+// the sorted list if it does not exist yet
+static kmp_thread_data_t *__kmp_get_task_pri_queue(kmp_task_team_t *task_team,
+                                                   kmp_int32 pri) {
+  kmp_task_pri_t *list =
+      (kmp_task_pri_t *)TCR_PTR(task_team->tt.tt_task_pri_list);
+  while (list != NULL && list->priority > pri)
+    list = (kmp_task_pri_t *)TCR_PTR(list->next);
+  if (list != NULL && list->priority == pri)
+    return &list->td;
+
+  __kmp_acquire_bootstrap_lock(&task_team->tt.tt_task_pri_lock);
+  kmp_task_pri_t **prev = &task_team->tt.tt_task_pri_list;
+  while (*prev != NULL && (*prev)->priority > pri)
+    prev = &(*prev)->next;
+  if (*prev == NULL || (*prev)->priority != pri) {
+    list = __kmp_alloc_task_pri_list(pri);
+    list->next = *prev;
+    KMP_MB(); // Initialize the queue before it can be seen by other threads
+    TCW_PTR(*prev, list);
+  } else {
+    list = *prev;
+  }
+  __kmp_release_bootstrap_lock(&task_team->tt.tt_task_pri_lock);
+  return &list->td;
+}
+
+// __kmp_push_priority_task: add a task to the team's queue of priority pri
+static kmp_int32 __kmp_push_priority_task(kmp_int32 gtid, kmp_info_t *thread,
+                                          kmp_taskdata_t *taskdata,
+                                          kmp_task_team_t *task_team,
+                                          kmp_int32 pri) {
+  kmp_thread_data_t *thread_data = __kmp_get_task_pri_queue(task_team, pri);
+
+  __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+  if (TCR_4(thread_data->td.td_deque_ntasks) >=
+      TASK_DEQUE_SIZE(thread_data->td)) {
+    if (__kmp_enable_task_throttling &&
+        __kmp_task_can_start(gtid, __kmp_task_stealing_constraint, taskdata,
+                             thread->th.th_current_task)) {
+      __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+      KA_TRACE(20, ("__kmp_push_priority_task: T#%d deque is full; returning "
+                    "TASK_NOT_PUSHED for task %p\n",
+                    gtid, taskdata));
+      return TASK_NOT_PUSHED;
+    }
+    // expand deque to push the task which is not allowed to execute
+    __kmp_realloc_task_deque(thread, thread_data);
+  }
+  KMP_DEBUG_ASSERT(TCR_4(thread_data->td.td_deque_ntasks) <
+                   TASK_DEQUE_SIZE(thread_data->td));
+  thread_data->td.td_deque[thread_data->td.td_deque_tail] = taskdata;
+  thread_data->td.td_deque_tail =
+      (thread_data->td.td_deque_tail + 1) & TASK_DEQUE_MASK(thread_data->td);
+  TCW_4(thread_data->td.td_deque_ntasks,
+        TCR_4(thread_data->td.td_deque_ntasks) + 1);
+  KMP_ATOMIC_INC(&task_team->tt.tt_num_task_pri);
+  __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+  __kmp_task_wakeup(task_team);
+
+  KA_TRACE(20, ("__kmp_push_priority_task: T#%d returning "
+                "TASK_SUCCESSFULLY_PUSHED: task=%p priority=%d\n",
+                gtid, taskdata, pri));
+  return TASK_SUCCESSFULLY_PUSHED;
+}
+
+// __kmp_task_queue_priority: the priority queue a task goes to, 0 for none.
+// With KMP_TASK_CRITICAL_PATH, the ready tasks of dependence graphs with the
+// same priority are ordered by the estimated length of their longest path to a
+// sink, so tasks which release the most work run first.
+static inline kmp_int32 __kmp_task_queue_priority(kmp_taskdata_t *taskdata,
+                                                  kmp_task_t *task) {
+  kmp_int32 pri = 0;
+  if (taskdata->td_flags.priority_specified && task->data2.priority > 0 &&
+      __kmp_max_task_priority > 0)
+    pri = KMP_MIN(task->data2.priority, __kmp_max_task_priority);
+  if (__kmp_task_critical_path > 0 && taskdata->td_depnode != NULL)
+    pri = pri * (__kmp_task_critical_path + 1) +
+          KMP_ATOMIC_LD_RLX(&taskdata->td_depnode->dn.bottom_level);
+  return pri;
+}
+
+// __kmp_push_task_to_node: give a task whose affinity data lives on another
+// NUMA node to a thread of the team running on that node. Returns false if no
+// such thread has room for it.
+static bool __kmp_push_task_to_node(kmp_info_t *thread,
+                                    kmp_task_team_t *task_team,
+                                    kmp_task_t *task, kmp_int32 node) {
+  kmp_thread_data_t *threads_data = task_team->tt.tt_threads_data;
+  kmp_int32 nthreads = task_team->tt.tt_nproc;
+  kmp_int32 *tids = NULL;
+
+  // Only visit the threads of the node when the per-node index is built
+  if (KMP_ATOMIC_LD_ACQ(&task_team->tt.tt_num_nodes) > 0) {
+    if (node >= KMP_TASK_MAX_NUMA_NODES)
+      return false;
+    tids = &task_team->tt.tt_node_tids[task_team->tt.tt_node_start[node]];
+    nthreads = task_team->tt.tt_node_start[node + 1] -
+               task_team->tt.tt_node_start[node];
+    if (nthreads == 0)
+      return false;
+  }
+  kmp_int32 start = __kmp_get_random(thread) % nthreads;
+
+  for (kmp_int32 i = 0; i < nthreads; ++i) {
+    kmp_int32 tid = (start + i) % nthreads;
+    if (tids != NULL)
+      tid = tids[tid];
+    kmp_thread_data_t *thread_data = &threads_data[tid];
+    if (TCR_PTR(thread_data->td.td_deque) == NULL ||
+        TCR_4(thread_data->td.td_numa_node) != node)
+      continue;
+    // pass == 1: do not grow a full deque, try the next thread instead
+    if (__kmp_give_task(thread_data->td.td_thr, tid, task, 1))
+      return true;
+  }
+  return false;
+}
+
 //  __kmp_push_task: Add a task to the thread's deque
 static kmp_int32 __kmp_push_task(kmp_int32 gtid, kmp_task_t *task) {
   kmp_info_t *thread = __kmp_threads[gtid];
@@ -367,55 +985,71 @@ static kmp_int32 __kmp_push_task(kmp_int32 gtid, kmp_task_t *task) {
     __kmp_alloc_task_deque(thread, thread_data);
   }
 
-  int locked = 0;
-  // Check if deque is full
-  if (TCR_4(thread_data->td.td_deque_ntasks) >=
-      TASK_DEQUE_SIZE(thread_data->td)) {
-    if (__kmp_enable_task_throttling &&
-        __kmp_task_is_allowed(gtid, __kmp_task_stealing_constraint, taskdata,
-                              thread->th.th_current_task)) {
-      KA_TRACE(20, ("__kmp_push_task: T#%d deque is full; returning "
+  kmp_int32 pri = __kmp_task_queue_priority(taskdata, task);
+  if (pri > 0)
+    return __kmp_push_priority_task(gtid, thread, taskdata, task_team, pri);
+
+  // Tasks with an affinity clause go to a thread on the node of their data
+  if (taskdata->td_numa_node >= 0 &&
+      taskdata->td_numa_node != thread_data->td.td_numa_node &&
+      __kmp_push_task_to_node(thread, task_team, task,
+                              taskdata->td_numa_node)) {
+    KMP_COUNT_BLOCK(TASK_affinity_moved);
+    __kmp_task_wakeup(task_team);
+    KA_TRACE(20, ("__kmp_push_task: T#%d returning TASK_SUCCESSFULLY_PUSHED: "
+                  "task=%p given to a thread on node %d\n",
+                  gtid, taskdata, taskdata->td_numa_node));
+    return TASK_SUCCESSFULLY_PUSHED;
+  }
+
+  if (__kmp_task_deque_lockfree) {
+    // Same throttling policy as the locked deque: once the ring is full, let
+    // the caller execute the task immediately if it is allowed to.
+    if (__kmp_ring_ntasks(thread_data) >
+            KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring)->tr_mask &&
+        __kmp_enable_task_throttling &&
+        __kmp_task_can_start(gtid, __kmp_task_stealing_constraint, taskdata,
+                             thread->th.th_current_task)) {
+      KA_TRACE(20, ("__kmp_push_task: T#%d ring is full; returning "
                     "TASK_NOT_PUSHED for task %p\n",
                     gtid, taskdata));
       return TASK_NOT_PUSHED;
-    } else {
-      __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
-      locked = 1;
-      // expand deque to push the task which is not allowed to execute
-      __kmp_realloc_task_deque(thread, thread_data);
     }
+    __kmp_ring_push(thread, thread_data, taskdata);
+    __kmp_task_wakeup(task_team);
+    KA_TRACE(20, ("__kmp_push_task: T#%d returning TASK_SUCCESSFULLY_PUSHED: "
+                  "task=%p ring ntasks=%d\n",
+                  gtid, taskdata, __kmp_ring_ntasks(thread_data)));
+    return TASK_SUCCESSFULLY_PUSHED;
+  }
+
+  // Check if deque is full. The limit of a deque drained by thieves is raised
+  // instead of throttling its owner.
+  if (__kmp_task_deque_full(thread_data) && __kmp_enable_task_throttling &&
+      !__kmp_task_deque_drained(thread_data) &&
+      __kmp_task_can_start(gtid, __kmp_task_stealing_constraint, taskdata,
+                           thread->th.th_current_task)) {
+    KA_TRACE(20, ("__kmp_push_task: T#%d deque is full; returning "
+                  "TASK_NOT_PUSHED for task %p\n",
+                  gtid, taskdata));
+    return TASK_NOT_PUSHED;
   }
   // Lock the deque for the task push operation
-  if (!locked) {
-    __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
-    // Need to recheck as we can get a proxy task from thread outside of OpenMP
-    if (TCR_4(thread_data->td.td_deque_ntasks) >=
-        TASK_DEQUE_SIZE(thread_data->td)) {
-      if (__kmp_enable_task_throttling &&
-          __kmp_task_is_allowed(gtid, __kmp_task_stealing_constraint, taskdata,
-                                thread->th.th_current_task)) {
-        __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
-        KA_TRACE(20, ("__kmp_push_task: T#%d deque is full on 2nd check; "
-                      "returning TASK_NOT_PUSHED for task %p\n",
-                      gtid, taskdata));
-        return TASK_NOT_PUSHED;
-      } else {
-        // expand deque to push the task which is not allowed to execute
-        __kmp_realloc_task_deque(thread, thread_data);
-      }
-    }
+  __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+  // Need to recheck as we can get a proxy task from thread outside of OpenMP
+  if (__kmp_task_deque_full(thread_data) &&
+      !__kmp_raise_task_deque_limit(thread_data) &&
+      __kmp_enable_task_throttling &&
+      __kmp_task_can_start(gtid, __kmp_task_stealing_constraint, taskdata,
+                           thread->th.th_current_task)) {
+    __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+    KA_TRACE(20, ("__kmp_push_task: T#%d deque is full on 2nd check; "
+                  "returning TASK_NOT_PUSHED for task %p\n",
+                  gtid, taskdata));
+    return TASK_NOT_PUSHED;
   }
-  // Must have room since no thread can add tasks but calling thread
-  KMP_DEBUG_ASSERT(TCR_4(thread_data->td.td_deque_ntasks) <
-                   TASK_DEQUE_SIZE(thread_data->td));
-
-  thread_data->td.td_deque[thread_data->td.td_deque_tail] =
-      taskdata; // Push taskdata
-  // Wrap index.
-  thread_data->td.td_deque_tail =
-      (thread_data->td.td_deque_tail + 1) & TASK_DEQUE_MASK(thread_data->td);
-  TCW_4(thread_data->td.td_deque_ntasks,
-        TCR_4(thread_data->td.td_deque_ntasks) + 1); // Adjust task count
+  // Push taskdata, expanding the deque or spilling the task if it is full
+  __kmp_queue_task(thread, thread_data, taskdata);
 
   KA_TRACE(20, ("__kmp_push_task: T#%d returning TASK_SUCCESSFULLY_PUSHED: "
                 "task=%p ntasks=%d head=%u tail=%u\n",
@@ -423,6 +1057,7 @@ static kmp_int32 __kmp_push_task(kmp_int32 gtid, kmp_task_t *task) {
                 thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
 
   __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+  __kmp_task_wakeup(task_team);
 
   return TASK_SUCCESSFULLY_PUSHED;
 }
@@ -695,6 +1330,146 @@ void __kmpc_omp_task_begin(ident_t *loc_ref, kmp_int32 gtid, kmp_task_t *task) {
 }
 #endif // TASK_UNUSED
 
+// __kmp_task_slab_class: size class of a task descriptor of the given size, or
+// -1 if it is too large for the task slabs
+static inline int __kmp_task_slab_class(size_t size) {
+  size_t class_size = KMP_TASK_SLAB_MIN_SIZE;
+  for (int cls = 0; cls < KMP_TASK_SLAB_CLASSES; ++cls, class_size <<= 1) {
+    if (size <= class_size)
+      return cls;
+  }
+  return -1;
+}
+
+// __kmp_task_slab_allocate: get a descriptor of size class cls from the
+// thread's own slab. Recycled descriptors are not cleared, the caller
+// initializes the fields it uses.
+static void *__kmp_task_slab_allocate(kmp_info_t *thread, int cls) {
+  kmp_task_slab_t *slab = &thread->th.th_task_slabs[cls];
+  void *ptr = slab->ts_free;
+  if (ptr == NULL && KMP_ATOMIC_LD_RLX(&slab->ts_remote_free) != NULL) {
+    // Take back all the descriptors freed by other threads at once
+    ptr = slab->ts_remote_free.exchange(nullptr, std::memory_order_acquire);
+  }
+  KMP_ATOMIC_INC(&slab->ts_nlive);
+  if (ptr != NULL) {
+    slab->ts_free = *((void **)ptr);
+    return ptr;
+  }
+
+  size_t size = (size_t)KMP_TASK_SLAB_MIN_SIZE << cls;
+  if (slab->ts_end - slab->ts_bump < (ptrdiff_t)size) {
+    // Descriptors are carved from the chunk one at a time, so its pages are
+    // only touched when they are needed
+    char *chunk = (char *)KMP_INTERNAL_MALLOC(KMP_TASK_SLAB_CHUNK_SIZE);
+    if (chunk == NULL)
+      KMP_FATAL(MemoryAllocFailed);
+    *((void **)chunk) = slab->ts_chunks;
+    slab->ts_chunks = chunk;
+    slab->ts_bump = (char *)(((kmp_uintptr_t)chunk + sizeof(void *) +
+                              CACHE_LINE - 1) &
+                             ~(kmp_uintptr_t)(CACHE_LINE - 1));
+    slab->ts_end = chunk + KMP_TASK_SLAB_CHUNK_SIZE;
+  }
+  ptr = slab->ts_bump;
+  slab->ts_bump += size;
+  return ptr;
+}
+
+// __kmp_task_slab_trim: once all the descriptors of a slab are free, give its
+// chunks back to the system but the current one, which is reused from its
+// start. A burst of tasks thus does not keep its memory until the thread is
+// reaped. Owner only.
+static void __kmp_task_slab_trim(kmp_task_slab_t *slab) {
+  char *chunk = (char *)slab->ts_chunks;
+  if (chunk == NULL || *((void **)chunk) == NULL ||
+      KMP_ATOMIC_LD_ACQ(&slab->ts_nlive) != 0)
+    return;
+  void *next = *((void **)chunk);
+  while (next != NULL) {
+    void *old = next;
+    next = *((void **)old);
+    KMP_INTERNAL_FREE(old);
+  }
+  *((void **)chunk) = NULL;
+  // Other threads only push descriptors that are live, there are none
+  slab->ts_free = NULL;
+  KMP_ATOMIC_ST_RLX(&slab->ts_remote_free, nullptr);
+  slab->ts_bump = (char *)(((kmp_uintptr_t)chunk + sizeof(void *) +
+                            CACHE_LINE - 1) &
+                           ~(kmp_uintptr_t)(CACHE_LINE - 1));
+  slab->ts_end = chunk + KMP_TASK_SLAB_CHUNK_SIZE;
+}
+
+// __kmp_task_slab_free: return a descriptor to the slab of the thread that
+// allocated it
+static void __kmp_task_slab_free(kmp_info_t *thread,
+                                 kmp_taskdata_t *taskdata) {
+  kmp_info_t *owner = taskdata->td_alloc_thread;
+  int cls = __kmp_task_slab_class(taskdata->td_size_alloc);
+  KMP_DEBUG_ASSERT(cls >= 0);
+  kmp_task_slab_t *slab = &owner->th.th_task_slabs[cls];
+  void *ptr = taskdata;
+  if (owner == thread) {
+    *((void **)ptr) = slab->ts_free;
+    slab->ts_free = ptr;
+    if (KMP_ATOMIC_DEC(&slab->ts_nlive) == 1)
+      __kmp_task_slab_trim(slab);
+    return;
+  }
+  // Several threads may push concurrently, but the owner only ever takes the
+  // whole list, so there is no ABA problem
+  void *head = KMP_ATOMIC_LD_RLX(&slab->ts_remote_free);
+  do {
+    *((void **)ptr) = head;
+  } while (!slab->ts_remote_free.compare_exchange_weak(
+      head, ptr, std::memory_order_release, std::memory_order_relaxed));
+  // The owner trims the slab at its next barrier if this was the last one
+  KMP_ATOMIC_DEC(&slab->ts_nlive);
+}
+
+// __kmp_trim_task_slabs: trim the slabs of the thread whose descriptors are
+// all free, e.g. those last freed by other threads
+static void __kmp_trim_task_slabs(kmp_info_t *thread) {
+  for (int cls = 0; cls < KMP_TASK_SLAB_CLASSES; ++cls)
+    __kmp_task_slab_trim(&thread->th.th_task_slabs[cls]);
+}
+
+// __kmp_free_task_slabs: release the memory of the thread's task slabs. Only
+// done when the thread is reaped, after all of its tasks have been freed.
+void __kmp_free_task_slabs(kmp_info_t *thread) {
+  for (int cls = 0; cls < KMP_TASK_SLAB_CLASSES; ++cls) {
+    kmp_task_slab_t *slab = &thread->th.th_task_slabs[cls];
+    void *chunk = slab->ts_chunks;
+    while (chunk != NULL) {
+      void *next = *((void **)chunk);
+      KMP_INTERNAL_FREE(chunk);
+      chunk = next;
+    }
+    slab->ts_free = NULL;
+    slab->ts_bump = NULL;
+    slab->ts_end = NULL;
+    slab->ts_chunks = NULL;
+    KMP_ATOMIC_ST_RLX(&slab->ts_remote_free, nullptr);
+    KMP_ATOMIC_ST_RLX(&slab->ts_nlive, 0);
+  }
+}
+
+// __kmp_alloc_task_storage: allocate the block holding a task descriptor and
+// its private and shared data. Sets *slab if it comes from the task slabs.
+static kmp_taskdata_t *__kmp_alloc_task_storage(kmp_info_t *thread, size_t size,
+                                                bool *slab) {
+  int cls = __kmp_task_slab_alloc ? __kmp_task_slab_class(size) : -1;
+  *slab = (cls >= 0);
+  if (cls >= 0)
+    return (kmp_taskdata_t *)__kmp_task_slab_allocate(thread, cls);
+#if USE_FAST_MEMORY
+  return (kmp_taskdata_t *)__kmp_fast_allocate(thread, size);
+#else /* ! USE_FAST_MEMORY */
+  return (kmp_taskdata_t *)__kmp_thread_malloc(thread, size);
+#endif /* USE_FAST_MEMORY */
+}
+
 // __kmp_free_task: free the current task space and the space for shareds
 //
 // gtid: Global thread ID of calling thread
@@ -717,11 +1492,15 @@ static void __kmp_free_task(kmp_int32 gtid, kmp_taskdata_t *taskdata,
   taskdata->td_flags.freed = 1;
   ANNOTATE_HAPPENS_BEFORE(taskdata);
 // deallocate the taskdata and shared variable blocks associated with this task
+  if (taskdata->td_flags.slab) {
+    __kmp_task_slab_free(thread, taskdata);
+  } else {
 #if USE_FAST_MEMORY
-  __kmp_fast_free(thread, taskdata);
+    __kmp_fast_free(thread, taskdata);
 #else /* ! USE_FAST_MEMORY */
-  __kmp_thread_free(thread, taskdata);
+    __kmp_thread_free(thread, taskdata);
 #endif
+  }
 
   KA_TRACE(20, ("__kmp_free_task: T#%d freed task %p\n", gtid, taskdata));
 }
@@ -799,9 +1578,12 @@ static void __kmp_free_task_and_ancestors(kmp_int32 gtid,
 // gtid: global thread ID for calling thread
 // task: task to be finished
 // resumed_task: task to be resumed.  (may be NULL if task is serialized)
+// bypass: if not NULL, receives a successor made ready by the task, for the
+//         caller to execute next
 template <bool ompt>
 static void __kmp_task_finish(kmp_int32 gtid, kmp_task_t *task,
-                              kmp_taskdata_t *resumed_task) {
+                              kmp_taskdata_t *resumed_task,
+                              kmp_task_t **bypass = NULL) {
   kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA(task);
   kmp_info_t *thread = __kmp_threads[gtid];
   kmp_task_team_t *task_team =
@@ -855,13 +1637,40 @@ static void __kmp_task_finish(kmp_int32 gtid, kmp_task_t *task,
   if (node && (node->dn.mtx_num_locks < 0)) {
     // negative num_locks means all locks were acquired
     node->dn.mtx_num_locks = -node->dn.mtx_num_locks;
-    for (int i = node->dn.mtx_num_locks - 1; i >= 0; --i) {
-      KMP_DEBUG_ASSERT(node->dn.mtx_locks[i] != NULL);
-      __kmp_release_lock(node->dn.mtx_locks[i], gtid);
+    __kmp_mtx_deps_release(gtid, node, node->dn.mtx_num_locks);
+  }
+
+  // bookkeeping for resuming task:
+  // GEH - note tasking_ser => task_serial
+  KMP_DEBUG_ASSERT(
+      (taskdata->td_flags.tasking_ser || taskdata->td_flags.task_serial) ==
+      taskdata->td_flags.task_serial);
+  if (taskdata->td_flags.task_serial) {
+    if (resumed_task == NULL) {
+      resumed_task = taskdata->td_parent; // In a serialized task, the resumed
+      // task is the parent
     }
+  } else {
+    KMP_DEBUG_ASSERT(resumed_task !=
+                     NULL); // verify that resumed task is passed as arguemnt
+  }
+
+  /* If the tasks' destructor thunk flag has been set, we need to invoke the
+     destructor thunk that has been generated by the compiler. The code is
+     placed here, since at this point other tasks might have been released
+     hence overlapping the destructor invokations with some other work in the
+     released tasks.  The OpenMP spec is not specific on when the destructors
+     are invoked, so we should be free to choose. */
+  if (taskdata->td_flags.destructors_thunk) {
+    kmp_routine_entry_t destr_thunk = task->data1.destructors;
+    KMP_ASSERT(destr_thunk);
+    destr_thunk(gtid, task);
   }
 
   KMP_DEBUG_ASSERT(taskdata->td_flags.complete == 0);
+  KMP_DEBUG_ASSERT(taskdata->td_flags.started == 1);
+  KMP_DEBUG_ASSERT(taskdata->td_flags.freed == 0);
+
   bool detach = false;
   if (taskdata->td_flags.detachable == TASK_DETACHABLE) {
     if (taskdata->td_allow_completion_event.type ==
@@ -870,14 +1679,17 @@ static void __kmp_task_finish(kmp_int32 gtid, kmp_task_t *task,
       __kmp_acquire_tas_lock(&taskdata->td_allow_completion_event.lock, gtid);
       if (taskdata->td_allow_completion_event.type ==
           KMP_EVENT_ALLOW_COMPLETION) {
+        // The task finished its execution. Once it is a proxy, the thread
+        // fulfilling the event may complete and free it at any time, so
+        // taskdata must not be accessed after this point.
+        KMP_DEBUG_ASSERT(taskdata->td_flags.executing == 1);
+        taskdata->td_flags.executing = 0; // suspend the finishing task
         taskdata->td_flags.proxy = TASK_PROXY; // proxify!
         detach = true;
       }
       __kmp_release_tas_lock(&taskdata->td_allow_completion_event.lock, gtid);
     }
   }
-  KMP_DEBUG_ASSERT(taskdata->td_flags.started == 1);
-  KMP_DEBUG_ASSERT(taskdata->td_flags.freed == 0);
 
   if (!detach) {
     taskdata->td_flags.complete = 1; // mark the task as completed
@@ -885,57 +1697,38 @@ static void __kmp_task_finish(kmp_int32 gtid, kmp_task_t *task,
     // Only need to keep track of count if team parallel and tasking not
     // serialized
     if (!(taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser)) {
+      // A replayed task graph may be discarded as soon as its taskgroup
+      // completes, so notify the successors before
+      if (taskdata->td_taskgraph_node)
+        __kmp_taskgraph_release(gtid, taskdata, bypass);
       // Predecrement simulated by "- 1" calculation
       children =
           KMP_ATOMIC_DEC(&taskdata->td_parent->td_incomplete_child_tasks) - 1;
       KMP_DEBUG_ASSERT(children >= 0);
+#if KMP_HAVE_TASK_FIBERS
+      if (children == 0 && taskdata->td_parent->td_fiber != NULL)
+        __kmp_task_fiber_wake(taskdata->td_parent->td_fiber);
+#endif
       if (taskdata->td_taskgroup)
         KMP_ATOMIC_DEC(&taskdata->td_taskgroup->count);
-      __kmp_release_deps(gtid, taskdata);
+      __kmp_release_deps(gtid, taskdata, bypass);
     } else if (task_team && task_team->tt.tt_found_proxy_tasks) {
       // if we found proxy tasks there could exist a dependency chain
       // with the proxy task as origin
       __kmp_release_deps(gtid, taskdata);
     }
+    // td_flags.executing must be marked as 0 after __kmp_release_deps has been
+    // called. Othertwise, if a task is executed immediately from the
+    // release_deps code, the flag will be reset to 1 again by this same
+    // function
+    KMP_DEBUG_ASSERT(taskdata->td_flags.executing == 1);
+    taskdata->td_flags.executing = 0; // suspend the finishing task
   }
 
-  // td_flags.executing must be marked as 0 after __kmp_release_deps has been
-  // called. Othertwise, if a task is executed immediately from the release_deps
-  // code, the flag will be reset to 1 again by this same function
-  KMP_DEBUG_ASSERT(taskdata->td_flags.executing == 1);
-  taskdata->td_flags.executing = 0; // suspend the finishing task
-
   KA_TRACE(
       20, ("__kmp_task_finish: T#%d finished task %p, %d incomplete children\n",
            gtid, taskdata, children));
 
-  /* If the tasks' destructor thunk flag has been set, we need to invoke the
-     destructor thunk that has been generated by the compiler. The code is
-     placed here, since at this point other tasks might have been released
-     hence overlapping the destructor invokations with some other work in the
-     released tasks.  The OpenMP spec is not specific on when the destructors
-     are invoked, so we should be free to choose. */
-  if (taskdata->td_flags.destructors_thunk) {
-    kmp_routine_entry_t destr_thunk = task->data1.destructors;
-    KMP_ASSERT(destr_thunk);
-    destr_thunk(gtid, task);
-  }
-
-  // bookkeeping for resuming task:
-  // GEH - note tasking_ser => task_serial
-  KMP_DEBUG_ASSERT(
-      (taskdata->td_flags.tasking_ser || taskdata->td_flags.task_serial) ==
-      taskdata->td_flags.task_serial);
-  if (taskdata->td_flags.task_serial) {
-    if (resumed_task == NULL) {
-      resumed_task = taskdata->td_parent; // In a serialized task, the resumed
-      // task is the parent
-    }
-  } else {
-    KMP_DEBUG_ASSERT(resumed_task !=
-                     NULL); // verify that resumed task is passed as arguemnt
-  }
-
   // Free this task and then ancestor tasks if they have no children.
   // Restore th_current_task first as suggested by John:
   // johnmc: if an asynchronous inquiry peers into the runtime system
@@ -1064,7 +1857,10 @@ void __kmp_init_implicit_task(ident_t *loc_ref, kmp_info_t *this_thr,
   task->td_flags.freed = 0;
 
   task->td_depnode = NULL;
+  task->td_taskgraph = NULL;
+  task->td_taskgraph_node = NULL;
   task->td_last_tied = task;
+  task->td_fiber = NULL;
   task->td_allow_completion_event.type = KMP_EVENT_UNINITIALIZED;
 
   if (set_curr_task) { // only do this init first time thread is created
@@ -1161,6 +1957,7 @@ kmp_task_t *__kmp_task_alloc(ident_t *loc_ref, kmp_int32 gtid,
   kmp_team_t *team = thread->th.th_team;
   kmp_taskdata_t *parent_task = thread->th.th_current_task;
   size_t shareds_offset;
+  bool slab;
 
   if (!TCR_4(__kmp_init_middle))
     __kmp_middle_initialize();
@@ -1235,14 +2032,9 @@ kmp_task_t *__kmp_task_alloc(ident_t *loc_ref, kmp_int32 gtid,
   KA_TRACE(30, ("__kmp_task_alloc: T#%d Second malloc size: %ld\n", gtid,
                 sizeof_shareds));
 
-// Avoid double allocation here by combining shareds with taskdata
-#if USE_FAST_MEMORY
-  taskdata = (kmp_taskdata_t *)__kmp_fast_allocate(thread, shareds_offset +
-                                                               sizeof_shareds);
-#else /* ! USE_FAST_MEMORY */
-  taskdata = (kmp_taskdata_t *)__kmp_thread_malloc(thread, shareds_offset +
-                                                               sizeof_shareds);
-#endif /* USE_FAST_MEMORY */
+  // Avoid double allocation here by combining shareds with taskdata
+  taskdata = __kmp_alloc_task_storage(thread, shareds_offset + sizeof_shareds,
+                                      &slab);
   ANNOTATE_HAPPENS_AFTER(taskdata);
 
   task = KMP_TASKDATA_TO_TASK(taskdata);
@@ -1286,10 +2078,12 @@ kmp_task_t *__kmp_task_alloc(ident_t *loc_ref, kmp_int32 gtid,
   taskdata->td_flags.final = flags->final;
   taskdata->td_flags.merged_if0 = flags->merged_if0;
   taskdata->td_flags.destructors_thunk = flags->destructors_thunk;
+  taskdata->td_flags.priority_specified = flags->priority_specified;
   taskdata->td_flags.proxy = flags->proxy;
   taskdata->td_flags.detachable = flags->detachable;
   taskdata->td_task_team = thread->th.th_task_team;
   taskdata->td_size_alloc = shareds_offset + sizeof_shareds;
+  taskdata->td_numa_node = -1;
   taskdata->td_flags.tasktype = TASK_EXPLICIT;
 
   // GEH - TODO: fix this to copy parent task's value of tasking_ser flag
@@ -1312,6 +2106,7 @@ kmp_task_t *__kmp_task_alloc(ident_t *loc_ref, kmp_int32 gtid,
   taskdata->td_flags.freed = 0;
 
   taskdata->td_flags.native = flags->native;
+  taskdata->td_flags.slab = slab;
 
   KMP_ATOMIC_ST_RLX(&taskdata->td_incomplete_child_tasks, 0);
   // start at one because counts current task and children
@@ -1320,10 +2115,13 @@ kmp_task_t *__kmp_task_alloc(ident_t *loc_ref, kmp_int32 gtid,
       parent_task->td_taskgroup; // task inherits taskgroup from the parent task
   taskdata->td_dephash = NULL;
   taskdata->td_depnode = NULL;
+  taskdata->td_taskgraph = NULL;
+  taskdata->td_taskgraph_node = NULL;
   if (flags->tiedness == TASK_UNTIED)
     taskdata->td_last_tied = NULL; // will be set when the task is scheduled
   else
     taskdata->td_last_tied = taskdata;
+  taskdata->td_fiber = NULL;
   taskdata->td_allow_completion_event.type = KMP_EVENT_UNINITIALIZED;
 #if OMPT_SUPPORT
   if (UNLIKELY(ompt_enabled.enabled))
@@ -1404,18 +2202,364 @@ kmp_int32
 __kmpc_omp_reg_task_with_affinity(ident_t *loc_ref, kmp_int32 gtid,
                                   kmp_task_t *new_task, kmp_int32 naffins,
                                   kmp_task_affinity_info_t *affin_list) {
+  kmp_taskdata_t *new_taskdata = KMP_TASK_TO_TASKDATA(new_task);
+
+  // Nothing to place if the task will be executed immediately
+  if (__kmp_tasking_mode == tskm_immediate_exec ||
+      new_taskdata->td_flags.task_serial || naffins <= 0 || affin_list == NULL)
+    return 0;
+
+  // The task is placed by the NUMA node of its largest affinity range
+  kmp_int32 largest = -1;
+  for (kmp_int32 i = 0; i < naffins; ++i) {
+    if (affin_list[i].len > 0 &&
+        (largest < 0 || affin_list[i].len > affin_list[largest].len))
+      largest = i;
+  }
+  if (largest >= 0)
+    new_taskdata->td_numa_node = __kmp_get_numa_node_of_range(
+        (void *)affin_list[largest].base_addr, affin_list[largest].len);
+
+  KA_TRACE(20, ("__kmpc_omp_reg_task_with_affinity: T#%d task %p has %d "
+                "affinity ranges, node %d\n",
+                gtid, new_taskdata, naffins, new_taskdata->td_numa_node));
   return 0;
 }
 
-//  __kmp_invoke_task: invoke the specified task
+// Task cutoff: a thread that already has enough queued tasks to keep the team
+// busy executes the short tasks it creates immediately, as if undeferred, which
+// saves queuing them. The duration of the tasks of each construct is sampled
+// on the threads that execute them.
+#define KMP_TASK_CUTOFF_SAMPLING 16 // one executed task in 16 is timed
+#if !KMP_USE_MONITOR && KMP_OS_UNIX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+// TSC ticks, at the rate measured at initialization as for the blocktime
+#define KMP_TASK_CUTOFF_NOW() __kmp_hardware_timestamp()
+#define KMP_TASK_CUTOFF_SHORT (__kmp_ticks_per_msec / 50) // 20us
+#else
+#define KMP_TASK_CUTOFF_NOW() __kmp_now_nsec()
+#define KMP_TASK_CUTOFF_SHORT 20000 // in nanoseconds
+#endif
+
+static inline kmp_task_cutoff_entry_t *
+__kmp_task_cutoff_entry(kmp_info_t *thread, kmp_routine_entry_t routine) {
+  kmp_uintptr_t key = (kmp_uintptr_t)routine;
+  key ^= key >> 10;
+  return &thread->th.th_task_cutoff[(key >> 4) & (KMP_TASK_CUTOFF_ENTRIES - 1)];
+}
+
+// __kmp_task_cutoff_record: update the average duration of the tasks of the
+// construct of a task sampled by the thread
+static void __kmp_task_cutoff_record(kmp_info_t *thread, kmp_task_t *task,
+                                     kmp_uint64 time) {
+  kmp_task_cutoff_entry_t *entry =
+      __kmp_task_cutoff_entry(thread, task->routine);
+  if (entry->tc_routine == task->routine) {
+    entry->tc_time = (3 * entry->tc_time + time) / 4;
+  } else {
+    entry->tc_routine = task->routine;
+    entry->tc_time = time;
+  }
+}
+
+// __kmp_task_cutoff_applies: returns true if the new task should be executed
+// immediately: its construct is known to create short tasks, the thread has
+// at least __kmp_task_cutoff tasks queued, no thread of the team is idle at a
+// barrier, and no priority task is waiting to be executed first.
+static bool __kmp_task_cutoff_applies(kmp_int32 gtid, kmp_task_t *task) {
+  kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA(task);
+  kmp_info_t *thread = __kmp_threads[gtid];
+  kmp_task_team_t *task_team = thread->th.th_task_team;
+
+  if (taskdata->td_flags.task_serial || taskdata->td_flags.started ||
+      taskdata->td_flags.proxy == TASK_PROXY ||
+      taskdata->td_flags.detachable == TASK_DETACHABLE ||
+      !KMP_TASKING_ENABLED(task_team))
+    return false;
+  kmp_thread_data_t *thread_data =
+      &task_team->tt.tt_threads_data[__kmp_tid_from_gtid(gtid)];
+  if (thread_data->td.td_deque == NULL ||
+      __kmp_thread_data_ntasks(thread_data) < __kmp_task_cutoff)
+    return false;
+  if (KMP_ATOMIC_LD_RLX(&task_team->tt.tt_unfinished_threads) <
+          task_team->tt.tt_nproc ||
+      KMP_ATOMIC_LD_RLX(&task_team->tt.tt_num_task_pri) > 0)
+    return false;
+  kmp_task_cutoff_entry_t *entry =
+      __kmp_task_cutoff_entry(thread, task->routine);
+  return entry->tc_routine == task->routine &&
+         entry->tc_time < KMP_TASK_CUTOFF_SHORT;
+}
+
+// Task fibers.
+// With KMP_TASK_FIBERS, an untied task runs on a stack of its own, taken from a
+// pool of the thread. When it waits for its children in a taskwait or yields,
+// it switches back to the scheduler that ran it instead of executing other
+// tasks on top of its stack, so waits do not grow the stack nor constrain the
+// tasks the thread may schedule meanwhile. The task is resumed by the thread
+// that suspended it (its home) once it is ready: the compiler-outlined task
+// code keeps the gtid it was invoked with, so it cannot move to another thread.
+// Hence a ready task waits for its home thread to return to the scheduler: a
+// long task run by the home thread meanwhile delays it, however many threads
+// are idle, and deep untied recursions may lose parallelism this way.
+// A suspended task counts as an unfinished thread of the task team, so that
+// the barrier waits for it.
+#if KMP_HAVE_TASK_FIBERS
+#define KMP_TASK_FIBER_POOL 16 // Free fibers kept by a thread
+
+enum kmp_task_fiber_status {
+  KMP_TASK_FIBER_DONE, // The task routine returned
+  KMP_TASK_FIBER_WAIT, // The task waits for its children
+  KMP_TASK_FIBER_YIELD // The task yields
+};
+
+typedef struct kmp_task_fiber {
+  ucontext_t tf_context; // Saved context of the task
+  ucontext_t *tf_return; // Context of the scheduler running the task
+  void *tf_stack; // Stack, with a guard page at its low end
+  size_t tf_stacksize; // Size of tf_stack, guard page included
+  kmp_task_t *tf_task; // Task running on the fiber
+  kmp_int32 tf_gtid; // Home thread of the task
+  kmp_int32 tf_status; // Why the task switched back to the scheduler
+  std::atomic<kmp_int32> tf_waiting; // Suspended until its children complete
+  kmp_task_team_t *tf_task_team; // Task team counting the suspended task
+  struct kmp_task_fiber *tf_next; // Free list or ready list of the home thread
+} kmp_task_fiber_t;
+
+// __kmp_task_fiber_main: entry of a fiber, runs the tasks given to it and
+// switches back to the scheduler after each one
+static void __kmp_task_fiber_main(unsigned int hi, unsigned int lo) {
+  kmp_task_fiber_t *fiber = (kmp_task_fiber_t *)(kmp_uintptr_t)(
+      ((kmp_uint64)hi << 32) | (kmp_uint64)lo);
+  for (;;) {
+    kmp_task_t *task = fiber->tf_task;
+#ifdef KMP_GOMP_COMPAT
+    if (KMP_TASK_TO_TASKDATA(task)->td_flags.native) {
+      ((void (*)(void *))(*(task->routine)))(task->shareds);
+    } else
+#endif /* KMP_GOMP_COMPAT */
+    {
+      (*(task->routine))(fiber->tf_gtid, task);
+    }
+    fiber->tf_status = KMP_TASK_FIBER_DONE;
+    swapcontext(&fiber->tf_context, fiber->tf_return);
+  }
+}
+
+// __kmp_get_task_fiber: take a fiber from the pool of the thread, or create
+// one. Returns NULL if no stack can be allocated.
+static kmp_task_fiber_t *__kmp_get_task_fiber(kmp_info_t *thread) {
+  kmp_task_fiber_t *fiber = thread->th.th_task_fibers;
+  if (fiber != NULL) {
+    thread->th.th_task_fibers = fiber->tf_next;
+    return fiber;
+  }
+  size_t page_size = (size_t)getpagesize();
+  size_t size = (__kmp_task_fiber_stksize + page_size - 1) & ~(page_size - 1);
+  void *stack = mmap(NULL, size + page_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (stack == MAP_FAILED)
+    return NULL;
+  mprotect(stack, page_size, PROT_NONE); // catch stack overflows
+
+  fiber = (kmp_task_fiber_t *)__kmp_allocate(sizeof(kmp_task_fiber_t));
+  fiber->tf_stack = stack;
+  fiber->tf_stacksize = size + page_size;
+  getcontext(&fiber->tf_context);
+  fiber->tf_context.uc_stack.ss_sp = (char *)stack + page_size;
+  fiber->tf_context.uc_stack.ss_size = size;
+  fiber->tf_context.uc_link = NULL;
+  kmp_uint64 addr = (kmp_uint64)(kmp_uintptr_t)fiber;
+  makecontext(&fiber->tf_context, (void (*)(void))__kmp_task_fiber_main, 2,
+              (unsigned int)(addr >> 32), (unsigned int)addr);
+  KA_TRACE(20, ("__kmp_get_task_fiber: T#%d created fiber %p\n",
+                __kmp_gtid_from_thread(thread), fiber));
+  return fiber;
+}
+
+static void __kmp_destroy_task_fiber(kmp_task_fiber_t *fiber) {
+  munmap(fiber->tf_stack, fiber->tf_stacksize);
+  __kmp_free(fiber);
+}
+
+// __kmp_put_task_fiber: give back a fiber whose task completed to the pool
+static void __kmp_put_task_fiber(kmp_info_t *thread, kmp_task_fiber_t *fiber) {
+  int count = 0;
+  for (kmp_task_fiber_t *f = thread->th.th_task_fibers; f != NULL;
+       f = f->tf_next)
+    ++count;
+  if (count >= KMP_TASK_FIBER_POOL) {
+    __kmp_destroy_task_fiber(fiber);
+    return;
+  }
+  fiber->tf_next = thread->th.th_task_fibers;
+  thread->th.th_task_fibers = fiber;
+}
+
+// __kmp_task_fiber_ready: queue a suspended task for its home thread
+static void __kmp_task_fiber_ready(kmp_task_fiber_t *fiber) {
+  kmp_info_t *home = __kmp_threads[fiber->tf_gtid];
+  kmp_task_fiber_t *head = KMP_ATOMIC_LD_RLX(&home->th.th_task_fibers_ready);
+  do {
+    fiber->tf_next = head;
+  } while (!home->th.th_task_fibers_ready.compare_exchange_weak(
+      head, fiber, std::memory_order_release, std::memory_order_relaxed));
+  __kmp_resume_idle_thread(home); // it may sleep at a barrier
+}
+
+// __kmp_task_fiber_wake: called when the last child of a task running on a
+// fiber completes; makes the task ready if it is suspended in a taskwait
+static void __kmp_task_fiber_wake(kmp_task_fiber_t *fiber) {
+  kmp_int32 waiting = 1;
+  if (KMP_ATOMIC_LD_ACQ(&fiber->tf_waiting) == 1 &&
+      fiber->tf_waiting.compare_exchange_strong(waiting, 0)) {
+    KA_TRACE(20, ("__kmp_task_fiber_wake: task %p is ready\n",
+                  KMP_TASK_TO_TASKDATA(fiber->tf_task)));
+    __kmp_task_fiber_ready(fiber);
+  }
+}
+
+// __kmp_task_fiber_suspend: switch from the task of a fiber back to the
+// scheduler, which makes the task ready again when its children complete
+// (status KMP_TASK_FIBER_WAIT) or right away (KMP_TASK_FIBER_YIELD). Returns
+// when the home thread resumes the task.
+static void __kmp_task_fiber_suspend(kmp_task_fiber_t *fiber,
+                                     kmp_int32 status) {
+  fiber->tf_status = status;
+  swapcontext(&fiber->tf_context, fiber->tf_return);
+}
+
+// __kmp_task_fiber_run: switch to the task of a fiber until it completes or
+// suspends, then restore resumed_task as the current task if it suspended.
+// Returns true if the task routine completed.
+static bool __kmp_task_fiber_run(kmp_info_t *thread, kmp_task_fiber_t *fiber,
+                                 kmp_taskdata_t *resumed_task) {
+  kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA(fiber->tf_task);
+  ucontext_t scheduler;
+  fiber->tf_return = &scheduler;
+  swapcontext(&scheduler, &fiber->tf_context);
+  if (fiber->tf_status == KMP_TASK_FIBER_DONE) {
+    taskdata->td_fiber = NULL;
+    __kmp_put_task_fiber(thread, fiber);
+    return true;
+  }
+
+  // The context of the task is saved, it may be made ready from now on
+  taskdata->td_flags.executing = 0;
+  thread->th.th_current_task = resumed_task;
+  resumed_task->td_flags.executing = 1;
+  KMP_ATOMIC_INC(&fiber->tf_task_team->tt.tt_unfinished_threads);
+  KMP_COUNT_BLOCK(TASK_fiber_suspended);
+  KA_TRACE(20, ("__kmp_task_fiber_run: T#%d suspended task %p (status %d)\n",
+                fiber->tf_gtid, taskdata, fiber->tf_status));
+  if (fiber->tf_status == KMP_TASK_FIBER_WAIT) {
+    kmp_int32 waiting = 1;
+    KMP_ATOMIC_ST_REL(&fiber->tf_waiting, 1);
+    // The last child may have completed before the task was suspended
+    if (KMP_ATOMIC_LD_ACQ(&taskdata->td_incomplete_child_tasks) != 0 ||
+        !fiber->tf_waiting.compare_exchange_strong(waiting, 0))
+      return false;
+  }
+  __kmp_task_fiber_ready(fiber);
+  return false;
+}
+
+// __kmp_invoke_task_fiber: run an untied task on a fiber. Returns true if the
+// task routine completed, false if it was suspended or could not get a fiber
+// (*suspended tells which).
+static bool __kmp_invoke_task_fiber(kmp_int32 gtid, kmp_task_t *task,
+                                    kmp_taskdata_t *current_task,
+                                    bool *suspended) {
+  kmp_info_t *thread = __kmp_threads[gtid];
+  kmp_task_fiber_t *fiber = __kmp_get_task_fiber(thread);
+  *suspended = false;
+  if (fiber == NULL)
+    return false;
+  fiber->tf_task = task;
+  fiber->tf_gtid = gtid;
+  fiber->tf_task_team = thread->th.th_task_team;
+  KMP_ATOMIC_ST_RLX(&fiber->tf_waiting, 0);
+  KMP_TASK_TO_TASKDATA(task)->td_fiber = fiber;
+  if (__kmp_task_fiber_run(thread, fiber, current_task))
+    return true;
+  *suspended = true;
+  return false;
+}
+
+// __kmp_resume_task_fibers: resume the ready tasks suspended by this thread,
+// oldest first. Returns the number of tasks resumed.
+static kmp_int32 __kmp_resume_task_fibers(kmp_info_t *thread, kmp_int32 gtid,
+                                          std::atomic<kmp_int32> *unfinished,
+                                          int *thread_finished) {
+  kmp_task_fiber_t *list = thread->th.th_task_fibers_ready.exchange(
+      NULL, std::memory_order_acquire);
+  kmp_task_fiber_t *fiber = NULL;
+  kmp_int32 count = 0;
+  while (list != NULL) { // reverse the list
+    kmp_task_fiber_t *next = list->tf_next;
+    list->tf_next = fiber;
+    fiber = list;
+    list = next;
+  }
+  while (fiber != NULL) {
+    kmp_task_fiber_t *next = fiber->tf_next;
+    kmp_task_t *task = fiber->tf_task;
+    kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA(task);
+    kmp_taskdata_t *current_task = thread->th.th_current_task;
+    KMP_DEBUG_ASSERT(fiber->tf_gtid == gtid);
+    if (*thread_finished) {
+      // The thread becomes active again, as when it steals a task
+      KMP_ATOMIC_INC(unfinished);
+      *thread_finished = FALSE;
+    }
+    KMP_ATOMIC_DEC(&fiber->tf_task_team->tt.tt_unfinished_threads);
+    KA_TRACE(20, ("__kmp_resume_task_fibers: T#%d resumes task %p\n", gtid,
+                  taskdata));
+
+    current_task->td_flags.executing = 0;
+    taskdata->td_last_tied = current_task->td_last_tied;
+    thread->th.th_current_task = taskdata;
+    taskdata->td_flags.executing = 1;
+    if (__kmp_task_fiber_run(thread, fiber, current_task)) {
+#if OMPT_SUPPORT
+      if (UNLIKELY(ompt_enabled.enabled))
+        __kmp_task_finish<true>(gtid, task, current_task);
+      else
+#endif
+        __kmp_task_finish<false>(gtid, task, current_task);
+    }
+    ++count;
+    fiber = next;
+  }
+  return count;
+}
+#endif // KMP_HAVE_TASK_FIBERS
+
+// __kmp_free_task_fibers: release the fibers kept by the thread. Only occurs
+// when the thread is reaped.
+void __kmp_free_task_fibers(kmp_info_t *thread) {
+#if KMP_HAVE_TASK_FIBERS
+  kmp_task_fiber_t *fiber = thread->th.th_task_fibers;
+  while (fiber != NULL) {
+    kmp_task_fiber_t *next = fiber->tf_next;
+    __kmp_destroy_task_fiber(fiber);
+    fiber = next;
+  }
+  thread->th.th_task_fibers = NULL;
+#endif
+}
+
+//  __kmp_invoke_task_body: invoke the specified task
 //
 // gtid: global thread ID of caller
 // task: the task to invoke
 // current_task: the task to resume after task invokation
-static void __kmp_invoke_task(kmp_int32 gtid, kmp_task_t *task,
-                              kmp_taskdata_t *current_task) {
+// Returns a successor made ready by the task that should be executed next, if
+// successors are handed off (KMP_TASK_BYPASS), NULL otherwise.
+static kmp_task_t *__kmp_invoke_task_body(kmp_int32 gtid, kmp_task_t *task,
+                                          kmp_taskdata_t *current_task) {
   kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA(task);
   kmp_info_t *thread;
+  kmp_task_t *bypass = NULL;
   int discard = 0 /* false */;
   KA_TRACE(
       30, ("__kmp_invoke_task(enter): T#%d invoking task %p, current_task=%p\n",
@@ -1436,7 +2580,26 @@ static void __kmp_invoke_task(kmp_int32 gtid, kmp_task_t *task,
                   "proxy task %p, resuming task %p\n",
                   gtid, taskdata, current_task));
 
-    return;
+    return NULL;
+  }
+
+  // A task taken from a queue gets its mutexinoutset dependences now, or is
+  // parked until their owner completes
+  kmp_depnode_t *node = taskdata->td_depnode;
+  if (node && node->dn.mtx_num_locks > 0) {
+    // an untied task is counted again when it is queued after being parked
+    bool untied = taskdata->td_flags.tiedness == TASK_UNTIED;
+    if (untied)
+      KMP_ATOMIC_DEC(&taskdata->td_untied_count);
+    if (!__kmp_mtx_deps_acquire(gtid, node, taskdata)) {
+      KMP_COUNT_BLOCK(TASK_mtx_parked);
+      KA_TRACE(30, ("__kmp_invoke_task(exit): T#%d parked task %p on a "
+                    "mutexinoutset dependence\n",
+                    gtid, taskdata));
+      return NULL;
+    }
+    if (untied)
+      KMP_ATOMIC_INC(&taskdata->td_untied_count);
   }
 
 #if OMPT_SUPPORT
@@ -1540,15 +2703,50 @@ static void __kmp_invoke_task(kmp_int32 gtid, kmp_task_t *task,
     }
 #endif
 
+    kmp_uint64 cutoff_start = 0;
+    if (__kmp_task_cutoff > 0) {
+      thread = __kmp_threads[gtid];
+      if (++thread->th.th_task_cutoff_samples % KMP_TASK_CUTOFF_SAMPLING == 0)
+        cutoff_start = KMP_TASK_CUTOFF_NOW();
+    }
+
+    bool fiber_run = false, suspended = false;
+#if KMP_HAVE_TASK_FIBERS
+    // Untied tasks of a parallel team run on a fiber
+    if (__kmp_task_fibers && taskdata->td_flags.tiedness == TASK_UNTIED &&
+        !taskdata->td_flags.task_serial &&
+        __kmp_threads[gtid]->th.th_task_team != NULL)
+      fiber_run =
+          __kmp_invoke_task_fiber(gtid, task, current_task, &suspended) ||
+          suspended;
+#endif
+    if (!fiber_run) {
 #ifdef KMP_GOMP_COMPAT
-    if (taskdata->td_flags.native) {
-      ((void (*)(void *))(*(task->routine)))(task->shareds);
-    } else
+      if (taskdata->td_flags.native) {
+        ((void (*)(void *))(*(task->routine)))(task->shareds);
+      } else
 #endif /* KMP_GOMP_COMPAT */
-    {
-      (*(task->routine))(gtid, task);
+      {
+        (*(task->routine))(gtid, task);
+      }
+    }
+    KMP_POP_PARTITIONED_TIMER();
+
+    if (suspended) {
+      // The task completes when its home thread resumes it
+#if OMPT_SUPPORT
+      if (UNLIKELY(ompt_enabled.enabled))
+        thread->th.ompt_thread_info = oldInfo;
+#endif
+      KA_TRACE(30, ("__kmp_invoke_task(exit): T#%d suspended task %p, "
+                    "resuming task %p\n",
+                    gtid, taskdata, current_task));
+      return NULL;
     }
-    KMP_POP_PARTITIONED_TIMER();
+
+    if (cutoff_start)
+      __kmp_task_cutoff_record(thread, task,
+                               KMP_TASK_CUTOFF_NOW() - cutoff_start);
 
 #if USE_ITT_BUILD && USE_ITT_NOTIFY
     if (kmp_itt_count_task) {
@@ -1569,17 +2767,56 @@ static void __kmp_invoke_task(kmp_int32 gtid, kmp_task_t *task,
       if (taskdata->td_flags.tiedness == TASK_TIED) {
         taskdata->ompt_task_info.frame.exit_frame = ompt_data_none;
       }
-      __kmp_task_finish<true>(gtid, task, current_task);
+      __kmp_task_finish<true>(gtid, task, current_task,
+                              __kmp_task_bypass ? &bypass : NULL);
     } else
 #endif
-      __kmp_task_finish<false>(gtid, task, current_task);
+      __kmp_task_finish<false>(gtid, task, current_task,
+                               __kmp_task_bypass ? &bypass : NULL);
   }
 
   KA_TRACE(
       30,
       ("__kmp_invoke_task(exit): T#%d completed task %p, resuming task %p\n",
        gtid, taskdata, current_task));
-  return;
+  return bypass;
+}
+
+#define KMP_TASK_BYPASS_CHAIN 16 // successors run in a row before queuing one
+
+//  __kmp_invoke_task: invoke the specified task, then the chain of successors
+//  it hands off. Running a successor right away keeps the data it shares with
+//  its predecessor in the cache of this thread, instead of letting it be
+//  stolen from the deque. The chain is cut after KMP_TASK_BYPASS_CHAIN
+//  successors: the next one is queued, where other threads may steal it, and
+//  the caller gets to check the condition it waits for.
+//
+// gtid: global thread ID of caller
+// task: the task to invoke
+// current_task: the task to resume after task invokation
+static void __kmp_invoke_task(kmp_int32 gtid, kmp_task_t *task,
+                              kmp_taskdata_t *current_task) {
+  task = __kmp_invoke_task_body(gtid, task, current_task);
+  for (int chain = 0; task != NULL; ++chain) {
+    kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA(task);
+    // Tasks with a priority or with affinity go through the queues, and the
+    // successor must obey the task scheduling constraint like any other task
+    // this thread picks up
+    if (chain == KMP_TASK_BYPASS_CHAIN ||
+        (taskdata->td_flags.priority_specified && task->data2.priority > 0 &&
+         __kmp_max_task_priority > 0) ||
+        taskdata->td_numa_node >= 0 ||
+        !__kmp_task_can_start(gtid, __kmp_task_stealing_constraint, taskdata,
+                              current_task)) {
+      __kmp_omp_task(gtid, task, false);
+      return;
+    }
+    KMP_COUNT_BLOCK(TASK_bypassed);
+    KA_TRACE(30, ("__kmp_invoke_task: T#%d running successor %p handed off by "
+                  "the finished task\n",
+                  gtid, taskdata));
+    task = __kmp_invoke_task_body(gtid, task, current_task);
+  }
 }
 
 // __kmpc_omp_task_parts: Schedule a thread-switchable task for execution
@@ -1721,6 +2958,12 @@ kmp_int32 __kmpc_omp_task(ident_t *loc_ref, kmp_int32 gtid,
   }
 #endif
 
+  // Execute the task immediately if the team has enough work queued already
+  if (__kmp_task_cutoff > 0 && __kmp_enable_task_throttling &&
+      __kmp_task_cutoff_applies(gtid, new_task)) {
+    KMP_COUNT_BLOCK(TASK_cutoff);
+    KMP_TASK_TO_TASKDATA(new_task)->td_flags.task_serial = 1;
+  }
   res = __kmp_omp_task(gtid, new_task, true);
 
   KA_TRACE(10, ("__kmpc_omp_task(exit): T#%d returning "
@@ -1849,6 +3092,12 @@ static kmp_int32 __kmpc_omp_taskwait_template(ident_t *loc_ref, kmp_int32 gtid,
     must_wait = must_wait || (thread->th.th_task_team != NULL &&
                               thread->th.th_task_team->tt.tt_found_proxy_tasks);
     if (must_wait) {
+#if KMP_HAVE_TASK_FIBERS
+      // A task running on a fiber is resumed once its children completed
+      if (taskdata->td_fiber != NULL &&
+          KMP_ATOMIC_LD_ACQ(&taskdata->td_incomplete_child_tasks) != 0)
+        __kmp_task_fiber_suspend(taskdata->td_fiber, KMP_TASK_FIBER_WAIT);
+#endif
       kmp_flag_32 flag(RCAST(std::atomic<kmp_uint32> *,
                              &(taskdata->td_incomplete_child_tasks)),
                        0U);
@@ -1954,10 +3203,16 @@ kmp_int32 __kmpc_omp_taskyield(ident_t *loc_ref, kmp_int32 gtid, int end_part) {
           if (UNLIKELY(ompt_enabled.enabled))
             thread->th.ompt_thread_info.ompt_task_yielded = 1;
 #endif
-          __kmp_execute_tasks_32(
-              thread, gtid, NULL, FALSE,
-              &thread_finished USE_ITT_BUILD_ARG(itt_sync_obj),
-              __kmp_task_stealing_constraint);
+#if KMP_HAVE_TASK_FIBERS
+          // A task running on a fiber goes back to the queue of its thread
+          if (taskdata->td_fiber != NULL)
+            __kmp_task_fiber_suspend(taskdata->td_fiber, KMP_TASK_FIBER_YIELD);
+          else
+#endif
+            __kmp_execute_tasks_32(
+                thread, gtid, NULL, FALSE,
+                &thread_finished USE_ITT_BUILD_ARG(itt_sync_obj),
+                __kmp_task_stealing_constraint);
 #if OMPT_SUPPORT
           if (UNLIKELY(ompt_enabled.enabled))
             thread->th.ompt_thread_info.ompt_task_yielded = 0;
@@ -2108,6 +3363,8 @@ void *__kmp_task_reduction_init(int gtid, int num, T *data) {
     arr[i].reduce_shar = data[i].reduce_shar;
     arr[i].reduce_size = size;
     arr[i].flags = data[i].flags;
+    if (__kmp_task_red_lazy)
+      arr[i].flags.lazy_priv = 1; // threads not running tasks need no copy
     arr[i].reduce_comb = data[i].reduce_comb;
     arr[i].reduce_init = data[i].reduce_init;
     arr[i].reduce_fini = data[i].reduce_fini;
@@ -2251,6 +3508,76 @@ void *__kmpc_task_reduction_get_th_data(int gtid, void *tskgrp, void *data) {
   return NULL; // ERROR, this line never executed
 }
 
+// Parameters of the task combining two private copies of a reduction item,
+// kept in the shareds of the task structure.
+typedef struct __taskred_combine_params {
+  void (*comb)(void *, void *);
+  void (*fini)(void *);
+  void *dst; // copy to combine into
+  void *src; // copy finalized after the combine
+  int lazy; // src was lazily allocated on its own
+} __taskred_combine_params_t;
+
+// Combine one private copy of a reduction item into another one.
+static int __kmp_taskred_combine_task(int gtid, void *ptask) {
+  __taskred_combine_params_t *p =
+      (__taskred_combine_params_t *)((kmp_task_t *)ptask)->shareds;
+  p->comb(p->dst, p->src);
+  if (p->fini)
+    p->fini(p->src);
+  if (p->lazy)
+    __kmp_free(p->src);
+  return 0;
+}
+
+// Combine the private copies of the big reduction items pairwise by tasks
+// executed by the team, with log2(#copies) rounds, so that copies[i * nth] is
+// the only copy left of item i. Each task touches two copies of one item only.
+static void __kmp_task_reduction_tree(kmp_info_t *th, kmp_taskgroup_t *tg,
+                                      void **copies, int *ncopies,
+                                      bool *tree) {
+  kmp_int32 gtid = __kmp_gtid_from_thread(th);
+  kmp_int32 nth = th->th.th_team_nproc;
+  kmp_taskred_data_t *arr = (kmp_taskred_data_t *)tg->reduce_data;
+  kmp_int32 num = tg->reduce_num_data;
+  kmp_flag_32 flag(RCAST(std::atomic<kmp_uint32> *, &(tg->count)), 0U);
+  int thread_finished = FALSE;
+
+  for (int s = 1; s < nth; s *= 2) {
+    bool spawned = false;
+    for (int i = 0; i < num; ++i) {
+      if (!tree[i])
+        continue;
+      void **c = copies + i * nth;
+      for (int j = 0; j + s < ncopies[i]; j += 2 * s) {
+        kmp_task_t *task = __kmpc_omp_task_alloc(
+            NULL, gtid, 1, sizeof(kmp_task_t),
+            sizeof(__taskred_combine_params_t), &__kmp_taskred_combine_task);
+        __taskred_combine_params_t *p =
+            (__taskred_combine_params_t *)task->shareds;
+        p->comb = (void (*)(void *, void *))(arr[i].reduce_comb);
+        p->fini = (void (*)(void *))(arr[i].reduce_fini);
+        p->dst = c[j];
+        p->src = c[j + s];
+        p->lazy = arr[i].flags.lazy_priv;
+        __kmp_omp_task(gtid, task, true);
+        spawned = true;
+      }
+    }
+    if (!spawned)
+      break;
+    // wait for the round, the taskgroup only holds the combine tasks now
+    while (KMP_ATOMIC_LD_ACQ(&tg->count) != 0) {
+      flag.execute_tasks(th, gtid, FALSE,
+                         &thread_finished USE_ITT_BUILD_ARG(NULL),
+                         __kmp_task_stealing_constraint);
+    }
+  }
+  for (int i = 0; i < num; ++i)
+    if (tree[i] && ncopies[i] > 1)
+      ncopies[i] = 1;
+}
+
 // Finalize task reduction.
 // Called from __kmpc_end_taskgroup()
 static void __kmp_task_reduction_fini(kmp_info_t *th, kmp_taskgroup_t *tg) {
@@ -2258,33 +3585,52 @@ static void __kmp_task_reduction_fini(kmp_info_t *th, kmp_taskgroup_t *tg) {
   KMP_DEBUG_ASSERT(nth > 1); // should not be called if nth == 1
   kmp_taskred_data_t *arr = (kmp_taskred_data_t *)tg->reduce_data;
   kmp_int32 num = tg->reduce_num_data;
+  // collect the private copies of each item, only the threads which accessed
+  // a lazily privatized item have a copy of it
+  void **copies = (void **)__kmp_thread_malloc(th, num * nth * sizeof(void *));
+  int *ncopies = (int *)__kmp_thread_malloc(th, num * sizeof(int));
+  bool *tree = (bool *)__kmp_thread_malloc(th, num * sizeof(bool));
+  bool any_tree = false;
+  for (int i = 0; i < num; ++i) {
+    void **c = copies + i * nth;
+    int n = 0;
+    if (!arr[i].flags.lazy_priv) {
+      for (int j = 0; j < nth; ++j)
+        c[n++] = (char *)(arr[i].reduce_priv) + j * arr[i].reduce_size;
+    } else {
+      void **pr_data = (void **)(arr[i].reduce_priv);
+      for (int j = 0; j < nth; ++j)
+        if (pr_data[j] != NULL)
+          c[n++] = pr_data[j];
+    }
+    ncopies[i] = n;
+    tree[i] = n > 2 && __kmp_task_red_combine_size > 0 &&
+              arr[i].reduce_size >= (size_t)__kmp_task_red_combine_size;
+    any_tree = any_tree || tree[i];
+  }
+  // combining in parallel needs tasks which can be discarded by cancellation
+  if (any_tree && th->th.th_task_team != NULL &&
+      tg->cancel_request == cancel_noreq)
+    __kmp_task_reduction_tree(th, tg, copies, ncopies, tree);
+
   for (int i = 0; i < num; ++i) {
     void *sh_data = arr[i].reduce_shar;
     void (*f_fini)(void *) = (void (*)(void *))(arr[i].reduce_fini);
     void (*f_comb)(void *, void *) =
         (void (*)(void *, void *))(arr[i].reduce_comb);
-    if (!arr[i].flags.lazy_priv) {
-      void *pr_data = arr[i].reduce_priv;
-      size_t size = arr[i].reduce_size;
-      for (int j = 0; j < nth; ++j) {
-        void *priv_data = (char *)pr_data + j * size;
-        f_comb(sh_data, priv_data); // combine results
-        if (f_fini)
-          f_fini(priv_data); // finalize if needed
-      }
-    } else {
-      void **pr_data = (void **)(arr[i].reduce_priv);
-      for (int j = 0; j < nth; ++j) {
-        if (pr_data[j] != NULL) {
-          f_comb(sh_data, pr_data[j]); // combine results
-          if (f_fini)
-            f_fini(pr_data[j]); // finalize if needed
-          __kmp_free(pr_data[j]);
-        }
-      }
+    void **c = copies + i * nth;
+    for (int j = 0; j < ncopies[i]; ++j) {
+      f_comb(sh_data, c[j]); // combine results
+      if (f_fini)
+        f_fini(c[j]); // finalize if needed
+      if (arr[i].flags.lazy_priv)
+        __kmp_free(c[j]);
     }
     __kmp_free(arr[i].reduce_priv);
   }
+  __kmp_thread_free(th, tree);
+  __kmp_thread_free(th, ncopies);
+  __kmp_thread_free(th, copies);
   __kmp_thread_free(th, arr);
   tg->reduce_data = NULL;
   tg->reduce_num_data = 0;
@@ -2568,6 +3914,56 @@ void __kmpc_end_taskgroup(ident_t *loc, int gtid) {
 #endif
 }
 
+// __kmp_get_priority_task: remove the oldest task of the highest priority
+// queue whose head task the task scheduling constraint allows to execute
+static kmp_task_t *__kmp_get_priority_task(
+    kmp_int32 gtid, kmp_task_team_t *task_team,
+    std::atomic<kmp_int32> *unfinished_threads, int *thread_finished,
+    kmp_int32 is_constrained) {
+  kmp_taskdata_t *current = __kmp_threads[gtid]->th.th_current_task;
+  kmp_task_pri_t *list;
+
+  for (list = (kmp_task_pri_t *)TCR_PTR(task_team->tt.tt_task_pri_list);
+       list != NULL; list = (kmp_task_pri_t *)TCR_PTR(list->next)) {
+    kmp_thread_data_t *thread_data = &list->td;
+    if (TCR_4(thread_data->td.td_deque_ntasks) == 0)
+      continue;
+
+    __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+    if (TCR_4(thread_data->td.td_deque_ntasks) == 0) {
+      __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+      continue;
+    }
+    kmp_taskdata_t *taskdata =
+        thread_data->td.td_deque[thread_data->td.td_deque_head];
+    if (!__kmp_task_is_allowed(gtid, is_constrained, taskdata, current)) {
+      __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+      continue;
+    }
+    thread_data->td.td_deque_head =
+        (thread_data->td.td_deque_head + 1) & TASK_DEQUE_MASK(thread_data->td);
+    if (*thread_finished) {
+      // Un-mark this thread as finished before releasing the lock, see
+      // __kmp_steal_task
+      kmp_int32 count;
+      count = KMP_ATOMIC_INC(unfinished_threads);
+      KA_TRACE(20, ("__kmp_get_priority_task: T#%d inc unfinished_threads to "
+                    "%d: task_team=%p\n",
+                    gtid, count + 1, task_team));
+      *thread_finished = FALSE;
+    }
+    TCW_4(thread_data->td.td_deque_ntasks,
+          TCR_4(thread_data->td.td_deque_ntasks) - 1);
+    KMP_ATOMIC_DEC(&task_team->tt.tt_num_task_pri);
+    __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+
+    KA_TRACE(10, ("__kmp_get_priority_task: T#%d got task %p of priority %d\n",
+                  gtid, taskdata, list->priority));
+    return KMP_TASKDATA_TO_TASK(taskdata);
+  }
+  return NULL;
+}
+
 // __kmp_remove_my_task: remove a task from my own deque
 static kmp_task_t *__kmp_remove_my_task(kmp_info_t *thread, kmp_int32 gtid,
                                         kmp_task_team_t *task_team,
@@ -2587,7 +3983,28 @@ static kmp_task_t *__kmp_remove_my_task(kmp_info_t *thread, kmp_int32 gtid,
                 gtid, thread_data->td.td_deque_ntasks,
                 thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
 
-  if (TCR_4(thread_data->td.td_deque_ntasks) == 0) {
+  if (__kmp_task_deque_lockfree && __kmp_ring_ntasks(thread_data) != 0) {
+    taskdata = __kmp_ring_take(thread_data);
+    if (taskdata != NULL) {
+      if (!__kmp_task_is_allowed(gtid, is_constrained, taskdata,
+                                 thread->th.th_current_task)) {
+        // The TSC does not allow to execute the bottom task; put it back
+        __kmp_ring_push(thread, thread_data, taskdata);
+        KA_TRACE(10, ("__kmp_remove_my_task(exit #5): T#%d TSC blocks bottom "
+                      "task of ring\n",
+                      gtid));
+        return NULL;
+      }
+      KA_TRACE(10, ("__kmp_remove_my_task(exit #6): T#%d task %p removed "
+                    "from ring\n",
+                    gtid, taskdata));
+      return KMP_TASKDATA_TO_TASK(taskdata);
+    }
+    // Lost the last task to a thief; fall through to the locked deque
+  }
+
+  if (TCR_4(thread_data->td.td_deque_ntasks) == 0 &&
+      TCR_4(thread_data->td.td_spill_ntasks) == 0) {
     KA_TRACE(10,
              ("__kmp_remove_my_task(exit #1): T#%d No tasks to remove: "
               "ntasks=%d head=%u tail=%u\n",
@@ -2598,6 +4015,21 @@ static kmp_task_t *__kmp_remove_my_task(kmp_info_t *thread, kmp_int32 gtid,
 
   __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
 
+  if (thread_data->td.td_spill != NULL) {
+    // The spilled tasks are the most recent ones
+    taskdata = thread_data->td.td_spill;
+    if (__kmp_task_is_allowed(gtid, is_constrained, taskdata,
+                              thread->th.th_current_task))
+      __kmp_pop_spilled_task(thread_data);
+    else
+      taskdata = NULL;
+    __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+    KA_TRACE(10, ("__kmp_remove_my_task(exit #7): T#%d spilled task %p "
+                  "removed\n",
+                  gtid, taskdata));
+    return taskdata ? KMP_TASKDATA_TO_TASK(taskdata) : NULL;
+  }
+
   if (TCR_4(thread_data->td.td_deque_ntasks) == 0) {
     __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
     KA_TRACE(10,
@@ -2638,6 +4070,46 @@ static kmp_task_t *__kmp_remove_my_task(kmp_info_t *thread, kmp_int32 gtid,
   return task;
 }
 
+// __kmp_task_steal_batch_size: number of tasks a steal may take from a victim
+// holding ntasks tasks: up to half of them, bounded by __kmp_task_steal_batch.
+// A thief executing a tied explicit task only takes one task, since the
+// task scheduling constraint would likely keep it from running the others
+// and they would just bounce between the deques.
+static kmp_int32 __kmp_task_steal_batch_size(kmp_int32 gtid, kmp_int32 ntasks,
+                                             kmp_int32 is_constrained) {
+  if (__kmp_task_steal_batch <= 1 || ntasks < 4)
+    return 1;
+  if (is_constrained) {
+    kmp_taskdata_t *current = __kmp_threads[gtid]->th.th_current_task;
+    if (current->td_last_tied->td_flags.tasktype == TASK_EXPLICIT)
+      return 1;
+  }
+  return KMP_MIN(ntasks / 2, __kmp_task_steal_batch);
+}
+
+// __kmp_push_stolen_tasks: add the extra tasks taken by a batch steal to the
+// thief's own deque, where they can be executed by the thief or stolen again.
+// Unlike __kmp_push_task there is no throttling since the tasks were already
+// deferred once.
+static void __kmp_push_stolen_tasks(kmp_info_t *thread,
+                                    kmp_thread_data_t *thread_data,
+                                    kmp_taskdata_t **tasks, kmp_int32 ntasks) {
+  // No lock needed since only owner can allocate
+  if (thread_data->td.td_deque == NULL)
+    __kmp_alloc_task_deque(thread, thread_data);
+
+  if (__kmp_task_deque_lockfree) {
+    for (kmp_int32 i = 0; i < ntasks; ++i)
+      __kmp_ring_push(thread, thread_data, tasks[i]);
+    return;
+  }
+
+  __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+  for (kmp_int32 i = 0; i < ntasks; ++i)
+    __kmp_queue_task(thread, thread_data, tasks[i]);
+  __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+}
+
 // __kmp_steal_task: remove a task from another thread's deque
 // Assume that calling thread has already checked existence of
 // task_team thread_data before calling this routine.
@@ -2652,6 +4124,9 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
   kmp_thread_data_t *victim_td, *threads_data;
   kmp_int32 target;
   kmp_int32 victim_tid;
+  // Extra tasks taken by a batch steal (KMP_TASK_STEAL_BATCH > 1)
+  kmp_taskdata_t *extra[KMP_MAX_TASK_STEAL_BATCH];
+  kmp_int32 nextra = 0;
 
   KMP_DEBUG_ASSERT(__kmp_tasking_mode != tskm_immediate_exec);
 
@@ -2667,7 +4142,59 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
                 victim_td->td.td_deque_ntasks, victim_td->td.td_deque_head,
                 victim_td->td.td_deque_tail));
 
-  if (TCR_4(victim_td->td.td_deque_ntasks) == 0) {
+  if (__kmp_task_deque_lockfree && __kmp_ring_ntasks(victim_td) != 0) {
+    kmp_int32 ntasks = __kmp_ring_ntasks(victim_td);
+    kmp_int32 count;
+    if (*thread_finished) {
+      // Un-mark this thread as finished before the task leaves the victim's
+      // deque, as is done under the lock below; undone if the steal fails.
+      count = KMP_ATOMIC_INC(unfinished_threads);
+      KA_TRACE(20, ("__kmp_steal_task: T#%d inc unfinished_threads to %d: "
+                    "task_team=%p\n",
+                    gtid, count + 1, task_team));
+    }
+    taskdata = __kmp_ring_steal(victim_td);
+    if (taskdata != NULL &&
+        !__kmp_task_is_allowed(gtid, is_constrained, taskdata,
+                               __kmp_threads[gtid]->th.th_current_task)) {
+      // The TSC does not allow to execute the stolen task; hand it back
+      __kmp_requeue_stolen_task(victim_thr, victim_td, taskdata);
+      taskdata = NULL;
+    }
+    if (taskdata != NULL) {
+      *thread_finished = FALSE;
+      // Batch steal: the ring only allows taking tasks one CAS at a time, so
+      // stop after the first task that is not a sibling of the stolen one.
+      kmp_int32 max_extra =
+          __kmp_task_steal_batch_size(gtid, ntasks, is_constrained) - 1;
+      while (nextra < max_extra &&
+             (extra[nextra] = __kmp_ring_steal(victim_td)) != NULL) {
+        if (extra[nextra++]->td_parent != taskdata->td_parent)
+          break;
+      }
+      if (nextra > 0)
+        __kmp_push_stolen_tasks(__kmp_threads[gtid],
+                                &threads_data[__kmp_tid_from_gtid(gtid)],
+                                extra, nextra);
+      KMP_COUNT_BLOCK(TASK_stolen);
+      KMP_COUNT_VALUE(TASK_tasks_per_steal, nextra + 1);
+      KA_TRACE(10, ("__kmp_steal_task(exit #6): T#%d stole task %p and %d "
+                    "more from T#%d ring: task_team=%p\n",
+                    gtid, taskdata, nextra, __kmp_gtid_from_thread(victim_thr),
+                    task_team));
+      return KMP_TASKDATA_TO_TASK(taskdata);
+    }
+    if (*thread_finished) {
+      count = KMP_ATOMIC_DEC(unfinished_threads);
+      KA_TRACE(20, ("__kmp_steal_task: T#%d dec unfinished_threads to %d: "
+                    "task_team=%p\n",
+                    gtid, count - 1, task_team));
+    }
+  }
+
+  if (TCR_4(victim_td->td.td_deque_ntasks) == 0 &&
+      TCR_4(victim_td->td.td_spill_ntasks) == 0) {
+    KMP_COUNT_BLOCK(TASK_steal_empty);
     KA_TRACE(10, ("__kmp_steal_task(exit #1): T#%d could not steal from T#%d: "
                   "task_team=%p ntasks=%d head=%u tail=%u\n",
                   gtid, __kmp_gtid_from_thread(victim_thr), task_team,
@@ -2679,9 +4206,13 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
   __kmp_acquire_bootstrap_lock(&victim_td->td.td_deque_lock);
 
   int ntasks = TCR_4(victim_td->td.td_deque_ntasks);
+  // Raid the spill stack of the victim once its deque is empty
+  if (ntasks == 0 && victim_td->td.td_spill != NULL)
+    ntasks = __kmp_refill_task_deque(victim_td);
   // Check again after we acquire the lock
   if (ntasks == 0) {
     __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
+    KMP_COUNT_BLOCK(TASK_steal_empty);
     KA_TRACE(10, ("__kmp_steal_task(exit #2): T#%d could not steal from T#%d: "
                   "task_team=%p ntasks=%d head=%u tail=%u\n",
                   gtid, __kmp_gtid_from_thread(victim_thr), task_team, ntasks,
@@ -2740,6 +4271,20 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
         (kmp_uint32)((target + 1) & TASK_DEQUE_MASK(victim_td->td)));
     victim_td->td.td_deque_tail = target; // tail -= 1 (wrapped))
   }
+  // Batch steal: take more siblings of the stolen task from the victim's head.
+  // They are moved to the thief's deque after the victim's lock is released,
+  // so two threads stealing from each other cannot deadlock.
+  for (kmp_int32 max_extra =
+           __kmp_task_steal_batch_size(gtid, ntasks, is_constrained) - 1;
+       nextra < max_extra; ++nextra) {
+    kmp_taskdata_t *sibling =
+        victim_td->td.td_deque[victim_td->td.td_deque_head];
+    if (sibling->td_parent != taskdata->td_parent)
+      break;
+    extra[nextra] = sibling;
+    victim_td->td.td_deque_head =
+        (victim_td->td.td_deque_head + 1) & TASK_DEQUE_MASK(victim_td->td);
+  }
   if (*thread_finished) {
     // We need to un-mark this victim as a finished victim.  This must be done
     // before releasing the lock, or else other threads (starting with the
@@ -2755,11 +4300,17 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
 
     *thread_finished = FALSE;
   }
-  TCW_4(victim_td->td.td_deque_ntasks, ntasks - 1);
+  TCW_4(victim_td->td.td_deque_ntasks, ntasks - 1 - nextra);
+  victim_td->td.td_deque_steals += 1 + nextra;
 
   __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
 
+  if (nextra > 0)
+    __kmp_push_stolen_tasks(__kmp_threads[gtid],
+                            &threads_data[__kmp_tid_from_gtid(gtid)], extra,
+                            nextra);
   KMP_COUNT_BLOCK(TASK_stolen);
+  KMP_COUNT_VALUE(TASK_tasks_per_steal, nextra + 1);
   KA_TRACE(10,
            ("__kmp_steal_task(exit #5): T#%d stole task %p from T#%d: "
             "task_team=%p ntasks=%d head=%u tail=%u\n",
@@ -2770,6 +4321,111 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
   return task;
 }
 
+// __kmp_steal_task_hierarchical: try to steal a task, probing victims that are
+// close to the calling thread in the machine hierarchy first: up to
+// __kmp_task_steal_retries[0] random SMT siblings, then up to [1] random
+// threads of the same domain (package/NUMA node), then up to [2] random remote
+// threads. Thread ids are mapped to the hierarchy assuming compact placement,
+// as for the hierarchical barrier. On success *victim_tid is set.
+static kmp_task_t *__kmp_steal_task_hierarchical(
+    kmp_info_t *thread, kmp_int32 gtid, kmp_task_team_t *task_team,
+    std::atomic<kmp_int32> *unfinished_threads, int *thread_finished,
+    kmp_int32 is_constrained, kmp_int32 *victim_tid) {
+  kmp_thread_data_t *threads_data = task_team->tt.tt_threads_data;
+  kmp_int32 nthreads = task_team->tt.tt_nproc;
+  kmp_int32 tid = thread->th.th_info.ds.ds_tid;
+  kmp_uint32 widths[2];
+  __kmp_get_steal_domains(nthreads, &widths[0], &widths[1]);
+
+  // Group [lo, hi) of the previous level, excluded from the current level
+  kmp_int32 inner_lo = tid, inner_hi = tid + 1;
+  for (int level = 0; level < 3; ++level) {
+    kmp_int32 lo = 0, hi = nthreads;
+    if (level < 2) {
+      lo = tid - tid % (kmp_int32)widths[level];
+      hi = KMP_MIN(lo + (kmp_int32)widths[level], nthreads);
+    }
+    kmp_int32 ncandidates = (hi - lo) - (inner_hi - inner_lo);
+    for (int attempt = 0;
+         ncandidates > 0 && attempt < __kmp_task_steal_retries[level];
+         ++attempt) {
+      kmp_int32 victim = lo + __kmp_get_random(thread) % ncandidates;
+      if (victim >= inner_lo)
+        victim += inner_hi - inner_lo; // skip over the inner group
+      kmp_info_t *other_thread = threads_data[victim].td.td_thr;
+      // A sleeping victim is left to the wake-on-demand policy. Without it,
+      // wake the victim as the random policy does; it is not expected to have
+      // tasks, so go on with the next candidate.
+      if ((__kmp_tasking_mode == tskm_task_teams) &&
+          (__kmp_dflt_blocktime != KMP_MAX_BLOCKTIME) &&
+          (TCR_PTR(CCAST(void *, other_thread->th.th_sleep_loc)) != NULL)) {
+        if (__kmp_task_wakeup_cap == 0) {
+          __kmp_null_resume_wrapper(__kmp_gtid_from_thread(other_thread),
+                                    other_thread->th.th_sleep_loc);
+          continue;
+        }
+        __kmp_found_idle_thread(task_team, other_thread);
+      }
+      kmp_task_t *task =
+          __kmp_steal_task(other_thread, gtid, task_team, unfinished_threads,
+                           thread_finished, is_constrained);
+      if (task != NULL) {
+        KA_TRACE(15, ("__kmp_steal_task_hierarchical: T#%d stole from T#%d at "
+                      "level %d\n",
+                      gtid, __kmp_gtid_from_thread(other_thread), level));
+        if (level == 0) {
+          KMP_COUNT_BLOCK(TASK_stolen_smt);
+        } else if (level == 1) {
+          KMP_COUNT_BLOCK(TASK_stolen_domain);
+        } else {
+          KMP_COUNT_BLOCK(TASK_stolen_remote);
+        }
+        *victim_tid = victim;
+        return task;
+      }
+      if (level == 0) {
+        KMP_COUNT_BLOCK(TASK_steal_failed_smt);
+      } else if (level == 1) {
+        KMP_COUNT_BLOCK(TASK_steal_failed_domain);
+      } else {
+        KMP_COUNT_BLOCK(TASK_steal_failed_remote);
+      }
+    }
+    inner_lo = lo;
+    inner_hi = hi;
+  }
+  return NULL;
+}
+
+// __kmp_get_steal_victim: pick a random thread other than tid to steal from.
+// Once the task team has a per-node index with more than one node, victims are
+// picked among the threads on the thief's own node first: after as many failed
+// picks there as the node has other threads, one is picked in the whole team.
+static kmp_int32 __kmp_get_steal_victim(kmp_info_t *thread,
+                                        kmp_task_team_t *task_team,
+                                        kmp_thread_data_t *thread_data,
+                                        kmp_int32 tid, kmp_int32 nthreads) {
+  kmp_int32 node = thread_data->td.td_numa_node;
+  if (KMP_ATOMIC_LD_ACQ(&task_team->tt.tt_num_nodes) > 1 && node >= 0 &&
+      node < KMP_TASK_MAX_NUMA_NODES) {
+    kmp_int32 first = task_team->tt.tt_node_start[node];
+    kmp_int32 nlocal = task_team->tt.tt_node_start[node + 1] - first;
+    if (thread_data->td.td_node_probes < nlocal - 1) {
+      ++thread_data->td.td_node_probes;
+      kmp_int32 *tids = &task_team->tt.tt_node_tids[first];
+      kmp_int32 victim = tids[__kmp_get_random(thread) % (nlocal - 1)];
+      // Excludes self from the random distribution
+      return victim == tid ? tids[nlocal - 1] : victim;
+    }
+    thread_data->td.td_node_probes = 0;
+  }
+  kmp_int32 victim = __kmp_get_random(thread) % (nthreads - 1);
+  if (victim >= tid) {
+    ++victim; // Adjusts random distribution to exclude self
+  }
+  return victim;
+}
+
 // __kmp_execute_tasks_template: Choose and execute tasks until either the
 // condition is statisfied (return true) or there are none left (return false).
 //
@@ -2816,12 +4472,44 @@ static inline int __kmp_execute_tasks_template(
     // getting tasks from target constructs
     while (1) { // Inner loop to find a task and execute it
       task = NULL;
-      if (use_own_tasks) { // check on own queue first
+      if (KMP_ATOMIC_LD_RLX(&task_team->tt.tt_completed_tasks) != NULL &&
+          __kmp_drain_completed_tasks(gtid, task_team, unfinished_threads,
+                                      thread_finished) > 0) {
+        // Finishing proxy tasks completed outside the team may satisfy the
+        // condition, as executing a task does, or release successors onto the
+        // own queue
+        if (flag == NULL || (!final_spin && flag->done_check()))
+          return TRUE;
+        use_own_tasks = 1;
+      }
+#if KMP_HAVE_TASK_FIBERS
+      // Resume first the tasks this thread suspended which are ready, so that
+      // they complete before new tasks are started and suspended in turn, and
+      // before any task is dequeued, which leaving the loop would lose
+      if (KMP_ATOMIC_LD_RLX(&thread->th.th_task_fibers_ready) != NULL &&
+          __kmp_resume_task_fibers(thread, gtid, unfinished_threads,
+                                   thread_finished) > 0) {
+        if (flag == NULL || (!final_spin && flag->done_check()))
+          return TRUE;
+        use_own_tasks = 1;
+        continue;
+      }
+#endif
+      if (KMP_ATOMIC_LD_RLX(&task_team->tt.tt_num_task_pri) != 0) {
+        // check on priority queues first
+        task = __kmp_get_priority_task(gtid, task_team, unfinished_threads,
+                                       thread_finished, is_constrained);
+      }
+      if (task == NULL && use_own_tasks) { // check on own queue first
         task = __kmp_remove_my_task(thread, gtid, task_team, is_constrained);
       }
       if ((task == NULL) && (nthreads > 1)) { // Steal a task
         int asleep = 1;
         use_own_tasks = 0;
+        // A thief finds its node when its deque is set up, which is needed to
+        // index the team by node. No lock needed since only owner can allocate
+        if (__kmp_task_numa_local && threads_data[tid].td.td_deque == NULL)
+          __kmp_alloc_task_deque(thread, &threads_data[tid]);
         // Try to steal from the last place I stole from successfully.
         if (victim_tid == -2) { // haven't stolen anything yet
           victim_tid = threads_data[tid].td.td_deque_last_stolen;
@@ -2831,16 +4519,25 @@ static inline int __kmp_execute_tasks_template(
         }
         if (victim_tid != -1) { // found last victim
           asleep = 0;
+        } else if (!new_victim &&
+                   __kmp_task_steal_policy == task_steal_hierarchical) {
+          // Probe victims nearest in the machine hierarchy first. The steal is
+          // done there, so leave asleep set to skip the single steal below.
+          task = __kmp_steal_task_hierarchical(thread, gtid, task_team,
+                                               unfinished_threads,
+                                               thread_finished, is_constrained,
+                                               &victim_tid);
+          if (task != NULL)
+            other_thread = threads_data[victim_tid].td.td_thr;
         } else if (!new_victim) { // no recent steals and we haven't already
           // used a new victim; select a random thread
           do { // Find a different thread to steal work from.
             // Pick a random thread. Initial plan was to cycle through all the
             // threads, and only return if we tried to steal from every thread,
             // and failed.  Arch says that's not such a great idea.
-            victim_tid = __kmp_get_random(thread) % (nthreads - 1);
-            if (victim_tid >= tid) {
-              ++victim_tid; // Adjusts random distribution to exclude self
-            }
+            victim_tid = __kmp_get_steal_victim(thread, task_team,
+                                                &threads_data[tid], tid,
+                                                nthreads);
             // Found a potential victim
             other_thread = threads_data[victim_tid].td.td_thr;
             // There is a slight chance that __kmp_enable_tasking() did not wake
@@ -2856,15 +4553,22 @@ static inline int __kmp_execute_tasks_template(
                 (__kmp_dflt_blocktime != KMP_MAX_BLOCKTIME) &&
                 (TCR_PTR(CCAST(void *, other_thread->th.th_sleep_loc)) !=
                  NULL)) {
-              asleep = 1;
-              __kmp_null_resume_wrapper(__kmp_gtid_from_thread(other_thread),
-                                        other_thread->th.th_sleep_loc);
-              // A sleeping thread should not have any tasks on it's queue.
-              // There is a slight possibility that it resumes, steals a task
-              // from another thread, which spawns more tasks, all in the time
-              // that it takes this thread to check => don't write an assertion
-              // that the victim's queue is empty.  Try stealing from a
-              // different thread.
+              if (__kmp_task_wakeup_cap > 0) {
+                // Leave the victim to the wake-on-demand policy, and try to
+                // steal from it anyway, though its queue is most likely empty.
+                __kmp_found_idle_thread(task_team, other_thread);
+              } else {
+                asleep = 1;
+                __kmp_null_resume_wrapper(
+                    __kmp_gtid_from_thread(other_thread),
+                    other_thread->th.th_sleep_loc);
+                // A sleeping thread should not have any tasks on it's queue.
+                // There is a slight possibility that it resumes, steals a task
+                // from another thread, which spawns more tasks, all in the time
+                // that it takes this thread to check => don't write an
+                // assertion that the victim's queue is empty.  Try stealing
+                // from a different thread.
+              }
             }
           } while (asleep);
         }
@@ -2876,6 +4580,7 @@ static inline int __kmp_execute_tasks_template(
                                   is_constrained);
         }
         if (task != NULL) { // set last stolen to victim
+          threads_data[tid].td.td_node_probes = 0;
           if (threads_data[tid].td.td_deque_last_stolen != victim_tid) {
             threads_data[tid].td.td_deque_last_stolen = victim_tid;
             // The pre-refactored code did not try more than 1 successful new
@@ -2925,7 +4630,7 @@ static inline int __kmp_execute_tasks_template(
       KMP_YIELD(__kmp_library == library_throughput); // Yield before next task
       // If execution of a stolen task results in more tasks being placed on our
       // run queue, reset use_own_tasks
-      if (!use_own_tasks && TCR_4(threads_data[tid].td.td_deque_ntasks) != 0) {
+      if (!use_own_tasks && __kmp_thread_data_ntasks(&threads_data[tid]) != 0) {
         KA_TRACE(20, ("__kmp_execute_tasks_template: T#%d stolen task spawned "
                       "other tasks, restart\n",
                       gtid));
@@ -3050,6 +4755,10 @@ static void __kmp_enable_tasking(kmp_task_team_t *task_team,
     // Release any threads sleeping at the barrier, so that they can steal
     // tasks and execute them.  In extra barrier mode, tasks do not sleep
     // at the separate tasking barrier, so this isn't a problem.
+    // With the wake-on-demand policy, they are put on the idle stack instead
+    // and are resumed as tasks get queued.
+    if (__kmp_task_wakeup_cap > 0)
+      __kmp_acquire_bootstrap_lock(&task_team->tt.tt_idle_lock);
     for (i = 0; i < nthreads; i++) {
       volatile void *sleep_loc;
       kmp_info_t *thread = threads_data[i].td.td_thr;
@@ -3063,18 +4772,25 @@ static void __kmp_enable_tasking(kmp_task_team_t *task_team,
       // To work around this, __kmp_execute_tasks_template() periodically checks
       // see if other threads are sleeping (using the same random mechanism that
       // is used for task stealing) and awakens them if they are.
-      if ((sleep_loc = TCR_PTR(CCAST(void *, thread->th.th_sleep_loc))) !=
+      if ((sleep_loc = TCR_PTR(CCAST(void *, thread->th.th_sleep_loc))) ==
           NULL) {
-        KF_TRACE(50, ("__kmp_enable_tasking: T#%d waking up thread T#%d\n",
+        KF_TRACE(50, ("__kmp_enable_tasking: T#%d don't wake up thread T#%d\n",
                       __kmp_gtid_from_thread(this_thr),
                       __kmp_gtid_from_thread(thread)));
-        __kmp_null_resume_wrapper(__kmp_gtid_from_thread(thread), sleep_loc);
+      } else if (__kmp_task_wakeup_cap > 0) {
+        KF_TRACE(50, ("__kmp_enable_tasking: T#%d thread T#%d is idle\n",
+                      __kmp_gtid_from_thread(this_thr),
+                      __kmp_gtid_from_thread(thread)));
+        __kmp_push_idle_thread(task_team, i);
       } else {
-        KF_TRACE(50, ("__kmp_enable_tasking: T#%d don't wake up thread T#%d\n",
+        KF_TRACE(50, ("__kmp_enable_tasking: T#%d waking up thread T#%d\n",
                       __kmp_gtid_from_thread(this_thr),
                       __kmp_gtid_from_thread(thread)));
+        __kmp_null_resume_wrapper(__kmp_gtid_from_thread(thread), sleep_loc);
       }
     }
+    if (__kmp_task_wakeup_cap > 0)
+      __kmp_release_bootstrap_lock(&task_team->tt.tt_idle_lock);
   }
 
   KA_TRACE(10, ("__kmp_enable_tasking(exit): T#%d\n",
@@ -3117,6 +4833,58 @@ static kmp_task_team_t *__kmp_free_task_teams =
 kmp_bootstrap_lock_t __kmp_task_team_lock =
     KMP_BOOTSTRAP_LOCK_INITIALIZER(__kmp_task_team_lock);
 
+// __kmp_index_task_threads:
+// Builds the per-node index of the threads of a task team once the node of
+// every thread is known, and places the pages of tt_threads_data holding only
+// entries of threads of one node on that node. Thieves and threads giving away
+// tasks with affinity use the index to find threads on a given node. Caller
+// must hold tt_threads_lock.
+static void __kmp_index_task_threads(kmp_task_team_t *task_team) {
+  kmp_thread_data_t *threads_data = task_team->tt.tt_threads_data;
+  kmp_int32 nthreads = task_team->tt.tt_nproc;
+  kmp_int32 *start = task_team->tt.tt_node_start;
+  kmp_int32 i, j, node, num_nodes = 0;
+
+  KMP_DEBUG_ASSERT(KMP_ATOMIC_LD_RLX(&task_team->tt.tt_num_nodes) == 0);
+  // Counting sort of the tids by node
+  for (node = 0; node <= KMP_TASK_MAX_NUMA_NODES; ++node)
+    start[node] = 0;
+  for (i = 0; i < nthreads; ++i) {
+    node = threads_data[i].td.td_numa_node;
+    if (node < 0 || node >= KMP_TASK_MAX_NUMA_NODES)
+      return; // leave the team without index
+    if (start[node + 1]++ == 0)
+      ++num_nodes;
+  }
+  if (task_team->tt.tt_node_tids == NULL)
+    task_team->tt.tt_node_tids = (kmp_int32 *)__kmp_allocate(
+        task_team->tt.tt_max_threads * sizeof(kmp_int32));
+  for (node = 0; node < KMP_TASK_MAX_NUMA_NODES; ++node)
+    start[node + 1] += start[node];
+  for (i = 0; i < nthreads; ++i)
+    task_team->tt.tt_node_tids[start[threads_data[i].td.td_numa_node]++] = i;
+  for (node = KMP_TASK_MAX_NUMA_NODES; node > 0; --node)
+    start[node] = start[node - 1]; // back from ends to starts of the nodes
+  start[0] = 0;
+
+  if (!task_team->tt.tt_numa_bound) {
+    for (i = 0; i < nthreads; i = j) {
+      node = threads_data[i].td.td_numa_node;
+      for (j = i + 1; j < nthreads && threads_data[j].td.td_numa_node == node;
+           ++j)
+        ;
+      __kmp_bind_numa_node(&threads_data[i],
+                           (j - i) * sizeof(kmp_thread_data_t), node);
+    }
+    task_team->tt.tt_numa_bound = TRUE;
+  }
+
+  KE_TRACE(10, ("__kmp_index_task_threads: task_team %p has %d threads on %d "
+                "nodes\n",
+                task_team, nthreads, num_nodes));
+  KMP_ATOMIC_ST_REL(&task_team->tt.tt_num_nodes, num_nodes);
+}
+
 // __kmp_alloc_task_deque:
 // Allocates a task deque for a particular thread, and initialize the necessary
 // data structures relating to the deque.  This only happens once per thread
@@ -3129,6 +4897,9 @@ static void __kmp_alloc_task_deque(kmp_info_t *thread,
 
   // Initialize last stolen task field to "none"
   thread_data->td.td_deque_last_stolen = -1;
+  // Tasks with affinity to this node are given to this thread, and the deque is
+  // placed on it
+  thread_data->td.td_numa_node = __kmp_get_numa_node();
 
   KMP_DEBUG_ASSERT(TCR_4(thread_data->td.td_deque_ntasks) == 0);
   KMP_DEBUG_ASSERT(thread_data->td.td_deque_head == 0);
@@ -3141,9 +4912,27 @@ static void __kmp_alloc_task_deque(kmp_info_t *thread,
   // Allocate space for task deque, and zero the deque
   // Cannot use __kmp_thread_calloc() because threads not around for
   // kmp_reap_task_team( ).
-  thread_data->td.td_deque = (kmp_taskdata_t **)__kmp_allocate(
-      INITIAL_TASK_DEQUE_SIZE * sizeof(kmp_taskdata_t *));
+  thread_data->td.td_deque = (kmp_taskdata_t **)__kmp_alloc_task_local(
+      INITIAL_TASK_DEQUE_SIZE * sizeof(kmp_taskdata_t *),
+      thread_data->td.td_numa_node);
   thread_data->td.td_deque_size = INITIAL_TASK_DEQUE_SIZE;
+  thread_data->td.td_deque_limit = INITIAL_TASK_DEQUE_SIZE;
+  if (__kmp_task_deque_lockfree) {
+    KMP_DEBUG_ASSERT(KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring) == NULL);
+    KMP_ATOMIC_ST_RLX(&thread_data->td.td_ring,
+                      __kmp_alloc_task_ring(INITIAL_TASK_DEQUE_SIZE,
+                                            thread_data->td.td_numa_node));
+  }
+
+  // The last thread of the team to find its node builds the per-node index
+  kmp_task_team_t *task_team = thread->th.th_task_team;
+  if (__kmp_task_numa_local && thread_data->td.td_numa_node >= 0 &&
+      KMP_ATOMIC_INC(&task_team->tt.tt_numa_known) + 1 ==
+          task_team->tt.tt_nproc) {
+    __kmp_acquire_bootstrap_lock(&task_team->tt.tt_threads_lock);
+    __kmp_index_task_threads(task_team);
+    __kmp_release_bootstrap_lock(&task_team->tt.tt_threads_lock);
+  }
 }
 
 // __kmp_free_task_deque:
@@ -3152,11 +4941,21 @@ static void __kmp_alloc_task_deque(kmp_info_t *thread,
 static void __kmp_free_task_deque(kmp_thread_data_t *thread_data) {
   if (thread_data->td.td_deque != NULL) {
     __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+    KMP_DEBUG_ASSERT(thread_data->td.td_spill == NULL);
     TCW_4(thread_data->td.td_deque_ntasks, 0);
     __kmp_free(thread_data->td.td_deque);
     thread_data->td.td_deque = NULL;
     __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
   }
+  kmp_task_ring_t *ring = KMP_ATOMIC_LD_RLX(&thread_data->td.td_ring);
+  while (ring != NULL) {
+    kmp_task_ring_t *prev = ring->tr_prev;
+    __kmp_free(ring);
+    ring = prev;
+  }
+  KMP_ATOMIC_ST_RLX(&thread_data->td.td_ring, NULL);
+  KMP_ATOMIC_ST_RLX(&thread_data->td.td_ring_top, 0);
+  KMP_ATOMIC_ST_RLX(&thread_data->td.td_ring_bottom, 0);
 
 #ifdef BUILD_TIED_TASK_STACK
   // GEH: Figure out what to do here for td_susp_tied_tasks
@@ -3214,11 +5013,14 @@ static int __kmp_realloc_task_threads_data(kmp_info_t *thread,
         // Cannot use __kmp_thread_realloc() because threads not around for
         // kmp_reap_task_team( ).  Note all new array entries are initialized
         // to zero by __kmp_allocate().
-        new_data = (kmp_thread_data_t *)__kmp_allocate(
-            nthreads * sizeof(kmp_thread_data_t));
+        new_data = (kmp_thread_data_t *)__kmp_alloc_task_local(
+            nthreads * sizeof(kmp_thread_data_t), -1);
         // copy old data to new data
         KMP_MEMCPY_S((void *)new_data, nthreads * sizeof(kmp_thread_data_t),
                      (void *)old_data, maxthreads * sizeof(kmp_thread_data_t));
+        // A thief may steal before it has a deque: no last victim yet
+        for (i = maxthreads; i < nthreads; i++)
+          new_data[i].td.td_deque_last_stolen = -1;
 
 #ifdef BUILD_TIED_TASK_STACK
         // GEH: Figure out if this is the right thing to do
@@ -3238,8 +5040,10 @@ static int __kmp_realloc_task_threads_data(kmp_info_t *thread,
         // Cannot use __kmp_thread_calloc() because threads not around for
         // kmp_reap_task_team( ).
         ANNOTATE_IGNORE_WRITES_BEGIN();
-        *threads_data_p = (kmp_thread_data_t *)__kmp_allocate(
-            nthreads * sizeof(kmp_thread_data_t));
+        *threads_data_p = (kmp_thread_data_t *)__kmp_alloc_task_local(
+            nthreads * sizeof(kmp_thread_data_t), -1);
+        for (i = 0; i < nthreads; i++)
+          (*threads_data_p)[i].td.td_deque_last_stolen = -1;
         ANNOTATE_IGNORE_WRITES_END();
 #ifdef BUILD_TIED_TASK_STACK
         // GEH: Figure out if this is the right thing to do
@@ -3250,15 +5054,25 @@ static int __kmp_realloc_task_threads_data(kmp_info_t *thread,
 #endif // BUILD_TIED_TASK_STACK
       }
       task_team->tt.tt_max_threads = nthreads;
+      // The per-node index is rebuilt for the larger array
+      task_team->tt.tt_numa_bound = FALSE;
+      if (task_team->tt.tt_node_tids != NULL) {
+        __kmp_free(task_team->tt.tt_node_tids);
+        task_team->tt.tt_node_tids = NULL;
+      }
     } else {
       // If array has (more than) enough elements, go ahead and use it
       KMP_DEBUG_ASSERT(*threads_data_p != NULL);
     }
 
     // initialize threads_data pointers back to thread_info structures
+    kmp_int32 numa_known = 0;
     for (i = 0; i < nthreads; i++) {
       kmp_thread_data_t *thread_data = &(*threads_data_p)[i];
       thread_data->td.td_thr = team->t.t_threads[i];
+      // The node of a thread is found when its deque is set up
+      if (thread_data->td.td_deque != NULL && thread_data->td.td_numa_node >= 0)
+        ++numa_known;
 
       if (thread_data->td.td_deque_last_stolen >= nthreads) {
         // The last stolen field survives across teams / barrier, and the number
@@ -3266,7 +5080,18 @@ static int __kmp_realloc_task_threads_data(kmp_info_t *thread,
         // parallel region will exhibit the same behavior as previous region.
         thread_data->td.td_deque_last_stolen = -1;
       }
+      thread_data->td.td_idle_next = KMP_TASK_NOT_IDLE;
+      thread_data->td.td_node_probes = 0;
     }
+    KMP_ATOMIC_ST_RLX(&task_team->tt.tt_num_nodes, 0);
+    KMP_ATOMIC_ST_RLX(&task_team->tt.tt_numa_known, numa_known);
+    if (__kmp_task_numa_local && numa_known == nthreads)
+      __kmp_index_task_threads(task_team);
+    // Empty the idle stack before other threads may use it
+    task_team->tt.tt_idle_top = -1;
+    task_team->tt.tt_num_woken = 0;
+    task_team->tt.tt_wake_all = FALSE;
+    KMP_ATOMIC_ST_RLX(&task_team->tt.tt_num_idle, 0);
 
     KMP_MB();
     TCW_SYNC_4(task_team->tt.tt_found_tasks, TRUE);
@@ -3289,9 +5114,29 @@ static void __kmp_free_task_threads_data(kmp_task_team_t *task_team) {
     __kmp_free(task_team->tt.tt_threads_data);
     task_team->tt.tt_threads_data = NULL;
   }
+  if (task_team->tt.tt_node_tids != NULL) {
+    __kmp_free(task_team->tt.tt_node_tids);
+    task_team->tt.tt_node_tids = NULL;
+  }
   __kmp_release_bootstrap_lock(&task_team->tt.tt_threads_lock);
 }
 
+// __kmp_free_task_pri_list:
+// Deallocates the priority queues of a task team. Only occurs at library
+// shutdown.
+static void __kmp_free_task_pri_list(kmp_task_team_t *task_team) {
+  __kmp_acquire_bootstrap_lock(&task_team->tt.tt_task_pri_lock);
+  kmp_task_pri_t *list = task_team->tt.tt_task_pri_list;
+  while (list != NULL) {
+    kmp_task_pri_t *next = list->next;
+    __kmp_free_task_deque(&list->td);
+    __kmp_free(list);
+    list = next;
+  }
+  task_team->tt.tt_task_pri_list = NULL;
+  __kmp_release_bootstrap_lock(&task_team->tt.tt_task_pri_lock);
+}
+
 // __kmp_allocate_task_team:
 // Allocates a task team associated with a specific team, taking it from
 // the global task team free list if possible.  Also initializes data
@@ -3324,6 +5169,8 @@ static kmp_task_team_t *__kmp_allocate_task_team(kmp_info_t *thread,
     // kmp_reap_task_team( ).
     task_team = (kmp_task_team_t *)__kmp_allocate(sizeof(kmp_task_team_t));
     __kmp_init_bootstrap_lock(&task_team->tt.tt_threads_lock);
+    __kmp_init_bootstrap_lock(&task_team->tt.tt_task_pri_lock);
+    __kmp_init_bootstrap_lock(&task_team->tt.tt_idle_lock);
     // AC: __kmp_allocate zeroes returned memory
     // task_team -> tt.tt_threads_data = NULL;
     // task_team -> tt.tt_max_threads = 0;
@@ -3380,6 +5227,9 @@ void __kmp_reap_task_teams(void) {
       if (task_team->tt.tt_threads_data != NULL) {
         __kmp_free_task_threads_data(task_team);
       }
+      if (task_team->tt.tt_task_pri_list != NULL) {
+        __kmp_free_task_pri_list(task_team);
+      }
       __kmp_free(task_team);
     }
     __kmp_release_bootstrap_lock(&__kmp_task_team_lock);
@@ -3515,6 +5365,11 @@ void __kmp_task_team_setup(kmp_info_t *this_thr, kmp_team_t *team, int always) {
 void __kmp_task_team_sync(kmp_info_t *this_thr, kmp_team_t *team) {
   KMP_DEBUG_ASSERT(__kmp_tasking_mode != tskm_immediate_exec);
 
+  // The tasks of the barrier are done, give back the task slab chunks they
+  // needed
+  if (__kmp_task_slab_alloc)
+    __kmp_trim_task_slabs(this_thr);
+
   // Toggle the th_task_state field, to switch which task_team this thread
   // refers to
   this_thr->th.th_task_state = 1 - this_thr->th.th_task_state;
@@ -3545,6 +5400,9 @@ void __kmp_task_team_wait(
   KMP_DEBUG_ASSERT(task_team == this_thr->th.th_task_team);
 
   if ((task_team != NULL) && KMP_TASKING_ENABLED(task_team)) {
+    // The threads left asleep by the wake-on-demand policy have to check out
+    // of the task team as well
+    __kmp_wake_all_idle_threads(task_team);
     if (wait) {
       KA_TRACE(20, ("__kmp_task_team_wait: Master T#%d waiting for all tasks "
                     "(for unfinished_threads to reach 0) on task_team = %p\n",
@@ -3556,6 +5414,8 @@ void __kmp_task_team_wait(
                              &task_team->tt.tt_unfinished_threads),
                        0U);
       flag.wait(this_thr, TRUE USE_ITT_BUILD_ARG(itt_sync_obj));
+      if (__kmp_task_deque_adaptive)
+        __kmp_shrink_task_deques(task_team);
     }
     // Deactivate the old task team, so that the worker threads will stop
     // referencing it while spinning.
@@ -3730,6 +5590,10 @@ static void __kmp_second_top_half_finish_proxy(kmp_taskdata_t *taskdata) {
   children =
       KMP_ATOMIC_DEC(&taskdata->td_parent->td_incomplete_child_tasks) - 1;
   KMP_DEBUG_ASSERT(children >= 0);
+#if KMP_HAVE_TASK_FIBERS
+  if (children == 0 && taskdata->td_parent->td_fiber != NULL)
+    __kmp_task_fiber_wake(taskdata->td_parent->td_fiber);
+#endif
 
   // Remove the imaginary children
   KMP_ATOMIC_DEC(&taskdata->td_incomplete_child_tasks);
@@ -3752,6 +5616,63 @@ static void __kmp_bottom_half_finish_proxy(kmp_int32 gtid, kmp_task_t *ptask) {
   __kmp_free_task_and_ancestors(gtid, taskdata, thread);
 }
 
+// Completion queue.
+// The bottom halves of proxy tasks completed by threads outside the team are
+// pushed lock-free on a list of the task team (KMP_TASK_COMPLETION_QUEUE),
+// which the threads of the team check before looking for tasks. The draining
+// thread takes the whole list at once, so pushes only need a CAS on the head
+// and there is no ABA problem.
+
+// __kmp_push_completed_task: queue the bottom half of a proxy task, from any
+// thread
+static void __kmp_push_completed_task(kmp_task_team_t *task_team,
+                                      kmp_taskdata_t *taskdata) {
+  kmp_taskdata_t *head = KMP_ATOMIC_LD_RLX(&task_team->tt.tt_completed_tasks);
+  do {
+    taskdata->td_completed_next = head;
+  } while (!task_team->tt.tt_completed_tasks.compare_exchange_weak(
+      head, taskdata, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// __kmp_drain_completed_tasks: run the bottom halves of all the proxy tasks
+// queued on the task team, in completion order. Returns their number.
+static kmp_int32
+__kmp_drain_completed_tasks(kmp_int32 gtid, kmp_task_team_t *task_team,
+                            std::atomic<kmp_int32> *unfinished_threads,
+                            int *thread_finished) {
+  kmp_taskdata_t *list, *next, *fifo = NULL;
+  kmp_int32 count = 0;
+
+  if (*thread_finished) {
+    // Un-mark this thread as finished while it runs the bottom halves, as is
+    // done for a steal; undone if another thread took the list first.
+    KMP_ATOMIC_INC(unfinished_threads);
+  }
+  list = task_team->tt.tt_completed_tasks.exchange(NULL,
+                                                   std::memory_order_acquire);
+  if (list == NULL) {
+    if (*thread_finished)
+      KMP_ATOMIC_DEC(unfinished_threads);
+    return 0;
+  }
+  *thread_finished = FALSE;
+
+  for (; list != NULL; list = next) {
+    next = list->td_completed_next;
+    list->td_completed_next = fifo;
+    fifo = list;
+  }
+  for (; fifo != NULL; fifo = next, ++count) {
+    next = fifo->td_completed_next; // the bottom half frees the task
+    __kmp_bottom_half_finish_proxy(gtid, KMP_TASKDATA_TO_TASK(fifo));
+  }
+  KMP_COUNT_VALUE(TASK_proxy_tasks_per_drain, count);
+  KA_TRACE(20, ("__kmp_drain_completed_tasks: T#%d finished %d proxy tasks "
+                "completed outside the team: task_team=%p\n",
+                gtid, count, task_team));
+  return count;
+}
+
 /*!
 @ingroup TASKING
 @param gtid Global Thread ID of encountering thread
@@ -3798,28 +5719,34 @@ void __kmpc_proxy_task_completed_ooo(kmp_task_t *ptask) {
 
   __kmp_first_top_half_finish_proxy(taskdata);
 
-  // Enqueue task to complete bottom half completion from a thread within the
-  // corresponding team
-  kmp_team_t *team = taskdata->td_team;
-  kmp_int32 nthreads = team->t.t_nproc;
-  kmp_info_t *thread;
-
-  // This should be similar to start_k = __kmp_get_random( thread ) % nthreads
-  // but we cannot use __kmp_get_random here
-  kmp_int32 start_k = 0;
-  kmp_int32 pass = 1;
-  kmp_int32 k = start_k;
-
-  do {
-    // For now we're just linearly trying to find a thread
-    thread = team->t.t_threads[k];
-    k = (k + 1) % nthreads;
-
-    // we did a full pass through all the threads
-    if (k == start_k)
-      pass = pass << 1;
-
-  } while (!__kmp_give_task(thread, k, ptask, pass));
+  if (__kmp_task_completion_queue) {
+    // The threads of the team run the bottom half when they drain the
+    // completion queue of the task team
+    __kmp_push_completed_task(taskdata->td_task_team, taskdata);
+  } else {
+    // Enqueue task to complete bottom half completion from a thread within the
+    // corresponding team
+    kmp_team_t *team = taskdata->td_team;
+    kmp_int32 nthreads = team->t.t_nproc;
+    kmp_info_t *thread;
+
+    // This should be similar to start_k = __kmp_get_random( thread ) % nthreads
+    // but we cannot use __kmp_get_random here
+    kmp_int32 start_k = 0;
+    kmp_int32 pass = 1;
+    kmp_int32 k = start_k;
+
+    do {
+      // For now we're just linearly trying to find a thread
+      thread = team->t.t_threads[k];
+      k = (k + 1) % nthreads;
+
+      // we did a full pass through all the threads
+      if (k == start_k)
+        pass = pass << 1;
+
+    } while (!__kmp_give_task(thread, k, ptask, pass));
+  }
 
   __kmp_second_top_half_finish_proxy(taskdata);
 
@@ -3892,6 +5819,7 @@ kmp_task_t *__kmp_task_dup_alloc(kmp_info_t *thread, kmp_task_t *task_src) {
   kmp_taskdata_t *parent_task = thread->th.th_current_task;
   size_t shareds_offset;
   size_t task_size;
+  bool slab;
 
   KA_TRACE(10, ("__kmp_task_dup_alloc(enter): Th %p, source task %p\n", thread,
                 task_src));
@@ -3904,12 +5832,9 @@ kmp_task_t *__kmp_task_dup_alloc(kmp_info_t *thread, kmp_task_t *task_src) {
   // Allocate a kmp_taskdata_t block and a kmp_task_t block.
   KA_TRACE(30, ("__kmp_task_dup_alloc: Th %p, malloc size %ld\n", thread,
                 task_size));
-#if USE_FAST_MEMORY
-  taskdata = (kmp_taskdata_t *)__kmp_fast_allocate(thread, task_size);
-#else
-  taskdata = (kmp_taskdata_t *)__kmp_thread_malloc(thread, task_size);
-#endif /* USE_FAST_MEMORY */
+  taskdata = __kmp_alloc_task_storage(thread, task_size, &slab);
   KMP_MEMCPY(taskdata, taskdata_src, task_size);
+  taskdata->td_flags.slab = slab;
 
   task = KMP_TASKDATA_TO_TASK(taskdata);
 
@@ -4363,6 +6288,185 @@ void __kmp_taskloop_recur(ident_t *loc, int gtid, kmp_task_t *task,
   KA_TRACE(40, ("__kmpc_taskloop_recur(exit): T#%d\n", gtid));
 }
 
+#define KMP_TASKLOOP_LAZY_CHUNKS 64 // chunks per thread of a lazy taskloop
+
+void __kmp_taskloop_range(ident_t *, int, kmp_task_t *, kmp_uint64 *,
+                          kmp_uint64 *, kmp_int64, kmp_uint64, kmp_uint64,
+                          kmp_uint64, kmp_uint64, kmp_uint64,
+#if OMPT_SUPPORT
+                          void *,
+#endif
+                          void *);
+
+// Execute a range of a lazy taskloop submitted as a task.
+int __kmp_taskloop_range_task(int gtid, void *ptask) {
+  __taskloop_params_t *p =
+      (__taskloop_params_t *)((kmp_task_t *)ptask)->shareds;
+  KA_TRACE(20, ("__kmp_taskloop_range_task: T#%d, task %p: %lld chunks, "
+                "grainsize %lld, extras %lld\n",
+                gtid, KMP_TASK_TO_TASKDATA(p->task), p->num_tasks,
+                p->grainsize, p->extras));
+  __kmp_taskloop_range(NULL, gtid, p->task, p->lb, p->ub, p->st, p->ub_glob,
+                       p->num_tasks, p->grainsize, p->extras, p->tc,
+#if OMPT_SUPPORT
+                       p->codeptr_ra,
+#endif
+                       p->task_dup);
+  KA_TRACE(40, ("__kmp_taskloop_range_task(exit): T#%d\n", gtid));
+  return 0;
+}
+
+// __kmp_taskloop_range_split: returns true if a range of a lazy taskloop
+// should split off half of its chunks: the thread has no queued task left,
+// so the idle threads that stole its tasks would find nothing more to take.
+static bool __kmp_taskloop_range_split(int gtid, kmp_info_t *thread) {
+  kmp_task_team_t *task_team = thread->th.th_task_team;
+  if (task_team == NULL || thread->th.th_team_nproc == 1)
+    return false;
+  if (!KMP_TASKING_ENABLED(task_team))
+    return true;
+  kmp_thread_data_t *thread_data =
+      &task_team->tt.tt_threads_data[__kmp_tid_from_gtid(gtid)];
+  return thread_data->td.td_deque == NULL ||
+         __kmp_thread_data_ntasks(thread_data) == 0;
+}
+
+// __kmp_taskloop_range: Execute the chunks of a range of a lazy taskloop in
+// order, splitting off the upper half of the remaining chunks as a new range
+// task each time the thread runs out of tasks that idle threads could steal
+// (lazy binary splitting).
+//
+// loc        Source location information
+// gtid       Global thread ID
+// task       Pattern task of the range, exposes the loop iteration range
+// lb         Pointer to loop lower bound in task structure
+// ub         Pointer to loop upper bound in task structure
+// st         Loop stride
+// ub_glob    Global upper bound (used for lastprivate check)
+// num_tasks  Number of chunks in the range
+// grainsize  Number of loop iterations per chunk
+// extras     Number of chunks with grainsize+1 iterations
+// tc         Iterations count
+// codeptr_ra Return address for OMPT events
+// task_dup   Tasks duplication routine
+void __kmp_taskloop_range(ident_t *loc, int gtid, kmp_task_t *task,
+                          kmp_uint64 *lb, kmp_uint64 *ub, kmp_int64 st,
+                          kmp_uint64 ub_glob, kmp_uint64 num_tasks,
+                          kmp_uint64 grainsize, kmp_uint64 extras,
+                          kmp_uint64 tc,
+#if OMPT_SUPPORT
+                          void *codeptr_ra,
+#endif
+                          void *task_dup) {
+  KMP_COUNT_BLOCK(OMP_TASKLOOP);
+  p_task_dup_t ptask_dup = (p_task_dup_t)task_dup;
+  kmp_taskloop_bounds_t task_bounds(task, lb, ub);
+  kmp_uint64 lower = task_bounds.get_lb();
+  kmp_info_t *thread = __kmp_threads[gtid];
+  kmp_taskdata_t *current_task = thread->th.th_current_task;
+
+  KMP_DEBUG_ASSERT(tc == num_tasks * grainsize + extras);
+  KMP_DEBUG_ASSERT(num_tasks > extras);
+  KA_TRACE(20, ("__kmp_taskloop_range: T#%d: %lld chunks, grainsize %lld, "
+                "extras %lld, i=%lld,%lld(%d), dup %p\n",
+                gtid, num_tasks, grainsize, extras, lower, ub_glob, st,
+                task_dup));
+
+  while (num_tasks > 0) {
+    if (num_tasks > 1 && __kmp_taskloop_range_split(gtid, thread)) {
+      // keep the first half of the chunks, as in __kmp_taskloop_recur
+      kmp_uint64 tc0, tc1, ext0, ext1;
+      kmp_uint64 gr_size0 = grainsize;
+      kmp_uint64 n_tsk0 = num_tasks >> 1;
+      kmp_uint64 n_tsk1 = num_tasks - n_tsk0;
+      if (n_tsk0 <= extras) {
+        gr_size0++;
+        ext0 = 0;
+        ext1 = extras - n_tsk0;
+        tc0 = gr_size0 * n_tsk0;
+        tc1 = tc - tc0;
+      } else {
+        ext1 = 0;
+        ext0 = extras;
+        tc1 = grainsize * n_tsk1;
+        tc0 = tc - tc1;
+      }
+
+      // pattern task and range task for the 2nd half
+      kmp_task_t *next_task = __kmp_task_dup_alloc(thread, task);
+      kmp_taskloop_bounds_t next_task_bounds(next_task, task_bounds);
+      next_task_bounds.set_lb(lower + st * tc0);
+      if (ptask_dup != NULL) // construct fistprivates, etc.
+        ptask_dup(next_task, task, 0);
+      kmp_task_t *new_task = __kmpc_omp_task_alloc(
+          loc, gtid, 1, 3 * sizeof(void *), sizeof(__taskloop_params_t),
+          &__kmp_taskloop_range_task);
+      __taskloop_params_t *p = (__taskloop_params_t *)new_task->shareds;
+      p->task = next_task;
+      p->lb = (kmp_uint64 *)((char *)next_task +
+                             next_task_bounds.get_lower_offset());
+      p->ub = (kmp_uint64 *)((char *)next_task +
+                             next_task_bounds.get_upper_offset());
+      p->task_dup = task_dup;
+      p->st = st;
+      p->ub_glob = ub_glob;
+      p->num_tasks = n_tsk1;
+      p->grainsize = grainsize;
+      p->extras = ext1;
+      p->tc = tc1;
+      p->num_t_min = 0;
+#if OMPT_SUPPORT
+      p->codeptr_ra = codeptr_ra;
+      __kmp_omp_taskloop_task(NULL, gtid, new_task, codeptr_ra);
+#else
+      __kmp_omp_task(gtid, new_task, true);
+#endif
+      num_tasks = n_tsk0;
+      grainsize = gr_size0;
+      extras = ext0;
+      tc = tc0;
+    }
+
+    // execute the next chunk right away
+    kmp_uint64 chunk_minus_1 = grainsize - 1;
+    kmp_int32 lastpriv = 0;
+    if (extras > 0) {
+      chunk_minus_1 = grainsize;
+      --extras;
+    }
+    kmp_uint64 upper = lower + st * chunk_minus_1;
+    if (num_tasks == 1) {
+      // set lastprivate flag for the last chunk of the loop
+      if (st == 1) {
+        lastpriv = upper == ub_glob;
+      } else if (st > 0) {
+        lastpriv = (kmp_uint64)st > ub_glob - upper;
+      } else {
+        lastpriv = upper - ub_glob < (kmp_uint64)(-st);
+      }
+    }
+    kmp_task_t *next_task = __kmp_task_dup_alloc(thread, task);
+    kmp_taskdata_t *next_taskdata = KMP_TASK_TO_TASKDATA(next_task);
+    kmp_taskloop_bounds_t next_task_bounds(next_task, task_bounds);
+    next_task_bounds.set_lb(lower);
+    next_task_bounds.set_ub(upper);
+    if (ptask_dup != NULL) // set lastprivate flag, construct fistprivates, etc.
+      ptask_dup(next_task, task, lastpriv);
+    next_taskdata->td_flags.task_serial = 1;
+#if OMPT_SUPPORT
+    __kmp_omp_taskloop_task(NULL, gtid, next_task, codeptr_ra);
+#else
+    __kmp_omp_task(gtid, next_task, true);
+#endif
+    lower = upper + st;
+    tc -= chunk_minus_1 + 1;
+    --num_tasks;
+  }
+  // free the pattern task of the range
+  __kmp_task_start(gtid, task, current_task);
+  __kmp_task_finish<false>(gtid, task, current_task);
+}
+
 /*!
 @ingroup TASKING
 @param loc       Source location information
@@ -4441,6 +6545,15 @@ void __kmpc_taskloop(ident_t *loc, int gtid, kmp_task_t *task, int if_val,
     num_tasks_min =
         KMP_MIN(thread->th.th_team_nproc * 10, INITIAL_TASK_DEQUE_SIZE);
 
+  // With no schedule clause, a lazy taskloop starts as a single range of many
+  // small chunks, which is only split into tasks as threads become idle
+  bool lazy = __kmp_taskloop_lazy && sched == 0 && if_val != 0 &&
+              !taskdata->td_flags.native;
+  if (lazy) {
+    grainsize = thread->th.th_team_nproc * KMP_TASKLOOP_LAZY_CHUNKS;
+    sched = 2;
+  }
+
   // compute num_tasks/grainsize based on the input provided
   switch (sched) {
   case 0: // no schedule clause specified, we can choose the default
@@ -4490,6 +6603,16 @@ void __kmpc_taskloop(ident_t *loc, int gtid, kmp_task_t *task, int if_val,
                           OMPT_GET_RETURN_ADDRESS(0),
 #endif
                           task_dup);
+  } else if (lazy) {
+    KA_TRACE(20, ("__kmpc_taskloop: T#%d, go lazy: tc %llu, #chunks %llu, "
+                  "grain %llu, extras %llu\n",
+                  gtid, tc, num_tasks, grainsize, extras));
+    __kmp_taskloop_range(loc, gtid, task, lb, ub, st, ub_glob, num_tasks,
+                         grainsize, extras, tc,
+#if OMPT_SUPPORT
+                         OMPT_GET_RETURN_ADDRESS(0),
+#endif
+                         task_dup);
     // !taskdata->td_flags.native => currently force linear spawning of tasks
     // for GOMP_taskloop
   } else if (num_tasks > num_tasks_min && !taskdata->td_flags.native) {
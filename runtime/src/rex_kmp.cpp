@@ -222,6 +222,51 @@ void rex_barrier_1()
     __kmpc_barrier(NULL, __kmp_get_gtid());
 }
 
+int rex_barrier_arrive(int gtid)
+{
+    return __kmpc_barrier_arrive(NULL, gtid);
+}
+
+int rex_barrier_arrive_1()
+{
+    return __kmpc_barrier_arrive(NULL, __kmp_get_gtid());
+}
+
+void rex_barrier_wait(int gtid, int token)
+{
+    __kmpc_barrier_wait(NULL, gtid, token);
+}
+
+void rex_barrier_wait_1(int token)
+{
+    __kmpc_barrier_wait(NULL, __kmp_get_gtid(), token);
+}
+
+void *rex_subteam_barrier_create(int gtid, int nthreads, const int *tids)
+{
+    return __kmpc_subteam_barrier_create(NULL, gtid, nthreads, tids);
+}
+
+void *rex_subteam_barrier_create_level(int gtid, int level)
+{
+    return __kmpc_subteam_barrier_create_level(NULL, gtid, level);
+}
+
+void rex_subteam_barrier(int gtid, void *bar)
+{
+    __kmpc_subteam_barrier(NULL, gtid, (kmp_subteam_barrier_t *)bar);
+}
+
+void rex_subteam_barrier_1(void *bar)
+{
+    __kmpc_subteam_barrier(NULL, __kmp_get_gtid(), (kmp_subteam_barrier_t *)bar);
+}
+
+void rex_subteam_barrier_destroy(int gtid, void *bar)
+{
+    __kmpc_subteam_barrier_destroy(NULL, gtid, (kmp_subteam_barrier_t *)bar);
+}
+
 int rex_master(int gtid)
 {
     return __kmpc_master(NULL, gtid);
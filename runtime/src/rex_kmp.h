@@ -26,6 +26,15 @@ extern void rex_parallel_1(rex_pfunc_t func, int num_shared, ...);
 
 extern void rex_barrier(int gtid);
 extern void rex_barrier_1();
+extern int rex_barrier_arrive(int gtid);
+extern int rex_barrier_arrive_1();
+extern void rex_barrier_wait(int gtid, int token);
+extern void rex_barrier_wait_1(int token);
+extern void *rex_subteam_barrier_create(int gtid, int nthreads, const int *tids);
+extern void *rex_subteam_barrier_create_level(int gtid, int level);
+extern void rex_subteam_barrier(int gtid, void *bar);
+extern void rex_subteam_barrier_1(void *bar);
+extern void rex_subteam_barrier_destroy(int gtid, void *bar);
 extern int rex_master(int gtid);
 extern int rex_master_1();
 extern void rex_end_master(int gtid);
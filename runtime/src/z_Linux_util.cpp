@@ -1793,6 +1793,87 @@ void __kmp_clear_system_time(void) {
   TIMEVAL_TO_TIMESPEC(&tval, &__kmp_sys_timer_data.start);
 }
 
+// Return the NUMA node of the processor the calling thread runs on, or -1 if
+// it cannot be determined.
+int __kmp_get_numa_node(void) {
+#if KMP_OS_LINUX && defined(__NR_getcpu)
+  unsigned cpu, node;
+  if (syscall(__NR_getcpu, &cpu, &node, NULL) == 0)
+    return (int)node;
+#endif
+  return -1;
+}
+
+// Return the NUMA node holding most of the pages of [addr, addr + len), or -1
+// if it cannot be determined. Up to KMP_NUMA_SAMPLE_PAGES pages evenly spread
+// over the range are queried with move_pages(2) without moving them; pages not
+// yet touched do not count.
+#define KMP_NUMA_SAMPLE_PAGES 8
+int __kmp_get_numa_node_of_range(void *addr, size_t len) {
+#if KMP_OS_LINUX && defined(__NR_move_pages)
+  static const int max_nodes = 64;
+  void *pages[KMP_NUMA_SAMPLE_PAGES];
+  int status[KMP_NUMA_SAMPLE_PAGES];
+  int votes[max_nodes];
+  size_t page_size = (size_t)getpagesize();
+  kmp_uintptr_t first = (kmp_uintptr_t)addr & ~(page_size - 1);
+  kmp_uintptr_t last =
+      ((kmp_uintptr_t)addr + (len > 0 ? len - 1 : 0)) & ~(page_size - 1);
+  size_t npages = (last - first) / page_size + 1;
+  int count = npages < KMP_NUMA_SAMPLE_PAGES ? (int)npages
+                                             : KMP_NUMA_SAMPLE_PAGES;
+  for (int i = 0; i < count; ++i)
+    pages[i] = (void *)(first + (npages - 1) * i / (count > 1 ? count - 1 : 1) *
+                                    page_size);
+  if (syscall(__NR_move_pages, 0, (unsigned long)count, pages, NULL, status,
+              0) != 0)
+    return -1;
+
+  int best = -1;
+  memset(votes, 0, sizeof(votes));
+  for (int i = 0; i < count; ++i) {
+    int node = status[i];
+    if (node < 0 || node >= max_nodes)
+      continue; // page not present or error
+    ++votes[node];
+    if (best < 0 || votes[node] > votes[best])
+      best = node;
+  }
+  return best;
+#else
+  return -1;
+#endif
+}
+
+// Ask the kernel to place the whole pages of [addr, addr + len) on the given
+// NUMA node, moving the pages already touched elsewhere. Partial pages at both
+// ends are left alone since they may hold unrelated data. Failures (no NUMA
+// support, node out of range, restricted mbind) are ignored: placement is only
+// a hint.
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+void __kmp_bind_numa_node(void *addr, size_t len, int node) {
+#if KMP_OS_LINUX && defined(__NR_mbind)
+  unsigned long mask[64 / (8 * sizeof(unsigned long)) + 1];
+  size_t page_size = (size_t)getpagesize();
+  kmp_uintptr_t first =
+      ((kmp_uintptr_t)addr + page_size - 1) & ~(page_size - 1);
+  kmp_uintptr_t last = ((kmp_uintptr_t)addr + len) & ~(page_size - 1);
+  if (node < 0 || node >= 64 || last <= first)
+    return;
+  memset(mask, 0, sizeof(mask));
+  mask[node / (8 * sizeof(unsigned long))] |=
+      1UL << (node % (8 * sizeof(unsigned long)));
+  syscall(__NR_mbind, (void *)first, (unsigned long)(last - first),
+          MPOL_PREFERRED, mask, (unsigned long)(8 * sizeof(mask)),
+          MPOL_MF_MOVE);
+#endif
+}
+
 static int __kmp_get_xproc(void) {
 
   int r = 0;
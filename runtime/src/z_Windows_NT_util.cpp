@@ -933,6 +933,13 @@ void __kmp_read_system_time(double *delta) {
   }
 }
 
+// NUMA placement of tasks is not supported on Windows* OS
+int __kmp_get_numa_node(void) { return -1; }
+
+int __kmp_get_numa_node_of_range(void *addr, size_t len) { return -1; }
+
+void __kmp_bind_numa_node(void *addr, size_t len, int node) {}
+
 /* Return the current time stamp in nsec */
 kmp_uint64 __kmp_now_nsec() {
   LARGE_INTEGER now;
@@ -0,0 +1,153 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_REDUCTION_BARRIER_PATTERN=linear,linear %libomp-run
+// RUN: %libomp-compile && env KMP_REDUCTION_BARRIER_PATTERN=tree,tree %libomp-run
+// RUN: %libomp-compile && env KMP_REDUCTION_BARRIER_PATTERN=dissemination,dissemination %libomp-run
+// RUN: %libomp-compile && env KMP_REDUCTION_BARRIER_PATTERN=hierarchical,hierarchical %libomp-run
+// RUN: %libomp-compile && env KMP_REDUCTION_BARRIER_PATTERN=hierarchical,hierarchical KMP_BLOCKTIME=infinite %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Fused allreduce of small fixed-size data in teams of all sizes from 1 to
+ * MAX_THREADS: every thread must get the sum, min or max of the values of all
+ * the threads, for each type and for as many values as fit in a cache line.
+ * The allreduces follow each other without other barriers, with tasks created
+ * before some of them, and the result of one feeds the next.
+ */
+
+#define MAX_THREADS 9
+#define PHASES 50
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  int reserved_1;
+  int flags;
+  int reserved_2;
+  int reserved_3;
+  char const *psource;
+} ident_t;
+
+enum { ar_int32, ar_int64, ar_float, ar_double };
+enum { ar_sum, ar_min, ar_max };
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(ident_t *loc);
+extern void __kmpc_allreduce(ident_t *loc, int gtid, void *data, int count,
+                             int type, int op);
+#ifdef __cplusplus
+}
+#endif
+
+static ident_t loc = {0, 2, 0, 0, ";unknown;unknown;0;0;;"};
+
+static int test_team(int nthreads) {
+  int errors = 0, tasks = 0;
+
+  #pragma omp parallel num_threads(nthreads) shared(errors, tasks)
+  {
+    int n = omp_get_num_threads();
+    int tid = omp_get_thread_num();
+    int gtid = __kmpc_global_thread_num(&loc);
+    int phase, i;
+    int seed = 1;
+    for (phase = 0; phase < PHASES; phase++) {
+      int ivals[16];
+      long long lvals[8];
+      float fvals[4];
+      double dvals[8];
+
+      if (phase % 10 == 0) {
+        #pragma omp task shared(tasks)
+        {
+          #pragma omp atomic
+          tasks++;
+        }
+      }
+
+      // Sums of 16 ints, mixing the thread values with the previous result
+      for (i = 0; i < 16; i++)
+        ivals[i] = (tid + 1) * (i + 1) + seed;
+      __kmpc_allreduce(&loc, gtid, ivals, 16, ar_int32, ar_sum);
+      for (i = 0; i < 16; i++) {
+        if (ivals[i] != n * (n + 1) / 2 * (i + 1) + n * seed) {
+          #pragma omp atomic
+          errors++;
+        }
+      }
+      seed = ivals[phase % 16] % 7;
+
+      // Min and max of long longs, with fewer values than the line holds
+      for (i = 0; i < 5; i++)
+        lvals[i] = (long long)(tid - 4) * (1LL << 40) + i;
+      __kmpc_allreduce(&loc, gtid, lvals, 5, ar_int64, ar_min);
+      for (i = 0; i < 5; i++) {
+        if (lvals[i] != -4 * (1LL << 40) + i) {
+          #pragma omp atomic
+          errors++;
+        }
+      }
+      lvals[0] = tid - 4;
+      __kmpc_allreduce(&loc, gtid, lvals, 1, ar_int64, ar_max);
+      if (lvals[0] != n - 5) {
+        #pragma omp atomic
+        errors++;
+      }
+
+      // Sums of floats and max of doubles, exact in binary
+      for (i = 0; i < 4; i++)
+        fvals[i] = 0.5f * (tid + 1) + i;
+      __kmpc_allreduce(&loc, gtid, fvals, 4, ar_float, ar_sum);
+      for (i = 0; i < 4; i++) {
+        if (fvals[i] != 0.25f * n * (n + 1) + (float)n * i) {
+          #pragma omp atomic
+          errors++;
+        }
+      }
+      for (i = 0; i < 8; i++)
+        dvals[i] = (tid == (phase + i) % n) ? 1.5 * (i + 1) : -1.0;
+      __kmpc_allreduce(&loc, gtid, dvals, 8, ar_double, ar_max);
+      for (i = 0; i < 8; i++) {
+        if (dvals[i] != 1.5 * (i + 1)) {
+          #pragma omp atomic
+          errors++;
+        }
+      }
+    }
+    #pragma omp barrier
+    if (tasks != n * (PHASES / 10)) {
+      #pragma omp atomic
+      errors++;
+    }
+  }
+
+  if (errors) {
+    fprintf(stderr, "%d threads: %d errors\n", nthreads, errors);
+    return 0;
+  }
+  return 1;
+}
+
+int test_kmp_allreduce() {
+  int n;
+  for (n = 1; n <= MAX_THREADS; n++) {
+    if (!test_team(n))
+      return 0;
+  }
+  return test_team(MAX_THREADS - 2) && test_team(MAX_THREADS);
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_kmp_allreduce()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,175 @@
+// RUN: %libomp-compile && env KMP_BARRIER_AUTOTUNE=1 KMP_FORCE_REDUCTION=tree %libomp-run
+// RUN: %libomp-compile && env KMP_BARRIER_AUTOTUNE=1 KMP_FORCE_REDUCTION=tree KMP_BLOCKTIME=0 %libomp-run
+// RUN: %libomp-compile && rm -f %t.tune && env KMP_BARRIER_AUTOTUNE=1 KMP_BARRIER_AUTOTUNE_FILE=%t.tune KMP_FORCE_REDUCTION=tree %libomp-run && env KMP_BARRIER_AUTOTUNE=1 KMP_BARRIER_AUTOTUNE_FILE=%t.tune KMP_FORCE_REDUCTION=tree %libomp-run
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Barriers of teams of all sizes from 1 to MAX_THREADS with auto-tuning of
+ * the barrier patterns: the first team of each size switches patterns while
+ * it calibrates, and the later ones use the winner.
+ * - each thread bumps a counter between barriers, and must see the bumps of
+ *   all the threads after the barrier, with tasks created before some of the
+ *   barriers completed;
+ * - a tree reduction through the reduction barrier must combine the data of
+ *   all the threads;
+ * - nested teams calibrate while the outer team runs.
+ * With KMP_BARRIER_AUTOTUNE_FILE, the first run must save the values of each
+ * team size to the file, and the next run must find them all there.
+ */
+
+#define MAX_THREADS 9
+#define PHASES 100
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  int reserved_1;
+  int flags;
+  int reserved_2;
+  int reserved_3;
+  char const *psource;
+} ident_t;
+
+typedef int kmp_critical_name[8];
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(ident_t *loc);
+extern int __kmpc_reduce(ident_t *loc, int gtid, int num_vars,
+                         size_t reduce_size, void *reduce_data,
+                         void (*reduce_func)(void *lhs, void *rhs),
+                         kmp_critical_name *lck);
+extern void __kmpc_end_reduce(ident_t *loc, int gtid, kmp_critical_name *lck);
+#ifdef __cplusplus
+}
+#endif
+
+static ident_t loc = {0, 2, 0, 0, ";unknown;unknown;0;0;;"};
+static kmp_critical_name lck;
+
+static void reduce_func(void *lhs, void *rhs) {
+  *(long *)lhs += *(long *)rhs;
+}
+
+static int test_team(int nthreads) {
+  int counter = 0, tasks = 0, errors = 0;
+  long result = 0;
+
+  #pragma omp parallel num_threads(nthreads) shared(counter, tasks, errors)
+  {
+    int n = omp_get_num_threads();
+    int gtid = __kmpc_global_thread_num(&loc);
+    int phase;
+    for (phase = 0; phase < PHASES; phase++) {
+      long data = omp_get_thread_num() + 1;
+      if (phase % 10 == 0) {
+        #pragma omp task shared(tasks)
+        {
+          #pragma omp atomic
+          tasks++;
+        }
+      }
+      #pragma omp atomic
+      counter++;
+      #pragma omp barrier
+      if (counter != n * (phase + 1) || tasks != n * (phase / 10 + 1)) {
+        #pragma omp atomic
+        errors++;
+      }
+
+      if (__kmpc_reduce(&loc, gtid, 1, sizeof(data), &data, reduce_func,
+                        &lck) == 1) {
+        if (data != (long)n * (n + 1) / 2)
+          errors++;
+        result = data;
+        __kmpc_end_reduce(&loc, gtid, &lck);
+      }
+      #pragma omp barrier
+    }
+  }
+
+  if (errors || result != (long)nthreads * (nthreads + 1) / 2) {
+    fprintf(stderr, "%d threads: %d errors, reduced %ld\n", nthreads, errors,
+            result);
+    return 0;
+  }
+  return 1;
+}
+
+static int test_nested() {
+  int errors = 0;
+
+  omp_set_max_active_levels(2);
+  #pragma omp parallel num_threads(3) shared(errors)
+  {
+    int inner = 0;
+    #pragma omp parallel num_threads(2 + omp_get_thread_num()) shared(inner)
+    {
+      int m = omp_get_num_threads();
+      int k;
+      for (k = 0; k < 10; k++) {
+        #pragma omp atomic
+        inner++;
+        #pragma omp barrier
+        if (inner != m * (k + 1)) {
+          #pragma omp atomic
+          errors++;
+        }
+        #pragma omp barrier
+      }
+    }
+  }
+  return errors == 0;
+}
+
+static int count_lines(const char *file) {
+  FILE *f = fopen(file, "r");
+  int lines = 0, c;
+  if (f == NULL)
+    return 0;
+  while ((c = fgetc(f)) != EOF) {
+    if (c == '\n')
+      lines++;
+  }
+  fclose(f);
+  return lines;
+}
+
+int test_kmp_barrier_autotune() {
+  int n;
+  for (n = 1; n <= MAX_THREADS; n++) {
+    if (!test_team(n))
+      return 0;
+  }
+  // Shrink and grow the team back
+  if (!test_team(MAX_THREADS - 2) || !test_team(MAX_THREADS))
+    return 0;
+  return test_nested();
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  const char *file = getenv("KMP_BARRIER_AUTOTUNE_FILE");
+  int saved = file ? count_lines(file) : 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_kmp_barrier_autotune()) {
+      num_failed++;
+    }
+  }
+
+  if (file) {
+    // A line per barrier type and team size calibrated
+    int lines = count_lines(file);
+    if (saved == 0 ? lines < MAX_THREADS - 1 : lines != saved) {
+      fprintf(stderr, "%s: %d lines, %d before the run\n", file, lines, saved);
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
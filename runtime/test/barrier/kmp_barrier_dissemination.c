@@ -0,0 +1,183 @@
+// RUN: %libomp-compile && env KMP_PLAIN_BARRIER_PATTERN=dissemination,dissemination KMP_REDUCTION_BARRIER_PATTERN=dissemination,dissemination KMP_FORCE_REDUCTION=tree %libomp-run
+// RUN: %libomp-compile && env KMP_PLAIN_BARRIER_PATTERN=dissemination,dissemination KMP_REDUCTION_BARRIER_PATTERN=dissemination,dissemination KMP_FORCE_REDUCTION=tree KMP_BLOCKTIME=0 %libomp-run
+// RUN: %libomp-compile && env KMP_PLAIN_BARRIER_PATTERN=dissemination,hyper KMP_FORKJOIN_BARRIER_PATTERN=dissemination,dissemination KMP_FORCE_REDUCTION=tree %libomp-run
+// RUN: %libomp-compile && env KMP_FORCE_REDUCTION=tree %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Barriers of teams of all sizes from 1 to MAX_THREADS, so that the rounds of
+ * a dissemination barrier wrap around for sizes other than powers of two:
+ * - each thread bumps a counter between barriers, and must see the bumps of
+ *   all the threads after the barrier, with tasks created before some of the
+ *   barriers completed;
+ * - a tree reduction through the reduction barrier must combine the data of
+ *   all the threads, also with nowait, where the threads overwrite their data
+ *   as soon as they leave the barrier;
+ * - barriers of a nested team run between the barriers of the outer team.
+ */
+
+#define MAX_THREADS 9
+#define PHASES 200
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  int reserved_1;
+  int flags;
+  int reserved_2;
+  int reserved_3;
+  char const *psource;
+} ident_t;
+
+typedef int kmp_critical_name[8];
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(ident_t *loc);
+extern int __kmpc_reduce(ident_t *loc, int gtid, int num_vars,
+                         size_t reduce_size, void *reduce_data,
+                         void (*reduce_func)(void *lhs, void *rhs),
+                         kmp_critical_name *lck);
+extern void __kmpc_end_reduce(ident_t *loc, int gtid, kmp_critical_name *lck);
+extern int __kmpc_reduce_nowait(ident_t *loc, int gtid, int num_vars,
+                                size_t reduce_size, void *reduce_data,
+                                void (*reduce_func)(void *lhs, void *rhs),
+                                kmp_critical_name *lck);
+extern void __kmpc_end_reduce_nowait(ident_t *loc, int gtid,
+                                     kmp_critical_name *lck);
+#ifdef __cplusplus
+}
+#endif
+
+static ident_t loc = {0, 2, 0, 0, ";unknown;unknown;0;0;;"};
+static kmp_critical_name lck;
+
+typedef struct red_data {
+  long sum;
+  long max;
+} red_data_t;
+
+static void reduce_func(void *lhs, void *rhs) {
+  red_data_t *l = (red_data_t *)lhs;
+  red_data_t *r = (red_data_t *)rhs;
+  l->sum += r->sum;
+  if (r->max > l->max)
+    l->max = r->max;
+}
+
+static int test_team(int nthreads) {
+  int counter = 0, tasks = 0, errors = 0;
+  red_data_t result = {0, 0};
+
+  #pragma omp parallel num_threads(nthreads) shared(counter, tasks, errors)
+  {
+    int n = omp_get_num_threads();
+    int tid = omp_get_thread_num();
+    int gtid = __kmpc_global_thread_num(&loc);
+    int phase;
+    for (phase = 0; phase < PHASES; phase++) {
+      red_data_t data;
+      if (phase % 10 == 0) {
+        #pragma omp task shared(tasks)
+        {
+          #pragma omp atomic
+          tasks++;
+        }
+      }
+      #pragma omp atomic
+      counter++;
+      #pragma omp barrier
+      if (counter != n * (phase + 1) ||
+          tasks != n * (phase / 10 + 1)) {
+        #pragma omp atomic
+        errors++;
+      }
+
+      data.sum = tid + 1;
+      data.max = tid + phase;
+      if (__kmpc_reduce(&loc, gtid, 1, sizeof(data), &data, reduce_func,
+                        &lck) == 1) {
+        if (data.sum != (long)n * (n + 1) / 2 || data.max != n - 1 + phase)
+          errors++;
+        result = data;
+        __kmpc_end_reduce(&loc, gtid, &lck);
+      }
+      #pragma omp barrier
+
+      data.sum = tid + 1;
+      data.max = tid + phase;
+      if (__kmpc_reduce_nowait(&loc, gtid, 1, sizeof(data), &data,
+                               reduce_func, &lck) == 1) {
+        if (data.sum != (long)n * (n + 1) / 2 || data.max != n - 1 + phase)
+          errors++;
+        __kmpc_end_reduce_nowait(&loc, gtid, &lck);
+      }
+      data.sum = data.max = -1000;
+      #pragma omp barrier
+    }
+  }
+
+  if (errors || result.sum != (long)nthreads * (nthreads + 1) / 2) {
+    fprintf(stderr, "%d threads: %d errors, reduced %ld\n", nthreads, errors,
+            result.sum);
+    return 0;
+  }
+  return 1;
+}
+
+static int test_nested() {
+  int errors = 0;
+
+  omp_set_max_active_levels(2);
+  #pragma omp parallel num_threads(3) shared(errors)
+  {
+    int phase;
+    for (phase = 0; phase < PHASES / 10; phase++) {
+      int inner = 0;
+      #pragma omp barrier
+      #pragma omp parallel num_threads(2 + phase % 3) shared(inner, errors)
+      {
+        int m = omp_get_num_threads();
+        int k;
+        for (k = 0; k < 10; k++) {
+          #pragma omp atomic
+          inner++;
+          #pragma omp barrier
+          if (inner != m * (k + 1)) {
+            #pragma omp atomic
+            errors++;
+          }
+          #pragma omp barrier
+        }
+      }
+    }
+  }
+  return errors == 0;
+}
+
+int test_kmp_barrier_dissemination() {
+  int n;
+  for (n = 1; n <= MAX_THREADS; n++) {
+    if (!test_team(n))
+      return 0;
+  }
+  // Shrink and grow the team back
+  if (!test_team(MAX_THREADS - 2) || !test_team(MAX_THREADS))
+    return 0;
+  return test_nested();
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_kmp_barrier_dissemination()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,164 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_PLAIN_BARRIER_PATTERN=linear,linear %libomp-run
+// RUN: %libomp-compile && env KMP_PLAIN_BARRIER_PATTERN=tree,tree %libomp-run
+// RUN: %libomp-compile && env KMP_PLAIN_BARRIER_PATTERN=dissemination,dissemination %libomp-run
+// RUN: %libomp-compile && env KMP_PLAIN_BARRIER_PATTERN=hierarchical,hierarchical %libomp-run
+// RUN: %libomp-compile && env KMP_PLAIN_BARRIER_PATTERN=hierarchical,hierarchical KMP_BLOCKTIME=infinite %libomp-run
+// RUN: %libomp-compile && env KMP_BLOCKTIME=0 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+#include "omp_my_sleep.h"
+
+/*
+ * Split-phase barriers in teams of all sizes from 1 to MAX_THREADS: each
+ * thread bumps the counter of the phase before it arrives, and must see the
+ * bumps of all the threads once it has waited. Tasks created before the
+ * arrival or between the arrival and the wait must all be completed after the
+ * wait. The split-phase barriers alternate between the compiler and the user
+ * entry points, and are mixed with plain barriers. Last, only a worker creates
+ * a task, late between its arrival and its wait, when the master has long
+ * collected the arrivals: the task must still be completed after the wait.
+ */
+
+#define MAX_THREADS 9
+#define PHASES 100
+#define LATE_PHASES 10
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  int reserved_1;
+  int flags;
+  int reserved_2;
+  int reserved_3;
+  char const *psource;
+} ident_t;
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(ident_t *loc);
+extern int __kmpc_barrier_arrive(ident_t *loc, int gtid);
+extern void __kmpc_barrier_wait(ident_t *loc, int gtid, int token);
+extern int kmpc_barrier_arrive(void);
+extern void kmpc_barrier_wait(int token);
+#ifdef __cplusplus
+}
+#endif
+
+static ident_t loc = {0, 2, 0, 0, ";unknown;unknown;0;0;;"};
+
+static int test_team(int nthreads) {
+  int counter[PHASES] = {0};
+  int tasks[PHASES] = {0};
+  int errors = 0;
+
+  #pragma omp parallel num_threads(nthreads) shared(counter, tasks, errors)
+  {
+    int n = omp_get_num_threads();
+    int gtid = __kmpc_global_thread_num(&loc);
+    int phase, token;
+    for (phase = 0; phase < PHASES; phase++) {
+      int *count = &counter[phase];
+      int *done = &tasks[phase];
+      #pragma omp atomic
+      (*count)++;
+      if (phase % 3 == 0) {
+        #pragma omp task firstprivate(done)
+        {
+          #pragma omp atomic
+          (*done)++;
+        }
+      }
+
+      if (phase % 2 == 0)
+        token = __kmpc_barrier_arrive(&loc, gtid);
+      else
+        token = kmpc_barrier_arrive();
+      if (phase % 3 == 1) {
+        #pragma omp task firstprivate(done)
+        {
+          #pragma omp atomic
+          (*done)++;
+        }
+      }
+      if (phase % 2 == 0)
+        __kmpc_barrier_wait(&loc, gtid, token);
+      else
+        kmpc_barrier_wait(token);
+
+      if (*count != n || *done != (phase % 3 == 2 ? 0 : n)) {
+        #pragma omp atomic
+        errors++;
+      }
+      if (phase % 7 == 0) {
+        #pragma omp barrier
+      }
+    }
+  }
+
+  if (errors) {
+    fprintf(stderr, "%d threads: %d errors\n", nthreads, errors);
+    return 0;
+  }
+  return 1;
+}
+
+static int test_late_task(int nthreads) {
+  int tasks[LATE_PHASES] = {0};
+  int errors = 0;
+
+  #pragma omp parallel num_threads(nthreads) shared(tasks, errors)
+  {
+    int n = omp_get_num_threads();
+    int phase, token;
+    for (phase = 0; phase < LATE_PHASES; phase++) {
+      int *done = &tasks[phase];
+      token = kmpc_barrier_arrive();
+      if (omp_get_thread_num() == n - 1 && n > 1) {
+        my_sleep(0.002);
+        #pragma omp task firstprivate(done)
+        {
+          my_sleep(0.001);
+          #pragma omp atomic
+          (*done)++;
+        }
+      }
+      kmpc_barrier_wait(token);
+
+      if (*done != (n > 1)) {
+        #pragma omp atomic
+        errors++;
+      }
+    }
+  }
+
+  if (errors) {
+    fprintf(stderr, "%d threads: %d late tasks not completed\n", nthreads,
+            errors);
+    return 0;
+  }
+  return 1;
+}
+
+int test_kmp_barrier_split_phase() {
+  int n;
+  for (n = 1; n <= MAX_THREADS; n++) {
+    if (!test_team(n) || !test_late_task(n))
+      return 0;
+  }
+  return test_team(MAX_THREADS - 2) && test_team(MAX_THREADS);
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_kmp_barrier_split_phase()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
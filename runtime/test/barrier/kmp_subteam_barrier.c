@@ -0,0 +1,188 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_BLOCKTIME=0 %libomp-run
+// RUN: %libomp-compile && env KMP_BLOCKTIME=infinite %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Sub-team barriers in teams of all sizes from 1 to MAX_THREADS:
+ * - the even and the odd threads of the team pass barriers of their own, a
+ *   different number of times, and each thread must see the bumps of all the
+ *   threads of its sub-team after each barrier, with tasks created before
+ *   some of them;
+ * - the barriers of the groups of threads sharing a level of the machine
+ *   hierarchy must let all the threads go through, and a level above the
+ *   hierarchy must synchronize the whole team.
+ */
+
+#define MAX_THREADS 9
+#define PHASES 100
+#define LEVELS 4
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  int reserved_1;
+  int flags;
+  int reserved_2;
+  int reserved_3;
+  char const *psource;
+} ident_t;
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(ident_t *loc);
+extern void *__kmpc_subteam_barrier_create(ident_t *loc, int gtid,
+                                           int nthreads, const int *tids);
+extern void *__kmpc_subteam_barrier_create_level(ident_t *loc, int gtid,
+                                                 int level);
+extern void __kmpc_subteam_barrier(ident_t *loc, int gtid, void *bar);
+extern void __kmpc_subteam_barrier_destroy(ident_t *loc, int gtid, void *bar);
+#ifdef __cplusplus
+}
+#endif
+
+static ident_t loc = {0, 2, 0, 0, ";unknown;unknown;0;0;;"};
+
+static int test_subsets(int nthreads) {
+  int counter[2][2 * PHASES] = {{0}};
+  void *bars[2];
+  int tasks = 0, errors = 0;
+
+  #pragma omp parallel num_threads(nthreads) shared(counter, bars, tasks, errors)
+  {
+    int n = omp_get_num_threads();
+    int tid = omp_get_thread_num();
+    int gtid = __kmpc_global_thread_num(&loc);
+    int parity = tid % 2;
+    int size = parity ? n / 2 : (n + 1) / 2;
+    // The odd threads meet twice as often
+    int phases = parity ? 2 * PHASES : PHASES;
+    int phase;
+
+    #pragma omp master
+    {
+      int tids[MAX_THREADS];
+      int i, j;
+      // The even threads in the reverse order
+      for (i = 0, j = (n - 1) & ~1; j >= 0; j -= 2)
+        tids[i++] = j;
+      bars[0] = __kmpc_subteam_barrier_create(&loc, gtid, i, tids);
+      for (i = 0, j = 1; j < n; j += 2)
+        tids[i++] = j;
+      bars[1] = i ? __kmpc_subteam_barrier_create(&loc, gtid, i, tids) : NULL;
+    }
+    #pragma omp barrier
+
+    for (phase = 0; phase < phases; phase++) {
+      if (phase % 10 == 0) {
+        #pragma omp task shared(tasks)
+        {
+          #pragma omp atomic
+          tasks++;
+        }
+      }
+      #pragma omp atomic
+      counter[parity][phase]++;
+      __kmpc_subteam_barrier(&loc, gtid, bars[parity]);
+      if (counter[parity][phase] != size) {
+        #pragma omp atomic
+        errors++;
+      }
+    }
+
+    #pragma omp barrier
+    #pragma omp master
+    {
+      __kmpc_subteam_barrier_destroy(&loc, gtid, bars[0]);
+      if (bars[1])
+        __kmpc_subteam_barrier_destroy(&loc, gtid, bars[1]);
+    }
+  }
+
+  if (errors || tasks != (nthreads + 1) / 2 * (PHASES / 10) +
+                            nthreads / 2 * (2 * PHASES / 10)) {
+    fprintf(stderr, "%d threads: %d errors, %d tasks\n", nthreads, errors,
+            tasks);
+    return 0;
+  }
+  return 1;
+}
+
+static int test_levels(int nthreads) {
+  int arrived[LEVELS + 1][MAX_THREADS] = {{0}};
+  void *bars[LEVELS + 1];
+  int errors = 0;
+
+  #pragma omp parallel num_threads(nthreads) shared(arrived, bars, errors)
+  {
+    int n = omp_get_num_threads();
+    int tid = omp_get_thread_num();
+    int gtid = __kmpc_global_thread_num(&loc);
+    int level, phase, t;
+
+    #pragma omp master
+    {
+      for (level = 0; level < LEVELS; level++)
+        bars[level] = __kmpc_subteam_barrier_create_level(&loc, gtid, level);
+      // Far above the machine hierarchy: the whole team
+      bars[LEVELS] = __kmpc_subteam_barrier_create_level(&loc, gtid, 100);
+    }
+    #pragma omp barrier
+
+    for (phase = 0; phase < PHASES; phase++) {
+      for (level = 0; level <= LEVELS; level++) {
+        #pragma omp atomic
+        arrived[level][tid]++;
+        __kmpc_subteam_barrier(&loc, gtid, bars[level]);
+        if (level < LEVELS)
+          continue;
+        for (t = 0; t < n; t++) {
+          int a;
+          #pragma omp atomic read
+          a = arrived[level][t];
+          if (a < phase + 1) {
+            #pragma omp atomic
+            errors++;
+          }
+        }
+      }
+    }
+
+    #pragma omp barrier
+    #pragma omp master
+    {
+      for (level = 0; level <= LEVELS; level++)
+        __kmpc_subteam_barrier_destroy(&loc, gtid, bars[level]);
+    }
+  }
+
+  if (errors) {
+    fprintf(stderr, "%d threads: %d errors with levels\n", nthreads, errors);
+    return 0;
+  }
+  return 1;
+}
+
+int test_kmp_subteam_barrier() {
+  int n;
+  for (n = 1; n <= MAX_THREADS; n++) {
+    if (!test_subsets(n) || !test_levels(n))
+      return 0;
+  }
+  return test_subsets(MAX_THREADS - 2) && test_levels(MAX_THREADS);
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_kmp_subteam_barrier()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
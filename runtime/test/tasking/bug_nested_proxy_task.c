@@ -1,4 +1,5 @@
 // RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_COMPLETION_QUEUE=1 %libomp-run
 // The runtime currently does not get dependency information from GCC.
 // UNSUPPORTED: gcc
 
@@ -1,4 +1,5 @@
 // RUN: %libomp-compile && env OMP_NUM_THREADS='3' %libomp-run
+// RUN: %libomp-compile && env OMP_NUM_THREADS='3' KMP_TASK_COMPLETION_QUEUE=1 %libomp-run
 // RUN: %libomp-compile && env OMP_NUM_THREADS='1' %libomp-run
 
 #include <stdio.h>
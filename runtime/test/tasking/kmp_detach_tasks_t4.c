@@ -0,0 +1,148 @@
+// RUN: %libomp-compile && env OMP_NUM_THREADS='4' %libomp-run
+// RUN: %libomp-compile && env OMP_NUM_THREADS='4' KMP_TASK_COMPLETION_QUEUE=1 %libomp-run
+// RUN: %libomp-compile && env OMP_NUM_THREADS='1' %libomp-run
+
+#include <stdio.h>
+#include <sched.h>
+#include <pthread.h>
+#include <omp.h>
+
+// Many detached tasks fulfilled by a thread that is not part of the team, as
+// an I/O completion thread would do. Each detached task has a successor which
+// is only released by the bottom half of its completion, and must see the
+// event fulfilled.
+
+#define PTASK_FLAG_DETACHABLE 0x40
+#define NUM_TASKS 10000
+#define NUM_DEPS 64
+
+// OpenMP RTL interfaces
+typedef struct ID {
+  int reserved_1;
+  int flags;
+  int reserved_2;
+  int reserved_3;
+  char *psource;
+} id;
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  void* dummy; // not used in the library
+} ident_t;
+
+typedef struct shar { // shareds used in the task
+} *pshareds;
+
+typedef struct task {
+  pshareds shareds;
+  int(*routine)(int,struct task*);
+  int part_id;
+// privates used in the task:
+  omp_event_handle_t evt;
+  int index;
+} *ptask, kmp_task_t;
+
+typedef struct DEP {
+  size_t addr;
+  size_t len;
+  int flags;
+} dep;
+
+typedef int(* task_entry_t)( int, ptask );
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int  __kmpc_global_thread_num(void *id_ref);
+extern int** __kmpc_omp_task_alloc(id *loc, int gtid, int flags,
+                                   size_t sz, size_t shar, task_entry_t rtn);
+extern int __kmpc_omp_task_with_deps(id *loc, int gtid, ptask task, int nd,
+               dep *dep_lst, int nd_noalias, dep *noalias_dep_lst);
+extern omp_event_handle_t __kmpc_task_allow_completion_event(
+                              ident_t *loc_ref, int gtid, kmp_task_t *task);
+#ifdef __cplusplus
+}
+#endif
+
+static omp_event_handle_t events[NUM_TASKS];
+static int ready[NUM_TASKS];
+static int fulfilled[NUM_TASKS];
+static int deps[NUM_DEPS];
+static int completed, errors;
+
+// User's code, outlined into task entries
+int detached_entry(int gtid, ptask task) {
+  events[task->index] = task->evt;
+  __atomic_store_n(&ready[task->index], 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+int successor_entry(int gtid, ptask task) {
+  if (!fulfilled[task->index]) {
+    #pragma omp atomic
+    errors++;
+  }
+  #pragma omp atomic
+  completed++;
+  return 0;
+}
+
+// The completion thread fulfills the events as the detached tasks run
+static void *completion_thread(void *arg) {
+  int i;
+  for (i = 0; i < NUM_TASKS; i++) {
+    while (!__atomic_load_n(&ready[i], __ATOMIC_ACQUIRE))
+      sched_yield();
+    fulfilled[i] = 1;
+    omp_fulfill_event(events[i]);
+  }
+  return NULL;
+}
+
+int main() {
+  pthread_t thread;
+  double time;
+  omp_set_dynamic(0);
+  pthread_create(&thread, NULL, &completion_thread, NULL);
+
+  time = omp_get_wtime();
+  #pragma omp parallel
+  #pragma omp master
+  {
+    int i, gtid = __kmpc_global_thread_num(NULL);
+    for (i = 0; i < NUM_TASKS; i++) {
+      ptask task;
+      dep sdep;
+      sdep.addr = (size_t)&deps[i % NUM_DEPS];
+      sdep.len = 0L;
+
+      task = (ptask)__kmpc_omp_task_alloc(NULL, gtid, PTASK_FLAG_DETACHABLE,
+                                          sizeof(struct task),
+                                          sizeof(struct shar), &detached_entry);
+      task->evt = (omp_event_handle_t)__kmpc_task_allow_completion_event(
+          NULL, gtid, task);
+      task->index = i;
+      sdep.flags = 3; // inout
+      __kmpc_omp_task_with_deps(NULL, gtid, task, 1, &sdep, 0, 0);
+
+      task = (ptask)__kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                          sizeof(struct shar),
+                                          &successor_entry);
+      task->index = i;
+      sdep.flags = 1; // in
+      __kmpc_omp_task_with_deps(NULL, gtid, task, 1, &sdep, 0, 0);
+    }
+    #pragma omp taskwait
+  }
+  time = omp_get_wtime() - time;
+  pthread_join(thread, NULL);
+
+  if (completed != NUM_TASKS || errors) {
+    printf("failed: %d successors completed, %d before the event was "
+           "fulfilled\n", completed, errors);
+    return 1;
+  }
+  printf("passed: %d detached tasks fulfilled outside the team in %f s\n",
+         NUM_TASKS, time);
+  return 0;
+}
@@ -0,0 +1,119 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_NUMA_LOCAL=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_NUMA_LOCAL=1 KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env OMP_NUM_THREADS=1 %libomp-run
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+// Test that tasks registered with affinity information (OpenMP 5.0 affinity
+// clause) are all executed, whichever thread the runtime places them on.
+
+#define NPARTS 64
+#define PART_SIZE (1 << 16)
+
+// OpenMP RTL interfaces
+typedef struct ID {
+  int reserved_1;
+  int flags;
+  int reserved_2;
+  int reserved_3;
+  char *psource;
+} id;
+
+typedef struct kmp_task_affinity_info {
+  long long base_addr;
+  size_t len;
+  struct {
+    unsigned flag1 : 1;
+    unsigned flag2 : 1;
+    unsigned reserved : 30;
+  } flags;
+} kmp_task_affinity_info_t;
+
+typedef struct shar { // shareds used in the task
+  long *sums;
+} *pshareds;
+
+typedef struct task {
+  pshareds shareds;
+  int (*routine)(int, struct task *);
+  int part_id;
+  // privates used in the task:
+  int part;
+} *ptask, kmp_task_t;
+
+typedef int (*task_entry_t)(int, ptask);
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(void *id_ref);
+extern ptask __kmpc_omp_task_alloc(id *loc, int gtid, int flags, size_t sz,
+                                   size_t shar, task_entry_t rtn);
+extern int __kmpc_omp_reg_task_with_affinity(id *loc, int gtid, ptask task,
+                                             int naffins,
+                                             kmp_task_affinity_info_t *list);
+extern int __kmpc_omp_task(id *loc, int gtid, ptask task);
+#ifdef __cplusplus
+}
+#endif
+
+int *data[NPARTS];
+
+// User's code, outlined into task entry
+int task_entry(int gtid, ptask task) {
+  int i, part = task->part;
+  long sum = 0;
+  for (i = 0; i < PART_SIZE; ++i)
+    sum += data[part][i];
+  task->shareds->sums[part] = sum;
+  return 0;
+}
+
+int main() {
+  int i, j, errs = 0;
+  long sums[NPARTS];
+
+  // Each partition is first touched by the thread that will own it, so
+  // partitions may be spread over the NUMA nodes.
+  #pragma omp parallel for schedule(static) private(j)
+  for (i = 0; i < NPARTS; ++i) {
+    data[i] = (int *)malloc(PART_SIZE * sizeof(int));
+    for (j = 0; j < PART_SIZE; ++j)
+      data[i][j] = i;
+  }
+
+  #pragma omp parallel
+  #pragma omp master
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    for (i = 0; i < NPARTS; ++i) {
+      kmp_task_affinity_info_t affinity;
+      ptask task = __kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                         sizeof(struct shar), &task_entry);
+      task->shareds->sums = sums;
+      task->part = i;
+      affinity.base_addr = (long long)data[i];
+      affinity.len = PART_SIZE * sizeof(int);
+      affinity.flags.flag1 = 0;
+      affinity.flags.flag2 = 0;
+      affinity.flags.reserved = 0;
+      __kmpc_omp_reg_task_with_affinity(NULL, gtid, task, 1, &affinity);
+      __kmpc_omp_task(NULL, gtid, task);
+    }
+  }
+
+  for (i = 0; i < NPARTS; ++i) {
+    if (sums[i] != (long)i * PART_SIZE) {
+      printf("partition %d: sum %ld, expected %ld\n", i, sums[i],
+             (long)i * PART_SIZE);
+      errs++;
+    }
+    free(data[i]);
+  }
+  if (errs == 0)
+    printf("passed\n");
+  return errs;
+}
@@ -0,0 +1,149 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_BYPASS=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_CRITICAL_PATH=4 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+
+/*
+ * Dependence graph with high fan-out and fan-in: in each round, a writer of
+ * the shared item is followed by many readers, each also writing its own
+ * item, and a join task depends on all of them. Successors are linked to
+ * tasks that may be completing concurrently on other threads. Each reader
+ * must see the value of its round's writer, and each join must see all the
+ * readers of its round completed.
+ */
+
+#define ROUNDS 200
+#define WIDTH 64
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  void *dummy;
+} ident_t;
+
+typedef struct shar {
+} *pshareds;
+
+typedef struct task {
+  pshareds shareds;
+  int (*routine)(int, struct task *);
+  int part_id;
+  // privates used in the task:
+  int round;
+  int index;
+} *ptask, kmp_task_t;
+
+typedef struct DEP {
+  size_t addr;
+  size_t len;
+  unsigned char flags;
+} dep;
+
+typedef int (*task_entry_t)(int, ptask);
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(void *id_ref);
+extern ptask __kmpc_omp_task_alloc(ident_t *loc, int gtid, int flags,
+                                   size_t sz, size_t shar, task_entry_t rtn);
+extern int __kmpc_omp_task_with_deps(ident_t *loc, int gtid, ptask task,
+                                     int nd, dep *dep_lst, int nd_noalias,
+                                     dep *noalias_dep_lst);
+#ifdef __cplusplus
+}
+#endif
+
+static int shared_item;
+static int items[WIDTH];
+static int done[WIDTH];
+static int errors;
+
+// User's code, outlined into task entries
+int writer_entry(int gtid, ptask task) {
+  shared_item = task->round;
+  return 0;
+}
+
+int reader_entry(int gtid, ptask task) {
+  if (shared_item != task->round) {
+    #pragma omp atomic
+    errors++;
+  }
+  items[task->index] = task->round;
+  __atomic_store_n(&done[task->index], task->round + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+int join_entry(int gtid, ptask task) {
+  int i;
+  for (i = 0; i < WIDTH; i++) {
+    if (__atomic_load_n(&done[i], __ATOMIC_ACQUIRE) != task->round + 1 ||
+        items[i] != task->round) {
+      #pragma omp atomic
+      errors++;
+    }
+  }
+  return 0;
+}
+
+int main() {
+  double time;
+  errors = 0;
+
+  time = omp_get_wtime();
+  #pragma omp parallel
+  #pragma omp master
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    dep deps[WIDTH + 1];
+    int r, i;
+    for (r = 0; r < ROUNDS; r++) {
+      ptask task;
+      // writer: out on the shared item, after the previous join
+      deps[0].addr = (size_t)&shared_item;
+      deps[0].len = sizeof(int);
+      deps[0].flags = 3; // inout
+      task = __kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                   sizeof(struct shar), &writer_entry);
+      task->round = r;
+      __kmpc_omp_task_with_deps(NULL, gtid, task, 1, deps, 0, NULL);
+
+      // readers: fan-out of the writer
+      for (i = 0; i < WIDTH; i++) {
+        deps[0].flags = 1; // in
+        deps[1].addr = (size_t)&items[i];
+        deps[1].len = sizeof(int);
+        deps[1].flags = 3; // inout
+        task = __kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                     sizeof(struct shar), &reader_entry);
+        task->round = r;
+        task->index = i;
+        __kmpc_omp_task_with_deps(NULL, gtid, task, 2, deps, 0, NULL);
+      }
+
+      // join: fan-in of the readers, the next writer waits for it
+      deps[0].flags = 3; // inout
+      for (i = 0; i < WIDTH; i++) {
+        deps[i + 1].addr = (size_t)&items[i];
+        deps[i + 1].len = sizeof(int);
+        deps[i + 1].flags = 1; // in
+      }
+      task = __kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                   sizeof(struct shar), &join_entry);
+      task->round = r;
+      __kmpc_omp_task_with_deps(NULL, gtid, task, WIDTH + 1, deps, 0, NULL);
+    }
+    #pragma omp taskwait
+  }
+  time = omp_get_wtime() - time;
+
+  if (errors) {
+    printf("failed: %d tasks ran before their predecessors\n", errors);
+    return 1;
+  }
+  printf("passed: %d rounds of fan-out/fan-in over %d tasks in %f s\n",
+         ROUNDS, WIDTH, time);
+  return 0;
+}
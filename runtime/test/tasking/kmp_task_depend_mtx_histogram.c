@@ -0,0 +1,152 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_BYPASS=1 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+
+/*
+ * Histogram updates as commutative tasks: each task updates two bins, with a
+ * mutexinoutset dependence on each of them, while many tasks share a bin.
+ * Tasks updating the same bin must never run at the same time, and after
+ * each round a task reading all the bins must see every update of the round.
+ */
+
+#define NUM_BINS 8
+#define NUM_TASKS 400
+#define ROUNDS 4
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  void *dummy;
+} ident_t;
+
+typedef struct shar {
+} *pshareds;
+
+typedef struct task {
+  pshareds shareds;
+  int (*routine)(int, struct task *);
+  int part_id;
+  // privates used in the task:
+  int bin[2];
+  int round;
+} *ptask, kmp_task_t;
+
+typedef struct DEP {
+  size_t addr;
+  size_t len;
+  unsigned char flags;
+} dep;
+
+#define DEP_IN 1
+#define DEP_MTX 4
+
+typedef int (*task_entry_t)(int, ptask);
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(void *id_ref);
+extern ptask __kmpc_omp_task_alloc(ident_t *loc, int gtid, int flags,
+                                   size_t sz, size_t shar, task_entry_t rtn);
+extern int __kmpc_omp_task_with_deps(ident_t *loc, int gtid, ptask task,
+                                     int nd, dep *dep_lst, int nd_noalias,
+                                     dep *noalias_dep_lst);
+#ifdef __cplusplus
+}
+#endif
+
+static int bins[NUM_BINS];
+static int busy[NUM_BINS];
+static int expected[NUM_BINS];
+static int errors;
+
+// User's code, outlined into task entries
+int update_entry(int gtid, ptask task) {
+  int i, k;
+  for (i = 0; i < 2; i++) {
+    if (__atomic_exchange_n(&busy[task->bin[i]], 1, __ATOMIC_ACQ_REL)) {
+      #pragma omp atomic
+      errors++;
+    }
+  }
+  for (i = 0; i < 2; i++) {
+    volatile int x = bins[task->bin[i]];
+    for (k = 0; k < 100; k++)
+      x += 0; // widen the window for a concurrent update
+    bins[task->bin[i]] = x + 1;
+  }
+  for (i = 0; i < 2; i++)
+    __atomic_store_n(&busy[task->bin[i]], 0, __ATOMIC_RELEASE);
+  return 0;
+}
+
+int check_entry(int gtid, ptask task) {
+  int i, total = 0;
+  for (i = 0; i < NUM_BINS; i++)
+    total += bins[i];
+  if (total != 2 * NUM_TASKS * (task->round + 1)) {
+    printf("round %d: %d updates, expected %d\n", task->round, total,
+           2 * NUM_TASKS * (task->round + 1));
+    #pragma omp atomic
+    errors++;
+  }
+  return 0;
+}
+
+int main() {
+  int i;
+  errors = 0;
+
+  #pragma omp parallel
+  #pragma omp master
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    dep deps[NUM_BINS];
+    int r;
+    for (r = 0; r < ROUNDS; r++) {
+      ptask task;
+      for (i = 0; i < NUM_TASKS; i++) {
+        task = __kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                     sizeof(struct shar), &update_entry);
+        task->bin[0] = i % NUM_BINS;
+        task->bin[1] =
+            (task->bin[0] + 1 + (i / NUM_BINS) % (NUM_BINS - 1)) % NUM_BINS;
+        expected[task->bin[0]]++;
+        expected[task->bin[1]]++;
+        task->round = r;
+        deps[0].addr = (size_t)&bins[task->bin[0]];
+        deps[0].len = sizeof(int);
+        deps[0].flags = DEP_MTX;
+        deps[1].addr = (size_t)&bins[task->bin[1]];
+        deps[1].len = sizeof(int);
+        deps[1].flags = DEP_MTX;
+        __kmpc_omp_task_with_deps(NULL, gtid, task, 2, deps, 0, NULL);
+      }
+      for (i = 0; i < NUM_BINS; i++) {
+        deps[i].addr = (size_t)&bins[i];
+        deps[i].len = sizeof(int);
+        deps[i].flags = DEP_IN;
+      }
+      task = __kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                   sizeof(struct shar), &check_entry);
+      task->round = r;
+      __kmpc_omp_task_with_deps(NULL, gtid, task, NUM_BINS, deps, 0, NULL);
+    }
+    #pragma omp taskwait
+  }
+
+  for (i = 0; i < NUM_BINS; i++) {
+    if (bins[i] != expected[i]) {
+      printf("bin %d: %d updates, expected %d\n", i, bins[i], expected[i]);
+      errors++;
+    }
+  }
+  if (errors) {
+    printf("failed: %d errors\n", errors);
+    return 1;
+  }
+  printf("passed\n");
+  return 0;
+}
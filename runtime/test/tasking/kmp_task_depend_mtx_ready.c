@@ -0,0 +1,153 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_BYPASS=1 %libomp-run
+// RUN: %libomp-compile && env KMP_ENABLE_TASK_THROTTLING=0 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_my_sleep.h"
+
+/*
+ * Sibling tasks with a mutexinoutset dependence on one of a few items, all
+ * made ready at once by a gate task they depend on, so that they are all
+ * queued together and several threads take conflicting ones at the same time.
+ * There are more of them than a deque holds, so that some run right away when
+ * they are released. Tasks updating the same item must never run at the same
+ * time, and each task must run exactly once.
+ */
+
+#define NUM_ITEMS 3
+#define NUM_TASKS 300
+#define ROUNDS 20
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  void *dummy;
+} ident_t;
+
+typedef struct shar {
+} *pshareds;
+
+typedef struct task {
+  pshareds shareds;
+  int (*routine)(int, struct task *);
+  int part_id;
+  // privates used in the task:
+  int item;
+  int id;
+} *ptask, kmp_task_t;
+
+typedef struct DEP {
+  size_t addr;
+  size_t len;
+  unsigned char flags;
+} dep;
+
+#define DEP_IN 1
+#define DEP_OUT 2
+#define DEP_MTX 4
+
+typedef int (*task_entry_t)(int, ptask);
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(void *id_ref);
+extern ptask __kmpc_omp_task_alloc(ident_t *loc, int gtid, int flags,
+                                   size_t sz, size_t shar, task_entry_t rtn);
+extern int __kmpc_omp_task_with_deps(ident_t *loc, int gtid, ptask task,
+                                     int nd, dep *dep_lst, int nd_noalias,
+                                     dep *noalias_dep_lst);
+extern int __kmpc_omp_taskwait(ident_t *loc, int gtid);
+#ifdef __cplusplus
+}
+#endif
+
+static int gate;
+static int created;
+static int items[NUM_ITEMS];
+static int busy[NUM_ITEMS];
+static int runs[NUM_TASKS];
+static int errors;
+
+// User's code, outlined into task entries
+int gate_entry(int gtid, ptask task) {
+  // keep the siblings waiting until all of them are created, unless the
+  // team is serialized and this task runs when it is created
+  while (omp_get_num_threads() > 1 &&
+         !__atomic_load_n(&created, __ATOMIC_ACQUIRE))
+    ;
+  return 0;
+}
+
+int update_entry(int gtid, ptask task) {
+  if (__atomic_exchange_n(&busy[task->item], 1, __ATOMIC_ACQ_REL)) {
+    #pragma omp atomic
+    errors++;
+  }
+  int x = items[task->item];
+  my_sleep(0.00001); // widen the window for a concurrent update
+  items[task->item] = x + 1;
+  __atomic_store_n(&busy[task->item], 0, __ATOMIC_RELEASE);
+  #pragma omp atomic
+  runs[task->id]++;
+  return 0;
+}
+
+int main() {
+  int i, r;
+  errors = 0;
+
+  #pragma omp parallel
+  #pragma omp master
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    dep deps[2];
+    ptask task;
+    for (r = 0; r < ROUNDS; r++) {
+      __atomic_store_n(&created, 0, __ATOMIC_RELAXED);
+      deps[0].addr = (size_t)&gate;
+      deps[0].len = sizeof(int);
+      deps[0].flags = DEP_OUT;
+      task = __kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                   sizeof(struct shar), &gate_entry);
+      __kmpc_omp_task_with_deps(NULL, gtid, task, 1, deps, 0, NULL);
+
+      for (i = 0; i < NUM_TASKS; i++) {
+        task = __kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                     sizeof(struct shar), &update_entry);
+        task->item = i % NUM_ITEMS;
+        task->id = i;
+        deps[0].flags = DEP_IN;
+        deps[1].addr = (size_t)&items[task->item];
+        deps[1].len = sizeof(int);
+        deps[1].flags = DEP_MTX;
+        __kmpc_omp_task_with_deps(NULL, gtid, task, 2, deps, 0, NULL);
+      }
+      __atomic_store_n(&created, 1, __ATOMIC_RELEASE);
+      __kmpc_omp_taskwait(NULL, gtid);
+
+      for (i = 0; i < NUM_TASKS; i++) {
+        if (runs[i] != r + 1) {
+          printf("round %d: task %d ran %d times\n", r, i, runs[i] - r);
+          errors++;
+          runs[i] = r + 1;
+        }
+      }
+    }
+  }
+
+  for (i = 0; i < NUM_ITEMS; i++) {
+    if (items[i] != ROUNDS * NUM_TASKS / NUM_ITEMS) {
+      printf("item %d: %d updates, expected %d\n", i, items[i],
+             ROUNDS * NUM_TASKS / NUM_ITEMS);
+      errors++;
+    }
+  }
+  if (errors) {
+    printf("failed: %d errors\n", errors);
+    return 1;
+  }
+  printf("passed\n");
+  return 0;
+}
@@ -0,0 +1,73 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_ENABLE_TASK_THROTTLING=0 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_ADAPTIVE=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_ADAPTIVE=1 KMP_ENABLE_TASK_THROTTLING=0 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_ADAPTIVE=1 KMP_ENABLE_TASK_THROTTLING=0 KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_ADAPTIVE=1 KMP_ENABLE_TASK_THROTTLING=0 KMP_TASK_STEAL_BATCH=32 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Test a producer queuing many more tasks than its deque holds, while one of
+ * the tasks keeps a thread busy until all of them are created. With
+ * KMP_TASK_DEQUE_ADAPTIVE and without throttling, the tasks beyond the limit
+ * of the deque go to its spill stack, from which both the producer and the
+ * thieves must take them. Rounds with many tasks alternate with small ones, so
+ * that the deques are shrunk back at the barriers. Each task must be executed
+ * exactly once.
+ */
+
+#define MAX_TASKS 20000
+
+static int counts[MAX_TASKS];
+
+int test_kmp_task_deque_spill(int num_tasks) {
+  int i, created = 0, errors = 0;
+
+  for (i = 0; i < num_tasks; i++)
+    counts[i] = 0;
+
+  #pragma omp parallel private(i)
+  #pragma omp single
+  {
+    #pragma omp task shared(created)
+    {
+      int done;
+      do {
+        #pragma omp atomic read
+        done = created;
+      } while (!done);
+    }
+    for (i = 0; i < num_tasks; i++) {
+      #pragma omp task firstprivate(i)
+      {
+        #pragma omp atomic
+        counts[i]++;
+      }
+    }
+    #pragma omp atomic write
+    created = 1;
+  }
+
+  for (i = 0; i < num_tasks; i++) {
+    if (counts[i] != 1) {
+      if (errors++ < 10)
+        fprintf(stderr, "task %d of %d executed %d times\n", i, num_tasks,
+                counts[i]);
+    }
+  }
+  return errors == 0;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_kmp_task_deque_spill(i % 2 ? 100 : MAX_TASKS)) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
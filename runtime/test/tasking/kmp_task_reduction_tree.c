@@ -0,0 +1,155 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_REDUCTION_COMBINE_SIZE=32768 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_REDUCTION_LAZY=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_REDUCTION_LAZY=1 KMP_TASK_REDUCTION_COMBINE_SIZE=32768 %libomp-run
+// RUN: %libomp-compile && env OMP_NUM_THREADS=1 KMP_TASK_REDUCTION_LAZY=1 KMP_TASK_REDUCTION_COMBINE_SIZE=32768 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Test a task reduction over an array big enough to have the private copies
+ * combined pairwise by tasks at the end of the taskgroup, next to a scalar
+ * combined by the thread ending the taskgroup. Each private copy must be
+ * initialized and finalized exactly once, and all the contributions of the
+ * tasks must reach the original items.
+ */
+
+#define N 16384
+#define NUM_TASKS 500
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern void *__kmpc_task_reduction_get_th_data(int gtid, void *tg, void *item);
+extern void *__kmpc_taskred_init(int gtid, int num, void *data);
+extern int __kmpc_global_thread_num(void *);
+#ifdef __cplusplus
+}
+#endif
+
+// Compiler-generated code (emulation)
+typedef struct red_input {
+  void *reduce_shar; // shared between tasks item to reduce into
+  void *reduce_orig; // original reduction item used for initialization
+  size_t reduce_size; // size of data item in bytes
+  void *reduce_init; // data initialization routine (two parameters)
+  void *reduce_fini; // data finalization routine
+  void *reduce_comb; // data combiner routine
+  unsigned flags; // flags for additional info from compiler
+} red_input_t;
+
+static long long arr[N];
+static long long sum;
+static int inits, finis;
+
+void arr_init(void *priv, void *orig) {
+  long long *p = (long long *)priv;
+  int i;
+  for (i = 0; i < N; i++)
+    p[i] = 0;
+  #pragma omp atomic
+  inits++;
+}
+
+void arr_fini(void *priv) {
+  #pragma omp atomic
+  finis++;
+}
+
+void arr_comb(void *lhs, void *rhs) {
+  long long *l = (long long *)lhs;
+  long long *r = (long long *)rhs;
+  int i;
+  for (i = 0; i < N; i++)
+    l[i] += r[i];
+}
+
+void sum_comb(void *lhs, void *rhs) { *(long long *)lhs += *(long long *)rhs; }
+
+int test_kmp_task_reduction_tree() {
+  int i, errors = 0;
+
+  for (i = 0; i < N; i++)
+    arr[i] = i;
+  sum = 0;
+  inits = finis = 0;
+
+  #pragma omp parallel
+  #pragma omp single
+  {
+    #pragma omp taskgroup // task_reduction(+:arr,sum)
+    {
+      red_input_t red_data[2];
+      int gtid = __kmpc_global_thread_num(NULL);
+      void *tg;
+      red_data[0].reduce_shar = arr;
+      red_data[0].reduce_orig = arr;
+      red_data[0].reduce_size = sizeof(arr);
+      red_data[0].reduce_init = (void *)&arr_init;
+      red_data[0].reduce_fini = (void *)&arr_fini;
+      red_data[0].reduce_comb = (void *)&arr_comb;
+      red_data[0].flags = 0;
+      red_data[1].reduce_shar = &sum;
+      red_data[1].reduce_orig = &sum;
+      red_data[1].reduce_size = sizeof(sum);
+      red_data[1].reduce_init = NULL; // RTL will zero thread-specific objects
+      red_data[1].reduce_fini = NULL;
+      red_data[1].reduce_comb = (void *)&sum_comb;
+      red_data[1].flags = 0;
+      tg = __kmpc_taskred_init(gtid, 2, red_data);
+
+      for (i = 0; i < NUM_TASKS; i++) {
+        #pragma omp task firstprivate(i) // in_reduction(+:arr,sum)
+        {
+          int gtid = __kmpc_global_thread_num(NULL);
+          long long *p_arr =
+              (long long *)__kmpc_task_reduction_get_th_data(gtid, tg, arr);
+          long long *p_sum =
+              (long long *)__kmpc_task_reduction_get_th_data(gtid, tg, &sum);
+          int k;
+          for (k = 0; k < N; k += 64)
+            p_arr[(k + i) % N] += i;
+          *p_sum += i;
+        }
+      }
+    }
+  }
+
+  for (i = 0; i < N; i++) {
+    // element i got the index of each task t with t % 64 == i % 64
+    long long expected = i;
+    int t;
+    for (t = i % 64; t < NUM_TASKS; t += 64)
+      expected += t;
+    if (arr[i] != expected) {
+      if (errors++ < 10)
+        fprintf(stderr, "arr[%d] = %lld, expected %lld\n", i, arr[i],
+                expected);
+    }
+  }
+  if (sum != (long long)NUM_TASKS * (NUM_TASKS - 1) / 2) {
+    fprintf(stderr, "sum = %lld, expected %d\n", sum,
+            NUM_TASKS * (NUM_TASKS - 1) / 2);
+    errors++;
+  }
+  if (inits != finis || inits > omp_get_max_threads()) {
+    fprintf(stderr, "%d private copies initialized, %d finalized\n", inits,
+            finis);
+    errors++;
+  }
+  return errors == 0;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_kmp_task_reduction_tree()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
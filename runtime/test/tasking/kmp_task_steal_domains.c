@@ -0,0 +1,82 @@
+// RUN: %libomp-compile && env KMP_AFFINITY=compact KMP_TOPOLOGY_METHOD=cpuinfo KMP_CPUINFO_FILE=%t.cpuinfo KMP_TASK_STEAL_POLICY=hierarchical KMP_TASK_STEAL_RETRIES=8,0,0 %libomp-run
+// REQUIRES: linux, affinity
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Test the steal domains of the hierarchical steal policy on a machine of two
+ * packages of cores without hyper-threading, described by a cpuinfo file the
+ * test writes before the runtime reads it: a core has no SMT sibling, so with
+ * steals allowed among SMT siblings only, no thread may steal the tasks
+ * created by the master.
+ */
+
+#define NUM_TASKS 200
+
+int test_kmp_task_steal_domains() {
+  int stolen = 0, executed = 0;
+
+  #pragma omp parallel num_threads(4) shared(stolen, executed)
+  #pragma omp master
+  {
+    int i;
+    for (i = 0; i < NUM_TASKS; i++) {
+      #pragma omp task shared(stolen, executed)
+      {
+        int k;
+        volatile int sink = 0;
+        for (k = 0; k < 10000; k++)
+          sink += k;
+        if (omp_get_thread_num() != 0) {
+          #pragma omp atomic
+          stolen++;
+        }
+        #pragma omp atomic
+        executed++;
+      }
+    }
+  }
+
+  if (stolen || executed != NUM_TASKS) {
+    fprintf(stderr, "%d of %d tasks executed, %d stolen\n", executed,
+            NUM_TASKS, stolen);
+    return 0;
+  }
+  return 1;
+}
+
+// Two packages sharing the online processors, one thread per core
+static int write_cpuinfo(const char *name) {
+  long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+  long ncores = (nprocs + 1) / 2;
+  long p;
+  FILE *f = fopen(name, "w");
+  if (f == NULL)
+    return 0;
+  for (p = 0; p < nprocs; p++)
+    fprintf(f, "processor\t: %ld\nphysical id\t: %ld\ncore id\t\t: %ld\n\n",
+            p, p / ncores, p % ncores);
+  fclose(f);
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  const char *cpuinfo = getenv("KMP_CPUINFO_FILE");
+
+  if (cpuinfo == NULL || !write_cpuinfo(cpuinfo)) {
+    fprintf(stderr, "cannot write the cpuinfo file\n");
+    return 1;
+  }
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_kmp_task_steal_domains()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
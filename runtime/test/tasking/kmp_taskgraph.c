@@ -0,0 +1,174 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env OMP_NUM_THREADS=1 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Test the task graph regions: a 1-D stencil over blocks creates the same
+ * dependence graph at every step, which is recorded at the first step and
+ * replayed afterwards. Each task checks and bumps the version of its block
+ * after checking the versions of the neighbouring blocks. One step creates a
+ * smaller graph, which makes the replay fall back to the tracking of the
+ * dependences, and the graph is recorded again at the next step. Likewise,
+ * in another region, one step creates as many tasks with as many depend items
+ * as the recording, on other addresses, which must not be replayed either.
+ */
+
+#define NB 64
+#define STEPS 12
+#define SHORT_STEP 5
+#define CHAIN_STEP 3
+
+// OpenMP RTL interfaces
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int __kmpc_global_thread_num(void *id_ref);
+extern int __kmpc_taskgraph_begin(void *loc, int gtid, int graph_id);
+extern void __kmpc_taskgraph_end(void *loc, int gtid);
+#ifdef __cplusplus
+}
+#endif
+
+static int version[NB];
+static int errors;
+
+// version of block b at the given step once the given number of sweeps of the
+// step are done, the short step does not update the second half of the blocks
+static int expected_version(int b, int step, int sweeps) {
+  int v = 2 * step - (step > SHORT_STEP && b >= NB / 2 ? 2 : 0);
+  return step == SHORT_STEP && b >= NB / 2 ? v : v + sweeps;
+}
+
+static void check(int b, int step, int sweeps) {
+  if (b >= 0 && b < NB && version[b] != expected_version(b, step, sweeps)) {
+    #pragma omp atomic
+    errors++;
+  }
+}
+
+int test_kmp_taskgraph(int graph_id) {
+  int b, step, sweep;
+  int replayed[STEPS];
+
+  for (b = 0; b < NB; b++)
+    version[b] = 0;
+  errors = 0;
+
+  #pragma omp parallel private(b, step, sweep)
+  #pragma omp single
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    for (step = 0; step < STEPS; step++) {
+      int nb = step == SHORT_STEP ? NB / 2 : NB;
+      replayed[step] = __kmpc_taskgraph_begin(NULL, gtid, graph_id);
+      // the blocks are updated twice per step, a task runs after the update
+      // of its left neighbour and before the update of its right neighbour
+      for (sweep = 0; sweep < 2; sweep++) {
+        for (b = 0; b < nb; b++) {
+          #pragma omp task firstprivate(b, step, sweep)                       \
+                           depend(inout: version[b])                          \
+                           depend(in: version[b > 0 ? b - 1 : b])             \
+                           depend(in: version[b < NB - 1 ? b + 1 : b])
+          {
+            check(b - 1, step, sweep + 1);
+            check(b, step, sweep);
+            check(b + 1, step, sweep);
+            version[b]++;
+          }
+        }
+      }
+      __kmpc_taskgraph_end(NULL, gtid);
+    }
+  }
+
+  if (errors) {
+    fprintf(stderr, "%d tasks ran out of dependence order\n", errors);
+    return 0;
+  }
+  for (b = 0; b < NB; b++) {
+    if (version[b] != expected_version(b, STEPS, 0)) {
+      fprintf(stderr, "block %d updated %d times, expected %d\n", b,
+              version[b], expected_version(b, STEPS, 0));
+      return 0;
+    }
+  }
+  if (omp_get_max_threads() > 1) {
+    for (step = 0; step < STEPS; step++) {
+      // recorded at the first step and after the short one
+      int expected = step != 0 && step != SHORT_STEP + 1;
+      if (replayed[step] != expected) {
+        fprintf(stderr,
+                "step %d: __kmpc_taskgraph_begin returned %d, expected %d\n",
+                step, replayed[step], expected);
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+// The tasks are independent at all steps but one, where they all update the
+// same block and must run in their creation order
+int test_kmp_taskgraph_deps(int graph_id) {
+  int b, step;
+  int replayed[STEPS];
+  int chain = 0;
+
+  errors = 0;
+
+  #pragma omp parallel private(b, step)
+  #pragma omp single
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    for (step = 0; step < STEPS; step++) {
+      replayed[step] = __kmpc_taskgraph_begin(NULL, gtid, graph_id);
+      for (b = 0; b < NB; b++) {
+        #pragma omp task firstprivate(b, step) shared(chain)                  \
+                         depend(inout: version[step == CHAIN_STEP ? 0 : b])
+        {
+          if (step == CHAIN_STEP) {
+            if (chain != b) {
+              #pragma omp atomic
+              errors++;
+            }
+            chain = b + 1;
+          }
+        }
+      }
+      __kmpc_taskgraph_end(NULL, gtid);
+    }
+  }
+
+  if (errors || chain != NB) {
+    fprintf(stderr, "%d tasks ran out of dependence order\n", errors);
+    return 0;
+  }
+  if (omp_get_max_threads() > 1) {
+    for (step = 0; step < STEPS; step++) {
+      int expected = step != 0 && step != CHAIN_STEP + 1;
+      if (replayed[step] != expected) {
+        fprintf(stderr,
+                "step %d: __kmpc_taskgraph_begin returned %d, expected %d\n",
+                step, replayed[step], expected);
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_kmp_taskgraph(i + 1) ||
+        !test_kmp_taskgraph_deps(REPETITIONS + i + 1)) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,137 @@
+// RUN: %libomp-compile && env KMP_TASKLOOP_LAZY=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASKLOOP_LAZY=1 KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASKLOOP_LAZY=1 OMP_NUM_THREADS=1 %libomp-run
+// RUN: %libomp-compile-and-run
+#include <stdio.h>
+#include <omp.h>
+
+/*
+ * Test the lazy taskloop: a taskloop without schedule clause over irregular
+ * iterations is executed by range tasks that split as threads become idle.
+ * Every iteration must be executed exactly once, and the lastprivate flag
+ * must be set for the chunk holding the last iteration only, for positive and
+ * negative strides.
+ */
+
+#define N 10000
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+  void *dummy;
+} ident_t;
+
+typedef struct shar {
+  int *count;
+  int *last;
+  int *nlast;
+} *pshareds;
+
+typedef struct task {
+  pshareds shareds;
+  int (*routine)(int, struct task *);
+  int part_id;
+  // privates:
+  unsigned long long lb; // library always uses ULONG
+  unsigned long long ub;
+  int st;
+  int last;
+} *ptask, kmp_task_t;
+
+typedef int (*task_entry_t)(int, ptask);
+
+void __task_dup_entry(ptask task_dst, ptask task_src, int lastpriv) {
+  task_dst->last = lastpriv;
+}
+
+// OpenMP RTL interfaces
+typedef unsigned long long kmp_uint64;
+typedef long long kmp_int64;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void __kmpc_taskloop(ident_t *loc, int gtid, kmp_task_t *task, int if_val,
+                     kmp_uint64 *lb, kmp_uint64 *ub, kmp_int64 st, int nogroup,
+                     int sched, kmp_int64 grainsize, void *task_dup);
+ptask __kmpc_omp_task_alloc(ident_t *loc, int gtid, int flags,
+                            size_t sizeof_kmp_task_t, size_t sizeof_shareds,
+                            task_entry_t task_entry);
+int __kmpc_global_thread_num(void *id_ref);
+#ifdef __cplusplus
+}
+#endif
+
+static int count[N];
+static int last, nlast;
+
+// User's code: the cost of the iterations grows with i
+int task_entry(int gtid, ptask task) {
+  pshareds pshar = task->shareds;
+  long long i;
+  for (i = (long long)task->lb; task->st > 0 ? i <= (long long)task->ub
+                                              : i >= (long long)task->ub;
+       i += task->st) {
+    volatile int k, x = 0;
+    for (k = 0; k < i / 10; k++)
+      x += k;
+    #pragma omp atomic
+    pshar->count[i]++;
+  }
+  if (task->last) {
+    #pragma omp atomic
+    (*pshar->nlast)++;
+    *pshar->last = (int)task->ub;
+  }
+  return 0;
+}
+
+static int run(long long lb, long long ub, int st) {
+  int i, errors = 0;
+  for (i = 0; i < N; i++)
+    count[i] = 0;
+  last = -1;
+  nlast = 0;
+
+  #pragma omp parallel
+  #pragma omp master
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    ptask task = __kmpc_omp_task_alloc(NULL, gtid, 1, sizeof(struct task),
+                                       sizeof(struct shar), &task_entry);
+    task->shareds->count = count;
+    task->shareds->last = &last;
+    task->shareds->nlast = &nlast;
+    task->lb = lb;
+    task->ub = ub;
+    task->st = st;
+    __kmpc_taskloop(NULL, gtid, task, 1, &task->lb, &task->ub, st, 0,
+                    0, // no schedule clause
+                    0, (void *)&__task_dup_entry);
+  }
+
+  for (i = 0; i < N; i++) {
+    int expected = st > 0 ? i >= lb && i <= ub && (i - lb) % st == 0
+                          : i <= lb && i >= ub && (lb - i) % -st == 0;
+    if (count[i] != expected) {
+      printf("iteration %d executed %d times, expected %d\n", i, count[i],
+             expected);
+      errors++;
+    }
+  }
+  if (nlast != 1 || last != ub) {
+    printf("lastprivate set by %d tasks, last upper bound %d, expected %lld\n",
+           nlast, last, ub);
+    errors++;
+  }
+  return errors;
+}
+
+int main() {
+  int errors = 0;
+  errors += run(0, N - 1, 1);
+  errors += run(3, N - 8, 7);
+  errors += run(N - 1, 0, -3);
+  if (errors == 0)
+    printf("passed\n");
+  return errors;
+}
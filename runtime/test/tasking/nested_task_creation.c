@@ -1,4 +1,7 @@
 // RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_STEAL_POLICY=hierarchical %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_STEAL_POLICY=hierarchical KMP_TASK_STEAL_RETRIES=1,1,1 %libomp-run
 #include <stdio.h>
 #include <omp.h>
 #include "omp_my_sleep.h"
@@ -0,0 +1,90 @@
+// RUN: %libomp-compile && env KMP_TASK_CRITICAL_PATH=8 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_CRITICAL_PATH=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_CRITICAL_PATH=8 OMP_MAX_TASK_PRIORITY=2 %libomp-run
+// RUN: %libomp-compile-and-run
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+#include "omp_my_sleep.h"
+
+/*
+ * Test the critical path scheduling of dependence graphs: a gate task
+ * releases at once the head of a long chain of tasks and many independent
+ * slow tasks created after it. The chain must run in order, and with
+ * KMP_TASK_CRITICAL_PATH set, the chain which has the longest path is
+ * preferred and must complete before most of the independent tasks. Half of
+ * the independent tasks have a priority, to mix both kinds of priority queues;
+ * those rightly run before the chain when priorities are enabled, so only the
+ * independent tasks without a priority are counted.
+ */
+
+#define CHAIN 16
+#define NUM_LEAVES 100
+
+int test_omp_task_critical_path(int critical_path) {
+  int gate = 0, chain = 0, chain_pos = -1, leaves = 0, plain = 0, errors = 0;
+  int i;
+
+  #pragma omp parallel private(i)
+  #pragma omp single
+  {
+    #pragma omp task depend(out: gate)
+    my_sleep(0.05); // let the graph be built first
+
+    for (i = 0; i < CHAIN; i++) {
+      #pragma omp task depend(in: gate) depend(inout: chain) firstprivate(i) \
+          shared(chain_pos, errors, leaves)
+      {
+        if (chain != i) {
+          #pragma omp atomic
+          errors++;
+        }
+        chain++;
+        if (i == CHAIN - 1) {
+          #pragma omp atomic read
+          chain_pos = plain;
+        }
+      }
+    }
+    for (i = 0; i < NUM_LEAVES; i++) {
+      #pragma omp task depend(in: gate) priority(i % 2) firstprivate(i) \
+          shared(leaves, plain)
+      {
+        my_sleep(0.001);
+        #pragma omp atomic
+        leaves++;
+        if (i % 2 == 0) {
+          #pragma omp atomic
+          plain++;
+        }
+      }
+    }
+  }
+
+  if (errors || chain != CHAIN || leaves != NUM_LEAVES) {
+    fprintf(stderr, "%d chain tasks out of order, %d chain tasks and %d "
+            "independent tasks executed\n", errors, chain, leaves);
+    return 0;
+  }
+  if (critical_path && chain_pos > NUM_LEAVES / 8) {
+    fprintf(stderr, "chain completed after %d independent tasks without a "
+            "priority\n", chain_pos);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  char *env = getenv("KMP_TASK_CRITICAL_PATH");
+  int critical_path = env != NULL && atoi(env) > 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_task_critical_path(critical_path)) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,92 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_CUTOFF=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_CUTOFF=1 KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_CUTOFF=4 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Test the task cutoff with recursive task trees: most tasks are short, so
+ * once the threads have enough queued tasks the new ones are executed
+ * immediately by their creator, including inside tasks executed that way.
+ * Every task must still run exactly once and the taskwaits must see the
+ * results of the children.
+ */
+
+#define FIB_N 24
+#define TREE_DEPTH 12
+#define TREE_DEGREE 3
+
+static int fib(int n) {
+  int x, y;
+  if (n < 2)
+    return n;
+  #pragma omp task shared(x)
+  x = fib(n - 1);
+  #pragma omp task shared(y)
+  y = fib(n - 2);
+  #pragma omp taskwait
+  return x + y;
+}
+
+static int fib_serial(int n) {
+  return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+static int count_nodes(int depth) {
+  int count[TREE_DEGREE];
+  int i, sum = 1;
+  if (depth == 0)
+    return 1;
+  for (i = 0; i < TREE_DEGREE; i++) {
+    #pragma omp task shared(count) firstprivate(i)
+    count[i] = count_nodes(depth - 1);
+  }
+  #pragma omp taskwait
+  for (i = 0; i < TREE_DEGREE; i++)
+    sum += count[i];
+  return sum;
+}
+
+int test_omp_task_cutoff() {
+  int result = 0;
+  int nodes = 0;
+  int expected_nodes = 0;
+  int i, level = 1;
+
+  #pragma omp parallel
+  #pragma omp single
+  {
+    result = fib(FIB_N);
+    nodes = count_nodes(TREE_DEPTH);
+  }
+
+  for (i = 0; i <= TREE_DEPTH; i++) {
+    expected_nodes += level;
+    level *= TREE_DEGREE;
+  }
+  if (result != fib_serial(FIB_N)) {
+    fprintf(stderr, "fib(%d) = %d, expected %d\n", FIB_N, result,
+            fib_serial(FIB_N));
+    return 0;
+  }
+  if (nodes != expected_nodes) {
+    fprintf(stderr, "counted %d tree nodes, expected %d\n", nodes,
+            expected_nodes);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_task_cutoff()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,61 @@
+// RUN: %libomp-compile && env KMP_TASK_BYPASS=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_BYPASS=1 KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Test that the thread finishing a task executes its successor right away: a
+ * chain of dependent tasks is created while its first task is held back, so
+ * each successor is released by the completion of its predecessor. A thread
+ * runs up to CHAIN_CUT successors in a row before queuing the next one, so
+ * each segment of the chain must run on the thread that started it.
+ */
+
+#define CHAIN_LEN 100
+#define CHAIN_CUT 16 // KMP_TASK_BYPASS_CHAIN in the runtime
+
+int test_omp_task_depend_bypass() {
+  int thread[CHAIN_LEN];
+  int x = 0;
+  int i;
+  volatile int go = 0;
+
+  #pragma omp parallel num_threads(2) shared(go)
+  #pragma omp single
+  {
+    #pragma omp task depend(inout: x) shared(thread, go)
+    {
+      while (!go)
+        ;
+      thread[0] = omp_get_thread_num();
+    }
+    for (i = 1; i < CHAIN_LEN; i++) {
+      #pragma omp task depend(inout: x) firstprivate(i) shared(thread)
+      thread[i] = omp_get_thread_num();
+    }
+    go = 1;
+  }
+
+  for (i = 1; i < CHAIN_LEN; i++) {
+    int first = i - i % (CHAIN_CUT + 1);
+    if (thread[i] != thread[first]) {
+      fprintf(stderr, "task %d of the chain ran on thread %d, expected %d\n",
+              i, thread[i], thread[first]);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_task_depend_bypass()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,105 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_ENABLE_TASK_THROTTLING=0 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_BYPASS=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_CRITICAL_PATH=8 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Build the task graph of a blocked Cholesky factorization, which has many
+ * tasks with dependences on many distinct tiles, enough to make the
+ * dependence hash grow a few times. Instead of the numerical kernels, each
+ * task checks and bumps the version of the tiles it uses: a tile is updated
+ * by the step k tasks in order of k and must be final when it is read.
+ */
+
+#define NT 48
+
+static int version[NT][NT];
+static int errors;
+
+static void check(int i, int j, int expected) {
+  if (version[i][j] != expected) {
+    #pragma omp atomic
+    errors++;
+  }
+}
+
+int test_omp_task_depend_cholesky() {
+  int i, j, k;
+
+  for (i = 0; i < NT; i++)
+    for (j = 0; j < NT; j++)
+      version[i][j] = 0;
+  errors = 0;
+
+  #pragma omp parallel private(i, j, k)
+  #pragma omp single
+  {
+    for (k = 0; k < NT; k++) {
+      // potrf
+      #pragma omp task depend(inout: version[k][k])
+      {
+        check(k, k, k);
+        version[k][k]++;
+      }
+      // trsm
+      for (i = k + 1; i < NT; i++) {
+        #pragma omp task depend(in: version[k][k]) depend(inout: version[i][k])
+        {
+          check(k, k, k + 1);
+          check(i, k, k);
+          version[i][k]++;
+        }
+      }
+      for (i = k + 1; i < NT; i++) {
+        // syrk
+        #pragma omp task depend(in: version[i][k]) depend(inout: version[i][i])
+        {
+          check(i, k, k + 1);
+          check(i, i, k);
+          version[i][i]++;
+        }
+        // gemm
+        for (j = k + 1; j < i; j++) {
+          #pragma omp task depend(in: version[i][k], version[j][k])           \
+                           depend(inout: version[i][j])
+          {
+            check(i, k, k + 1);
+            check(j, k, k + 1);
+            check(i, j, k);
+            version[i][j]++;
+          }
+        }
+      }
+    }
+  }
+
+  if (errors) {
+    fprintf(stderr, "%d tasks ran out of dependence order\n", errors);
+    return 0;
+  }
+  for (i = 0; i < NT; i++) {
+    for (j = 0; j <= i; j++) {
+      if (version[i][j] != j + 1) {
+        fprintf(stderr, "tile (%d,%d) updated %d times, expected %d\n", i, j,
+                version[i][j], j + 1);
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_task_depend_cholesky()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
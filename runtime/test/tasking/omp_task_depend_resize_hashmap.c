@@ -4,7 +4,7 @@
 #include<stdlib.h>
 #include<string.h>
 
-// The first hashtable static size is 997
+// The initial hash table has 1024 slots and grows at half occupancy
 #define NUM_DEPS 4000
 
 
@@ -0,0 +1,80 @@
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_LOCKFREE=1 KMP_ENABLE_TASK_THROTTLING=0 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_LOCKFREE=1 KMP_TASK_STEALING_CONSTRAINT=0 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_DEQUE_LOCKFREE=1 KMP_TASK_STEAL_BATCH=16 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Stress the lock-free task deques: a recursive task tree makes the owners
+ * push and take while idle threads keep stealing from the other end, and a
+ * flat loop of many tasks makes the master's deque grow past its initial size
+ * when throttling is disabled.
+ */
+
+#define FIB_N 22
+#define NUM_FLAT_TASKS 5000
+
+static int fib(int n) {
+  int x, y;
+  if (n < 2)
+    return n;
+  #pragma omp task shared(x)
+  x = fib(n - 1);
+  #pragma omp task shared(y)
+  y = fib(n - 2);
+  #pragma omp taskwait
+  return x + y;
+}
+
+static int fib_serial(int n) {
+  return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+int test_omp_task_deque_lockfree() {
+  int result = 0;
+  int count = 0;
+  int i;
+
+  #pragma omp parallel
+  {
+    #pragma omp single
+    result = fib(FIB_N);
+
+    #pragma omp single
+    {
+      for (i = 0; i < NUM_FLAT_TASKS; i++) {
+        #pragma omp task
+        {
+          #pragma omp atomic
+          count++;
+        }
+      }
+    }
+  }
+
+  if (result != fib_serial(FIB_N)) {
+    fprintf(stderr, "fib(%d) = %d, expected %d\n", FIB_N, result,
+            fib_serial(FIB_N));
+    return 0;
+  }
+  if (count != NUM_FLAT_TASKS) {
+    fprintf(stderr, "%d flat tasks executed, expected %d\n", count,
+            NUM_FLAT_TASKS);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_task_deque_lockfree()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
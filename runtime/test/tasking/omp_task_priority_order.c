@@ -0,0 +1,61 @@
+// RUN: %libomp-compile && env OMP_MAX_TASK_PRIORITY=10 %libomp-run
+// RUN: %libomp-compile && env OMP_MAX_TASK_PRIORITY=10 KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+
+/*
+ * Test that the scheduler honors task priorities: the master queues a few high
+ * priority tasks followed by many tasks without priority and then executes
+ * them at a taskwait while the other thread is held back. The high priority
+ * tasks must be executed first even though the master runs its own tasks in
+ * LIFO order.
+ */
+
+#define NUM_LOW 100
+#define NUM_HIGH 4
+
+int main() {
+  int order = 0;
+  int high_order[NUM_HIGH];
+  int max_high_order = -1;
+  int i;
+  volatile int release = 0;
+
+  #pragma omp parallel num_threads(2) shared(order, release)
+  {
+    if (omp_get_thread_num() == 0) {
+      for (i = 0; i < NUM_HIGH; i++) {
+        #pragma omp task priority(10) firstprivate(i)
+        {
+          #pragma omp atomic capture
+          high_order[i] = order++;
+        }
+      }
+      for (i = 0; i < NUM_LOW; i++) {
+        #pragma omp task
+        {
+          #pragma omp atomic
+          order++;
+        }
+      }
+      #pragma omp taskwait
+      release = 1;
+    } else {
+      while (!release)
+        ;
+    }
+  }
+
+  for (i = 0; i < NUM_HIGH; i++) {
+    if (high_order[i] > max_high_order)
+      max_high_order = high_order[i];
+  }
+  if (max_high_order != NUM_HIGH - 1) {
+    printf("failed: %d low priority tasks ran before the last high priority "
+           "task\n",
+           max_high_order - (NUM_HIGH - 1));
+    return 1;
+  }
+  printf("passed\n");
+  return 0;
+}
@@ -0,0 +1,91 @@
+// RUN: %libomp-compile-and-run
+// RUN: %libomp-compile && env KMP_TASK_SLAB_ALLOC=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_SLAB_ALLOC=1 KMP_TASK_DEQUE_LOCKFREE=1 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+/*
+ * Stress the task descriptor slabs: the tasks are created by one thread and
+ * mostly executed, and therefore freed, by the other threads, so descriptors
+ * keep going back to their owner through the remote free lists. The tasks
+ * carry firstprivate arrays of several sizes to use every size class as well
+ * as descriptors too large for the slabs. The tasks come in bursts separated
+ * by barriers, where the slabs give back the chunks of the previous burst.
+ */
+
+#define NUM_TASKS 2000
+#define NUM_BURSTS 3
+
+struct small { int v[4]; };
+struct medium { int v[100]; };
+struct large { int v[400]; };
+struct huge { int v[2000]; };
+
+int test_omp_task_slab_alloc() {
+  int sum = 0;
+  int expected = 0;
+  int i, burst;
+
+  #pragma omp parallel private(burst)
+  for (burst = 0; burst < NUM_BURSTS; burst++) {
+    #pragma omp single
+    {
+      for (i = 0; i < NUM_TASKS; i++) {
+        struct small s;
+        struct medium m;
+        struct large l;
+        struct huge h;
+        s.v[3] = m.v[99] = l.v[399] = h.v[1999] = i;
+        switch (i % 4) {
+        case 0:
+          #pragma omp task firstprivate(s) shared(sum)
+          {
+            #pragma omp atomic
+            sum += s.v[3];
+          }
+          break;
+        case 1:
+          #pragma omp task firstprivate(m) shared(sum)
+          {
+            #pragma omp atomic
+            sum += m.v[99];
+          }
+          break;
+        case 2:
+          #pragma omp task firstprivate(l) shared(sum)
+          {
+            #pragma omp atomic
+            sum += l.v[399];
+          }
+          break;
+        default:
+          #pragma omp task firstprivate(h) shared(sum)
+          {
+            #pragma omp atomic
+            sum += h.v[1999];
+          }
+        }
+        expected += i;
+      }
+    }
+  }
+
+  if (sum != expected) {
+    fprintf(stderr, "sum = %d, expected %d\n", sum, expected);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_task_slab_alloc()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,182 @@
+// RUN: %libomp-compile && env KMP_TASK_FIBERS=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_FIBERS=1 KMP_TASK_FIBER_STACKSIZE=64k %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_FIBERS=1 OMP_NUM_THREADS=1 %libomp-run
+// RUN: %libomp-compile && env KMP_TASK_FIBERS=1 OMP_MAX_TASK_PRIORITY=2 %libomp-run
+// RUN: %libomp-compile-and-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+#include "omp_my_sleep.h"
+
+/*
+ * Test untied tasks suspended at taskwait and taskyield: a recursive
+ * computation where each untied task waits for its children, next to untied
+ * tasks yielding many times. With KMP_TASK_FIBERS set, the waiting tasks run
+ * on fibers and switch back to the scheduler instead of running other tasks
+ * on top of their stack. A suspended task must resume on
+ * the thread that suspended it, with the results of all its children. With
+ * OMP_MAX_TASK_PRIORITY set, the tasks of the computation go through the
+ * priority queues, which must not lose them when a fiber is resumed. Last, a
+ * task waits for a child run by another thread while its home thread is kept
+ * busy by an unrelated task: it must not be resumed before its home thread
+ * completed that task.
+ */
+
+#define N 20
+#define NUM_YIELDERS 16
+#define YIELDS 100
+#define NUM_BUSY 8
+
+static int migrations;
+
+static int fib(int n) {
+  int x, y, tid;
+  if (n < 2)
+    return n;
+  tid = omp_get_thread_num();
+  #pragma omp task untied shared(x) priority(n % 3)
+  x = fib(n - 1);
+  #pragma omp task untied shared(y) priority(n % 3)
+  y = fib(n - 2);
+  #pragma omp taskwait
+  if (tid != omp_get_thread_num()) {
+    #pragma omp atomic
+    migrations++;
+  }
+  return x + y;
+}
+
+int test_omp_task_untied_fibers() {
+  int result = 0, arrived = 0, yields = 0;
+  int i, expected = 6765; // fib(20)
+  migrations = 0;
+
+  #pragma omp parallel private(i)
+  #pragma omp single
+  {
+    for (i = 0; i < NUM_YIELDERS; i++) {
+      #pragma omp task untied shared(arrived, yields)
+      {
+        int k;
+        for (k = 0; k < YIELDS; k++) {
+          #pragma omp taskyield
+          #pragma omp atomic
+          yields++;
+        }
+        #pragma omp atomic
+        arrived++;
+      }
+    }
+    #pragma omp task untied shared(result)
+    result = fib(N);
+  }
+
+  if (result != expected || arrived != NUM_YIELDERS ||
+      yields != NUM_YIELDERS * YIELDS || migrations) {
+    fprintf(stderr, "fib(%d) = %d, expected %d; %d tasks yielded %d times, "
+            "%d resumed on another thread\n", N, result, expected, arrived,
+            yields, migrations);
+    return 0;
+  }
+  return 1;
+}
+
+// wait_flag: wait until *flag is set, for at most timeout seconds
+static int wait_flag(int *flag, double timeout) {
+  double end = omp_get_wtime() + timeout;
+  int value;
+  do {
+    #pragma omp atomic read
+    value = *flag;
+    if (value)
+      return 1;
+    my_sleep(0.0005);
+  } while (omp_get_wtime() < end);
+  return 0;
+}
+
+int test_omp_task_untied_fibers_busy_home() {
+  int home = -1, started = 0, waiting = 0, home_busy = 0, busy_done = 0;
+  int errors = 0;
+
+  #pragma omp parallel
+  #pragma omp single
+  {
+    // the child needs a thread other than the home thread and this one
+    int enough = omp_get_num_threads() >= 3;
+    int i;
+
+    #pragma omp task untied shared(home, started, waiting, home_busy, \
+                                   busy_done, errors)
+    {
+      int tid = omp_get_thread_num(), busy, done;
+      #pragma omp atomic write
+      home = tid;
+      #pragma omp task shared(home, started, home_busy)
+      {
+        #pragma omp atomic write
+        started = 1;
+        if (omp_get_thread_num() != home)
+          wait_flag(&home_busy, 1.0);
+      }
+      if (enough)
+        wait_flag(&started, 1.0);
+      #pragma omp atomic write
+      waiting = 1;
+      #pragma omp taskwait
+      #pragma omp atomic read
+      busy = home_busy;
+      #pragma omp atomic read
+      done = busy_done;
+      if (tid != omp_get_thread_num() || (busy && !done)) {
+        #pragma omp atomic
+        errors++;
+      }
+    }
+
+    // queue the busy tasks once the task waits for its child
+    if (enough)
+      wait_flag(&waiting, 1.0);
+    for (i = 0; i < NUM_BUSY; i++) {
+      #pragma omp task shared(home, home_busy, busy_done)
+      {
+        int tid, busy = 1;
+        #pragma omp atomic read
+        tid = home;
+        if (tid == omp_get_thread_num()) {
+          #pragma omp atomic capture
+          busy = home_busy++;
+        }
+        if (busy == 0) {
+          my_sleep(0.1);
+          #pragma omp atomic write
+          busy_done = 1;
+        } else {
+          my_sleep(0.001);
+        }
+      }
+    }
+  }
+
+  if (errors) {
+    fprintf(stderr, "task resumed on another thread or while its home thread "
+            "was busy\n");
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_task_untied_fibers()) {
+      num_failed++;
+    }
+    if (!test_omp_task_untied_fibers_busy_home()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
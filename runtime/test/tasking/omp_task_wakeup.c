@@ -0,0 +1,69 @@
+// RUN: %libomp-compile && env KMP_BLOCKTIME=0 %libomp-run
+// RUN: %libomp-compile && env KMP_BLOCKTIME=0 KMP_TASK_WAKEUP_CAP=1 %libomp-run
+// RUN: %libomp-compile && env KMP_BLOCKTIME=0 KMP_TASK_WAKEUP_CAP=4 %libomp-run
+// RUN: %libomp-compile && env KMP_BLOCKTIME=0 KMP_TASK_STEAL_POLICY=hierarchical %libomp-run
+// RUN: %libomp-compile-and-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+#include "omp_my_sleep.h"
+
+/*
+ * Test the wake-on-demand policy for threads sleeping at the barrier: the
+ * other threads of the team are given time to fall asleep before the first
+ * task is created, then tasks are created one at a time, which should not
+ * resume many threads, and then in a burst. All tasks must be executed, and
+ * the threads left asleep must still be resumed to complete the barrier.
+ */
+
+#define NUM_TRICKLE 20
+#define NUM_BURST 500
+
+int test_omp_task_wakeup() {
+  int count = 0;
+  int i;
+
+  #pragma omp parallel shared(count) private(i)
+  {
+    #pragma omp single
+    {
+      // let the other threads go to sleep at the end of the single
+      my_sleep(0.1);
+      for (i = 0; i < NUM_TRICKLE; i++) {
+        #pragma omp task shared(count)
+        {
+          #pragma omp atomic
+          count++;
+        }
+        #pragma omp taskwait
+      }
+      for (i = 0; i < NUM_BURST; i++) {
+        #pragma omp task shared(count)
+        {
+          my_sleep(0.0001);
+          #pragma omp atomic
+          count++;
+        }
+      }
+    }
+  }
+
+  if (count != NUM_TRICKLE + NUM_BURST) {
+    fprintf(stderr, "%d tasks executed, expected %d\n", count,
+            NUM_TRICKLE + NUM_BURST);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_task_wakeup()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}